@@ -5,6 +5,28 @@ debug=1
 
 code_dir=$PWD
 
+# Linux
+# -----
+# NOTE: the game is built into snake_game.so, which linux_snake hot reloads. It's written
+# under a temp name and renamed so that the platform never sees a half linked library.
+# -fno-gnu-unique lets dlclose actually unload it.
+if [ "$(uname)" = "Linux" ]; then
+  linux_build_path="../build/linux$version"
+  linux_compiler_flags="-std=c++11 -g -O2 -fno-exceptions -fno-rtti -Wall -Wno-unused -Wno-write-strings -Wno-sign-compare -Wno-switch -DSNAKE_INTERNAL=1 -DSNAKE_SLOW=0"
+
+  # NOTE: a subshell rather than pushd, which plain sh (dash) doesn't have
+  mkdir -p $linux_build_path
+  (
+    cd $linux_build_path || exit 1
+    g++ $linux_compiler_flags -fPIC -shared -fno-gnu-unique "$code_dir/snake_game.cpp" -o snake_game_build.so && mv snake_game_build.so snake_game.so
+    g++ $linux_compiler_flags "$code_dir/linux_snake_game.cpp" -o linux_snake -lX11 -lXext -ldl -lpthread
+    g++ $linux_compiler_flags "$code_dir/headless_snake_game.cpp" -o headless_snake -lpthread
+    g++ $linux_compiler_flags "$code_dir/snake_bench.cpp" -o snake_bench -lpthread
+    g++ $linux_compiler_flags "$code_dir/snake_telemetry_tool.cpp" -o snake_telemetry_tool
+  )
+  exit
+fi
+
 # Compiler Flags
 # --------------
 warning_level="-W4"
@@ -36,6 +58,8 @@ build_path="../build/win$version"
 
 win32_source_file="$code_dir/win32_snake_game.cpp"
 snake_source_file="$code_dir/snake_game.cpp"
+bench_source_file="$code_dir/snake_bench.cpp"
+telemetry_tool_source_file="$code_dir/snake_telemetry_tool.cpp"
 
 mkdir $build_path -p
 pushd $build_path
@@ -46,5 +70,7 @@ rm *.pdb &>/dev/null
 
 cl $common_compiler_flags $snake_source_file -Fmsnake_game.map -LD -link $snake_linker
 cl $common_compiler_flags $win32_source_file -Fmwin32_snake.map -link $platform_linker
+cl $common_compiler_flags $bench_source_file -Fmsnake_bench.map -link $common_linker
+cl $common_compiler_flags $telemetry_tool_source_file -Fmsnake_telemetry_tool.map -link $common_linker
 
 popd
@@ -0,0 +1,538 @@
+/* Headless batch runner
+ *
+ * Plays many independent games as fast as the machine allows, with no window or audio.
+ * Each game gets its own memory block and PCG stream, and a pool of worker threads steps
+ * them in parallel. Used for bot and tuning experiments where we want games/sec rather
+ * than pretty pixels.
+ *
+ * With -snakes every game is a swarm game with that many AI snakes on the board, and
+ * "games finished" counts snake deaths instead.
+ *
+ * With -autopilot the single snake games are played by the built in autopilot instead of
+ * the random bot.
+ *
+ * -record writes a replay of one game played through UpdateGame by a scripted player, and
+ * -replay plays a replay back as fast as possible, checks every tick's state hash against
+ * the recorded one and reports the first tick that differs. -seek jumps to a tick through the replay's keyframes first. See snake_replay.h.
+ *
+ * Usage: headless_snake [-games N] [-ticks T] [-threads N] [-size W H] [-seed S] [-snakes N] [-autopilot]
+ *        headless_snake -record FILE [-frames N] [-size W H] [-seed S] [-snakes N] [-autopilot]
+ *        headless_snake -replay FILE [-seek TICK]
+ */
+
+#include "snake_game.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+struct HeadlessGame {
+  GameMemory memory;
+  GameState *state;
+  pcg32_random_t bot_rng; // kept apart from the game's rng so bots don't perturb the sim
+
+  uint64 ticks;
+  uint64 games_finished;
+  uint64 total_score;
+  uint64 total_length;
+};
+
+struct HeadlessRun {
+  HeadlessGame *games;
+  int32 game_count;
+  uint64 ticks_per_game;
+
+  // Next game for a worker to pick up
+  volatile int32 next_game_idx;
+};
+
+// ---------------------------------------------------------------------------------------
+// Utils
+// ---------------------------------------------------------------------------------------
+
+internal real64
+HeadlessGetSeconds() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (real64)spec.tv_sec + ((real64)spec.tv_nsec / 1e9);
+}
+
+/* Reserves without committing. Only the pages a game actually touches get backed, so we
+ * can hand every game a generous block.
+ */
+internal void *
+HeadlessReserve(uint64 size) {
+  void *result = mmap(0, (size_t)size, PROT_READ|PROT_WRITE,
+                      MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+  if (result == MAP_FAILED) {
+    result = 0;
+  }
+  return result;
+}
+
+// ---------------------------------------------------------------------------------------
+// Bot
+// ---------------------------------------------------------------------------------------
+
+/* Picks a random direction that doesn't kill the snake on its next move. Good enough to
+ * exercise the sim. Dies when it boxes itself in.
+ */
+internal void
+HeadlessBotMove(HeadlessGame *game) {
+  GameState *state = game->state;
+  SnakeState *snake = &state->snake;
+
+  // Only think once per move, right before it happens
+  if (state->snake_move_ticks_left == 1) {
+    Direction options[4] = {NORTH, EAST, SOUTH, WEST};
+    int32 first = (int32)pcg32_boundedrand_r(&game->bot_rng, 4);
+    bool32 keep_going = (pcg32_boundedrand_r(&game->bot_rng, 4) != 0);
+
+    SnakePiece *head = GetSnakeHead(snake);
+    Direction best = snake->dir;
+    SnakePiece ahead = NextSnakePiece(head, snake->dir);
+    bool32 ahead_is_safe = !(state->board[BoardTileIndex(state, ahead.x, ahead.y)] & (TILE_WALL|TILE_BODY));
+
+    if (!keep_going || !ahead_is_safe) {
+      for (int32 option_idx = 0; option_idx < 4; ++option_idx) {
+        Direction dir = options[(first + option_idx) & 3];
+        if (dir == OppositeDirection(snake->dir)) {
+          continue;
+        }
+        SnakePiece next = NextSnakePiece(head, dir);
+        if (!(state->board[BoardTileIndex(state, next.x, next.y)] & (TILE_WALL|TILE_BODY))) {
+          best = dir;
+          break;
+        }
+      }
+    }
+    ChangeSnakeDirection(snake, best);
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Workers
+// ---------------------------------------------------------------------------------------
+
+internal void
+HeadlessPlayGame(HeadlessGame *game, uint64 tick_count) {
+  GameState *state = game->state;
+  ThreadContext thread = {};
+  if (state->swarm.snake_count > 0) {
+    // The swarm drives and respawns its own snakes
+    SwarmState *swarm = &state->swarm;
+    for (uint64 tick = 0; tick < tick_count; ++tick) {
+      SimulateSwarmTick(state);
+    }
+    game->games_finished += swarm->deaths;
+    for (int32 snake_idx = 0; snake_idx < swarm->snake_count; ++snake_idx) {
+      SwarmSnake *swarm_snake = &swarm->snakes[snake_idx];
+      game->total_score += swarm_snake->score;
+      game->total_length += swarm_snake->body.alive ? swarm_snake->body.length : 0;
+    }
+  }
+  else {
+    for (uint64 tick = 0; tick < tick_count; ++tick) {
+      if (!state->snake.alive) {
+        game->games_finished++;
+        game->total_score += state->score;
+        game->total_length += state->snake.length;
+        ResetGame(&thread, &game->memory, state);
+      }
+      if (state->autopilot.enabled) {
+        AutopilotTick(state);
+      }
+      else {
+        HeadlessBotMove(game);
+      }
+      SimulateTick(state);
+    }
+  }
+  game->ticks += tick_count;
+}
+
+internal void *
+HeadlessWorkerProc(void *param) {
+  HeadlessRun *run = (HeadlessRun *)param;
+  for (;;) {
+    int32 game_idx = __sync_fetch_and_add(&run->next_game_idx, 1);
+    if (game_idx >= run->game_count) {
+      break;
+    }
+    HeadlessPlayGame(&run->games[game_idx], run->ticks_per_game);
+  }
+  return 0;
+}
+
+// ---------------------------------------------------------------------------------------
+// Replays
+// ---------------------------------------------------------------------------------------
+
+/* Same sizes and, when we can get it, the same base address as the win32 debug build so
+ * that any replay fits and its keyframes can be loaded. Only touched pages get committed.
+ */
+internal bool32
+HeadlessReserveReplayMemory(GameMemory *memory) {
+  memory->permanent_storage_size = Megabytes(256);
+  memory->temp_storage_size = Megabytes(500);
+  uint64 total_size = memory->permanent_storage_size + memory->temp_storage_size;
+  void *base_address = (void *)Terabytes(2);
+  memory->permanent_storage = mmap(base_address, (size_t)total_size, PROT_READ|PROT_WRITE,
+                                   MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+  if (memory->permanent_storage == MAP_FAILED) {
+    memory->permanent_storage = 0;
+  }
+  else {
+    memory->temp_storage = (uint8 *)memory->permanent_storage + memory->permanent_storage_size;
+  }
+  return (memory->permanent_storage != 0);
+}
+
+inline void
+HeadlessPressButton(GameButtonState *button, bool32 is_down) {
+  if (button->ended_down != is_down) {
+    button->ended_down = is_down;
+    ++button->half_transition_count;
+  }
+}
+
+/* Records a replay of a scripted player: tap start, then tap a random direction now and
+ * then and restart after dying. The frame times jitter between 144 and 30 Hz so that the
+ * replay covers frames with zero and several sim ticks.
+ */
+internal int
+HeadlessRecordReplay(char *filename, uint32 frame_count, GameConfig config, uint64 seed, bool32 use_autopilot) {
+  FILE *file = fopen(filename, "wb");
+  if (!file) {
+    fprintf(stderr, "couldn't open %s for writing\n", filename);
+    return 1;
+  }
+
+  GameMemory memory = {};
+  if (!HeadlessReserveReplayMemory(&memory)) {
+    fprintf(stderr, "failed to reserve game memory\n");
+    return 1;
+  }
+  memory.config = config;
+  memory.rand_seed = seed;
+  memory.rand_rounds = 1;
+
+  GameOffscreenBuffer no_screen = {};
+  no_screen.width = 1280;
+  no_screen.height = 720;
+
+  ReplayWriter writer = {};
+  writer.max_keyframe_size = (uint32)memory.permanent_storage_size;
+  writer.last_keyframe = (uint8 *)HeadlessReserve(writer.max_keyframe_size);
+  writer.chunk = (uint8 *)HeadlessReserve(ReplayChunkSize(writer.max_keyframe_size));
+  writer.max_keyframes = frame_count / REPLAY_KEYFRAME_INTERVAL + 1;
+  writer.keyframes = (ReplayKeyframe *)HeadlessReserve(writer.max_keyframes * sizeof(ReplayKeyframe));
+  if (!writer.last_keyframe || !writer.chunk || !writer.keyframes) {
+    fprintf(stderr, "failed to reserve replay memory\n");
+    return 1;
+  }
+
+  BeginReplay(&writer, &memory, no_screen.width, no_screen.height);
+  fwrite(&writer.header, sizeof(writer.header), 1, file);
+
+  pcg32_random_t player_rng;
+  pcg32_srandom_r(&player_rng, seed ^ 0x9E3779B9, 7);
+  GameState *state = (GameState *)memory.permanent_storage;
+  ThreadContext thread = {};
+  GameInput input = {};
+  GameControllerInput *controller = GetController(&input, 0);
+  controller->is_connected = true;
+
+  for (uint32 frame = 0; frame < frame_count; ++frame) {
+    for (int button_idx = 0; button_idx < ArrayCount(controller->buttons); ++button_idx) {
+      controller->buttons[button_idx].half_transition_count = 0;
+    }
+    input.dt_for_frame = 1.0f / (real32)(30 + pcg32_boundedrand_r(&player_rng, 115));
+
+    bool32 snake_is_dead = memory.is_initialized && (state->swarm.snake_count == 0) && !state->snake.alive;
+    HeadlessPressButton(&controller->start, (frame == 0) || snake_is_dead);
+    HeadlessPressButton(&controller->back, (frame == 0) && use_autopilot);
+
+    uint32 roll = pcg32_boundedrand_r(&player_rng, 32);
+    HeadlessPressButton(&controller->move_up, roll == 0);
+    HeadlessPressButton(&controller->move_down, roll == 1);
+    HeadlessPressButton(&controller->move_left, roll == 2);
+    HeadlessPressButton(&controller->move_right, roll == 3);
+
+    UpdateGame(&thread, &memory, &input, &no_screen);
+    uint64 chunk_size = ReplayRecordFrame(&writer, &memory, &input);
+    fwrite(writer.chunk, chunk_size, 1, file);
+  }
+
+  EndReplay(&writer, &memory);
+  ReplayHeader *header = &writer.header;
+  fwrite(writer.keyframes, sizeof(ReplayKeyframe), header->keyframe_count, file);
+  uint64 file_size = (uint64)ftell(file);
+  fseek(file, 0, SEEK_SET);
+  fwrite(header, sizeof(*header), 1, file);
+  fclose(file);
+
+  printf("recorded %u frames to %s: %llu sim ticks, score %d, length %d\n",
+         frame_count, filename, (unsigned long long)header->end_sim_tick,
+         header->end_score, header->end_length);
+  printf("%llu bytes with %u keyframes (%.2f bytes per frame, raw inputs would be %llu bytes)\n",
+         (unsigned long long)file_size, header->keyframe_count,
+         (real64)file_size / (real64)Max(frame_count, 1),
+         (unsigned long long)frame_count * sizeof(GameInput));
+  return 0;
+}
+
+/* Plays a replay back as fast as possible. With a seek tick it first jumps there through
+ * the keyframes and reports how long that took, then plays on to the end. Either way every
+ * tick has to hash the same as it did when recorded and the game has to end up exactly
+ * where the recording did.
+ */
+internal int
+HeadlessPlayReplay(char *filename, bool32 do_seek, uint64 seek_tick) {
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
+    fprintf(stderr, "couldn't open %s\n", filename);
+    return 1;
+  }
+  fseek(file, 0, SEEK_END);
+  uint64 file_size = (uint64)ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8 *data = (uint8 *)malloc(file_size);
+  bool32 was_read = data && (fread(data, 1, file_size, file) == file_size);
+  fclose(file);
+
+  ReplayReader reader;
+  if (!was_read || !OpenReplay(&reader, data, file_size)) {
+    fprintf(stderr, "%s isn't a replay this build can play\n", filename);
+    return 1;
+  }
+  ReplayHeader *header = &reader.header;
+
+  GameMemory memory = {};
+  if (!HeadlessReserveReplayMemory(&memory)) {
+    fprintf(stderr, "failed to reserve game memory\n");
+    return 1;
+  }
+  memory.config = header->config;
+  memory.rand_seed = header->rand_seed;
+  memory.rand_rounds = header->rand_rounds;
+
+  GameOffscreenBuffer no_screen = {};
+  no_screen.width = header->screen_width;
+  no_screen.height = header->screen_height;
+
+  GameState *state = (GameState *)memory.permanent_storage;
+  ThreadContext thread = {};
+  GameInput input;
+  bool32 diverged = false;
+  uint64 divergent_tick = 0;
+
+  if (do_seek) {
+    real64 seek_start = HeadlessGetSeconds();
+    bool32 used_keyframe = ReplaySeek(&reader, &memory, seek_tick);
+    uint32 seek_frame_idx = reader.frame_idx;
+    while ((!memory.is_initialized || state->sim_tick < seek_tick) && ReplayNextFrame(&reader, &input)) {
+      UpdateGame(&thread, &memory, &input, &no_screen);
+      if (!diverged && !ReplayCheckTickHashes(&reader, state, &divergent_tick)) {
+        diverged = true;
+      }
+    }
+    real64 seek_ms = 1000.0 * (HeadlessGetSeconds() - seek_start);
+    printf("seeked to tick %llu in %.3fms: %s, then %u frames\n",
+           (unsigned long long)state->sim_tick, seek_ms,
+           used_keyframe ? "keyframe" : "no usable keyframe so from the start",
+           reader.frame_idx - seek_frame_idx);
+  }
+
+  uint32 first_frame_idx = reader.frame_idx;
+  real64 start = HeadlessGetSeconds();
+  while (ReplayNextFrame(&reader, &input)) {
+    UpdateGame(&thread, &memory, &input, &no_screen);
+    if (!diverged && !ReplayCheckTickHashes(&reader, state, &divergent_tick)) {
+      diverged = true;
+    }
+  }
+  real64 seconds = HeadlessGetSeconds() - start;
+
+  real64 recorded_seconds = (real64)header->end_sim_tick / header->sim_ticks_per_second;
+  printf("%u of %u frames (%.2f bytes each), %llu sim ticks in %.3fs (%.0fx real time)\n",
+         reader.frame_idx - first_frame_idx, header->frame_count,
+         (real64)file_size / (real64)Max(header->frame_count, 1),
+         (unsigned long long)state->sim_tick, seconds,
+         seconds > 0.0 ? recorded_seconds / seconds : 0.0);
+
+  if (diverged) {
+    printf("state first differs from the recording at tick %llu\n", (unsigned long long)divergent_tick);
+  }
+
+  // NOTE: the incremental board hash has to agree with one worked out from scratch
+  bool32 hash_is_current = (GameStateHash(state) == FullGameStateHash(state));
+  if (!hash_is_current) {
+    printf("incremental state hash has drifted from the board\n");
+  }
+
+  bool32 matches = (!diverged && hash_is_current &&
+                    reader.frame_idx == header->frame_count &&
+                    state->sim_tick == header->end_sim_tick &&
+                    state->score == header->end_score &&
+                    state->snake.length == header->end_length);
+  printf("%s: tick %llu/%llu, score %d/%d, length %d/%d (replayed/recorded)\n",
+         matches ? "replay matches" : "REPLAY DIVERGED",
+         (unsigned long long)state->sim_tick, (unsigned long long)header->end_sim_tick,
+         state->score, header->end_score, state->snake.length, header->end_length);
+  free(data);
+  return matches ? 0 : 1;
+}
+
+int
+main(int argc, char **argv) {
+  int32 game_count = 1024;
+  uint64 ticks_per_game = 100000;
+  int32 thread_count = (int32)sysconf(_SC_NPROCESSORS_ONLN);
+  uint64 seed = 8000;
+  bool32 use_autopilot = false;
+  char *record_filename = 0;
+  char *replay_filename = 0;
+  bool32 do_seek = false;
+  uint64 seek_tick = 0;
+  uint32 frame_count = 60 * 60;
+  GameConfig config = {};
+  config.tiles_x = 51;
+  config.tiles_y = 28;
+
+  for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+    char *arg = argv[arg_idx];
+    bool32 has_value = (arg_idx + 1 < argc);
+    if (strcmp(arg, "-games") == 0 && has_value) {
+      game_count = atoi(argv[++arg_idx]);
+    }
+    else if (strcmp(arg, "-ticks") == 0 && has_value) {
+      ticks_per_game = strtoull(argv[++arg_idx], 0, 10);
+    }
+    else if (strcmp(arg, "-threads") == 0 && has_value) {
+      thread_count = atoi(argv[++arg_idx]);
+    }
+    else if (strcmp(arg, "-seed") == 0 && has_value) {
+      seed = strtoull(argv[++arg_idx], 0, 10);
+    }
+    else if (strcmp(arg, "-size") == 0 && (arg_idx + 2 < argc)) {
+      config.tiles_x = atoi(argv[++arg_idx]);
+      config.tiles_y = atoi(argv[++arg_idx]);
+    }
+    else if (strcmp(arg, "-snakes") == 0 && has_value) {
+      config.swarm_snake_count = atoi(argv[++arg_idx]);
+    }
+    else if (strcmp(arg, "-autopilot") == 0) {
+      use_autopilot = true;
+    }
+    else if (strcmp(arg, "-record") == 0 && has_value) {
+      record_filename = argv[++arg_idx];
+    }
+    else if (strcmp(arg, "-replay") == 0 && has_value) {
+      replay_filename = argv[++arg_idx];
+    }
+    else if (strcmp(arg, "-seek") == 0 && has_value) {
+      do_seek = true;
+      seek_tick = strtoull(argv[++arg_idx], 0, 10);
+    }
+    else if (strcmp(arg, "-frames") == 0 && has_value) {
+      frame_count = (uint32)strtoul(argv[++arg_idx], 0, 10);
+    }
+    else {
+      fprintf(stderr, "usage: %s [-games N] [-ticks T] [-threads N] [-size W H] [-seed S] [-snakes N] [-autopilot]\n", argv[0]);
+      fprintf(stderr, "       %s -record FILE [-frames N] [-size W H] [-seed S] [-snakes N] [-autopilot]\n", argv[0]);
+      fprintf(stderr, "       %s -replay FILE [-seek TICK]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (replay_filename) {
+    return HeadlessPlayReplay(replay_filename, do_seek, seek_tick);
+  }
+  if (record_filename) {
+    return HeadlessRecordReplay(record_filename, frame_count, config, seed, use_autopilot);
+  }
+  thread_count = Max(1, thread_count);
+  game_count = Max(1, game_count);
+
+  // Enough for the board, snake ring and free tile index with plenty of slack. Pages we
+  // don't touch are never committed.
+  uint64 tile_count = (uint64)(config.tiles_x + 2) * (uint64)(config.tiles_y + 2);
+  uint64 permanent_storage_size = Megabytes(1) + (tile_count * 32) +
+                                  ((uint64)config.swarm_snake_count * Kilobytes(8));
+  uint64 temp_storage_size = Megabytes(1) + (tile_count * 2); // autopilot scratch
+
+  HeadlessRun run = {};
+  run.games = (HeadlessGame *)calloc(game_count, sizeof(HeadlessGame));
+  run.game_count = game_count;
+  run.ticks_per_game = ticks_per_game;
+
+  GameOffscreenBuffer no_screen = {};
+  for (int32 game_idx = 0; game_idx < game_count; ++game_idx) {
+    HeadlessGame *game = &run.games[game_idx];
+    GameMemory *memory = &game->memory;
+    memory->config = config;
+    // Same seed for every game but a different stream, so the sequences never overlap
+    memory->rand_seed = seed;
+    memory->rand_rounds = (uint64)game_idx;
+    memory->permanent_storage_size = permanent_storage_size;
+    memory->temp_storage_size = temp_storage_size;
+    memory->permanent_storage = HeadlessReserve(permanent_storage_size + temp_storage_size);
+    if (!memory->permanent_storage) {
+      fprintf(stderr, "failed to reserve memory for game %d\n", game_idx);
+      return 1;
+    }
+    memory->temp_storage = (uint8 *)memory->permanent_storage + permanent_storage_size;
+
+    game->state = (GameState *)memory->permanent_storage;
+    pcg32_srandom_r(&game->bot_rng, seed ^ 0xB07, (uint64)game_idx);
+
+    ThreadContext thread = {};
+    InitializeGame(memory, game->state, &no_screen);
+    ResetGame(&thread, memory, game->state);
+    game->state->game_running = true;
+    game->state->autopilot.enabled = use_autopilot;
+    memory->is_initialized = true;
+  }
+
+  printf("%d games on a %dx%d board, %llu ticks each, %d threads\n",
+         game_count, config.tiles_x, config.tiles_y,
+         (unsigned long long)ticks_per_game, thread_count);
+
+  real64 start = HeadlessGetSeconds();
+  pthread_t *threads = (pthread_t *)calloc(thread_count, sizeof(pthread_t));
+  for (int32 thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+    pthread_create(&threads[thread_idx], 0, HeadlessWorkerProc, &run);
+  }
+  for (int32 thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+    pthread_join(threads[thread_idx], 0);
+  }
+  real64 seconds = HeadlessGetSeconds() - start;
+
+  uint64 total_ticks = 0;
+  uint64 total_games = 0;
+  uint64 total_score = 0;
+  uint64 total_length = 0;
+  for (int32 game_idx = 0; game_idx < game_count; ++game_idx) {
+    HeadlessGame *game = &run.games[game_idx];
+    total_ticks += game->ticks;
+    total_games += game->games_finished;
+    total_score += game->total_score;
+    total_length += game->total_length;
+  }
+
+  printf("%.3fs, %.0f ticks/sec, %.0f games/sec, %llu games finished\n",
+         seconds, (real64)total_ticks / seconds, (real64)total_games / seconds,
+         (unsigned long long)total_games);
+  if (total_games) {
+    printf("avg score %.2f, avg length %.2f\n",
+           (real64)total_score / (real64)total_games,
+           (real64)total_length / (real64)total_games);
+  }
+
+  return 0;
+}
@@ -0,0 +1,145 @@
+/* Game code watcher on inotify. See win32_code_watch.cpp for the Windows one.
+ *
+ * Instead of the frame loop stat'ing snake_game.so every frame, a thread sleeps on an
+ * inotify watch of the directory the library lives in and sets reload_pending once a
+ * rebuild is done. All the frame loop does is take the flag with an atomic exchange, so
+ * checking for new code costs no syscalls at all.
+ *
+ * We watch the directory rather than the file because builds replace the file (a rename
+ * over it or unlink and create) and a watch on the old inode would go quiet.
+ *
+ * "Done" means the last thing that happened to the file was a close after writing or a
+ * rename onto it, and then nothing else happened for debounce_ms. A write with no close
+ * yet means the linker is still at it, however long that takes, so we never hand the
+ * loader a half written library.
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+struct LinuxCodeWatch {
+  uint32 volatile reload_pending; // set by the watcher, taken by the frame loop
+
+  int notify_handle;
+  char directory[4096];
+  char filename[256];
+  int32 debounce_ms;
+
+  // When the change we signaled for last happened, for measuring reload latency
+  uint64 volatile last_change_ns;
+  uint32 volatile reloads_signaled;
+};
+
+inline uint64
+LinuxCodeWatchClock() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  uint64 result = (uint64)spec.tv_sec * 1000000000ull + (uint64)spec.tv_nsec;
+  return result;
+}
+
+internal void *
+LinuxCodeWatchThreadProc(void *parameter) {
+  LinuxCodeWatch *watch = (LinuxCodeWatch *)parameter;
+
+  // NOTE: big enough for a burst of events, each with a name up to NAME_MAX
+  alignas(struct inotify_event) char buffer[64*1024];
+
+  bool32 write_finished = false;
+  uint64 change_ns = 0;
+  for (;;) {
+    struct pollfd poll_handle = {};
+    poll_handle.fd = watch->notify_handle;
+    poll_handle.events = POLLIN;
+    int ready = poll(&poll_handle, 1, write_finished ? watch->debounce_ms : -1);
+
+    if (ready > 0) {
+      ssize_t bytes_read = read(watch->notify_handle, buffer, sizeof(buffer));
+      if (bytes_read <= 0) {
+        if (bytes_read < 0 && errno == EINTR) {
+          continue;
+        }
+        break;
+      }
+      for (char *at = buffer; at < buffer + bytes_read;) {
+        struct inotify_event *event = (struct inotify_event *)at;
+        if (event->mask & IN_Q_OVERFLOW) {
+          // We don't know what we missed, so assume the worst and wait for quiet
+          write_finished = true;
+          change_ns = LinuxCodeWatchClock();
+        }
+        else if (event->len && strcmp(event->name, watch->filename) == 0) {
+          write_finished = (event->mask & (IN_CLOSE_WRITE|IN_MOVED_TO)) != 0;
+          change_ns = LinuxCodeWatchClock();
+        }
+        at += sizeof(struct inotify_event) + event->len;
+      }
+    }
+    else if (ready == 0) {
+      // Quiet for debounce_ms since the file was last closed
+      write_finished = false;
+      watch->last_change_ns = change_ns;
+      __atomic_add_fetch(&watch->reloads_signaled, 1, __ATOMIC_RELAXED);
+      __atomic_store_n(&watch->reload_pending, 1, __ATOMIC_RELEASE);
+    }
+    else if (errno != EINTR) {
+      break;
+    }
+  }
+  return 0;
+}
+
+/* Starts watching the file at path. Returns false if inotify isn't available, in which
+ * case the caller has to fall back to polling.
+ */
+internal bool32
+LinuxStartCodeWatch(LinuxCodeWatch *watch, char *path, int32 debounce_ms) {
+  bool32 result = false;
+
+  char *one_past_last_slash = path;
+  for (char *scan = path; *scan; ++scan) {
+    if (*scan == '/') {
+      one_past_last_slash = scan + 1;
+    }
+  }
+  size_t directory_length = (size_t)(one_past_last_slash - path);
+  if (directory_length == 0) {
+    directory_length = 2;
+    path = "./";
+  }
+  if (directory_length < sizeof(watch->directory) &&
+      strlen(one_past_last_slash) < sizeof(watch->filename)) {
+    memcpy(watch->directory, path, directory_length);
+    watch->directory[directory_length] = 0;
+    strcpy(watch->filename, one_past_last_slash);
+    watch->debounce_ms = debounce_ms;
+    watch->reload_pending = 0;
+
+    watch->notify_handle = inotify_init1(IN_CLOEXEC);
+    if (watch->notify_handle >= 0) {
+      uint32 event_mask = IN_CLOSE_WRITE|IN_MOVED_TO|IN_MODIFY|IN_CREATE;
+      if (inotify_add_watch(watch->notify_handle, watch->directory, event_mask) >= 0) {
+        pthread_t thread;
+        if (pthread_create(&thread, 0, LinuxCodeWatchThreadProc, watch) == 0) {
+          pthread_detach(thread);
+          result = true;
+        }
+      }
+      if (!result) {
+        close(watch->notify_handle);
+        watch->notify_handle = -1;
+      }
+    }
+  }
+  return result;
+}
+
+// Returns true once per finished rebuild. This is the only part the frame loop runs.
+inline bool32
+LinuxCodeWatchTakeReload(LinuxCodeWatch *watch) {
+  bool32 result = (__atomic_exchange_n(&watch->reload_pending, 0, __ATOMIC_ACQUIRE) != 0);
+  return result;
+}
@@ -0,0 +1,49 @@
+/* Linux half of the frame pacer. See snake_pacer.h.
+ *
+ * clock_nanosleep to an absolute time means the sleep doesn't drift by however long it
+ * took us to get to it, and we just go back to sleep when a signal wakes us early. The
+ * spin reads the clock through the vDSO, so it doesn't make syscalls either.
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <x86intrin.h>
+#include "snake_pacer.h"
+
+inline uint64
+LinuxPacerClock() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  uint64 result = (uint64)spec.tv_sec * 1000000000ull + (uint64)spec.tv_nsec;
+  return result;
+}
+
+/* Waits for deadline_ns on the CLOCK_MONOTONIC timeline. Returns when the wait ended,
+ * which is the start of the next frame.
+ */
+internal uint64
+LinuxWaitForFrame(FramePacer *pacer, uint64 deadline_ns) {
+  uint64 now = LinuxPacerClock();
+  bool32 missed = (now >= deadline_ns);
+  if (!missed) {
+    uint64 wake_ns = PacerWakeTime(pacer, deadline_ns);
+    if (now < wake_ns) {
+      struct timespec wake_spec;
+      wake_spec.tv_sec = (time_t)(wake_ns / 1000000000ull);
+      wake_spec.tv_nsec = (long)(wake_ns % 1000000000ull);
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_spec, 0) == EINTR) {
+      }
+      now = LinuxPacerClock();
+      PacerRecordSleep(pacer, wake_ns, now);
+    }
+
+    uint64 spin_start = now;
+    while (now < deadline_ns) {
+      _mm_pause();
+      now = LinuxPacerClock();
+    }
+    pacer->total_spin_ns += now - spin_start;
+  }
+  PacerRecordFrame(pacer, deadline_ns, now, missed);
+  return now;
+}
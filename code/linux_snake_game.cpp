@@ -0,0 +1,1419 @@
+// Linux platform layer. Mirrors win32_snake_game.cpp.
+
+/* The game lives in snake_game.so and is hot reloaded the same way as the dll on Windows:
+ * we load a copy so that the build can overwrite the original, and reload once a rebuild
+ * has finished. A watcher thread (linux_code_watch.cpp) notices that; the frame loop only
+ * checks a flag.
+ *
+ * Frames go to an X11 window through MIT-SHM when the server supports it (local servers
+ * and Xvfb do) and through plain XPutImage otherwise. With -offscreen, or when there's no
+ * display to connect to, nothing is presented at all and the game just runs, which is
+ * what we want when profiling with perf.
+ *
+ * -trace adds every timed block (snake_debug.h) to the telemetry log, for a Chrome trace.
+ * -overlay starts with the debug overlay (snake_debug_overlay.cpp) showing, which F1
+ * toggles. -capture writes the last frame drawn to a BMP on the way out, so an offscreen
+ * run can still be looked at.
+ *
+ * Usage: linux_snake [-snakes N] [-size W H] [-offscreen] [-frames N] [-trace] [-overlay]
+ *                    [-capture FILE]
+ */
+
+/* TODO Future Linux work
+
+   - Audio (ALSA or PulseAudio). GameGetSoundSamples isn't called yet.
+   - Gamepads (evdev)
+   - Window resizing and fullscreen
+   - Query the monitor refresh rate through XRandR instead of assuming 60 Hz
+
+   and more!
+*/
+
+#include "snake_game.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+// NOTE: XKBstr.h has a field called internal
+#undef internal
+#include <X11/XKBlib.h>
+#define internal static
+#include <X11/keysym.h>
+#include <X11/extensions/XShm.h>
+#include <x86intrin.h>
+#include "pcg_basic.h"
+
+#include "linux_snake_game.h"
+#include "linux_work_queue.cpp"
+#include "linux_code_watch.cpp"
+#include "linux_frame_pacer.cpp"
+#include "linux_telemetry.cpp"
+
+#if !defined(MAP_FIXED_NOREPLACE)
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+
+// ---------------------------------------------------------------------------------------
+// Game Globals
+// ---------------------------------------------------------------------------------------
+// TODO: global for now
+global_variable bool32 global_running;
+global_variable bool32 global_pause;
+global_variable LinuxOffscreenBuffer global_backbuffer;
+global_variable pcg32_random_t rng;
+
+// For the SIGSEGV handler, which has no other way to find it
+global_variable LinuxPlatformState *global_write_watch_state;
+
+// Set by LinuxTrapXError while we probe for something the server might refuse
+global_variable bool32 global_x_error;
+
+// ---------------------------------------------------------------------------------------
+// Utils
+// ---------------------------------------------------------------------------------------
+
+internal
+void LinuxGetEXEFilename(LinuxPlatformState *state) {
+  ssize_t size_of_current_filename = readlink("/proc/self/exe", state->exe_filename,
+                                              sizeof(state->exe_filename) - 1);
+  if (size_of_current_filename < 0) {
+    size_of_current_filename = 0;
+  }
+  state->exe_filename[size_of_current_filename] = 0;
+  state->one_past_last_exe_filename_slash = state->exe_filename;
+  for(char *scan = state->exe_filename; *scan; ++scan) {
+    if (*scan == '/') {
+      state->one_past_last_exe_filename_slash = scan + 1;
+    }
+  }
+}
+
+internal
+void LinuxRelativeEXEFilePath(LinuxPlatformState *state, char *filename, char *dest, int dest_count) {
+  ConcatStr(state->exe_filename,
+            state->one_past_last_exe_filename_slash - state->exe_filename,
+            filename, StrLen(filename),
+            dest, dest_count);
+}
+
+inline uint64
+LinuxGetWallClock() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  uint64 result = (uint64)spec.tv_sec * 1000000000ull + (uint64)spec.tv_nsec;
+  return result;
+}
+
+inline real32
+LinuxGetSecondsElapsed(uint64 start, uint64 end) {
+  real32 result = (real32)((real64)(end - start) / 1e9);
+  return result;
+}
+
+// Committed on first touch, zeroed, and page aligned
+internal void *
+LinuxAllocateMemory(uint64 size) {
+  void *result = mmap(0, (size_t)size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (result == MAP_FAILED) {
+    result = 0;
+  }
+  return result;
+}
+
+// write() can stop short, e.g. when interrupted
+internal bool32
+LinuxWriteAll(int file_handle, void *memory, uint64 size) {
+  uint8 *at = (uint8 *)memory;
+  while (size) {
+    ssize_t bytes_written = write(file_handle, at, (size_t)size);
+    if (bytes_written <= 0) {
+      if (bytes_written < 0 && errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    at += bytes_written;
+    size -= (uint64)bytes_written;
+  }
+  return (size == 0);
+}
+
+// ---------------------------------------------------------------------------------------
+// File I/O
+// ---------------------------------------------------------------------------------------
+
+#if SNAKE_INTERNAL
+DEBUG_PLATFORM_FREE_FILE_MEMORY(DEBUGPlatformFreeFileMemory) {
+  if (memory) {
+    free(memory);
+  }
+}
+
+DEBUG_PLATFORM_READ_ENTIRE_FILE(DEBUGPlatformReadEntireFile) {
+  DebugReadFileResult result = {};
+
+  int file_handle = open(filename, O_RDONLY);
+  if (file_handle >= 0) {
+    struct stat file_stat;
+    if (fstat(file_handle, &file_stat) == 0) {
+      uint32 file_size32 = SafeTruncateUInt64((uint64)file_stat.st_size);
+      result.content = malloc(file_size32 ? file_size32 : 1);
+
+      if (result.content) {
+        // Protect against the file being truncated in between getting the size and reading
+        ssize_t bytes_read = read(file_handle, result.content, file_size32);
+        if (bytes_read == (ssize_t)file_size32) {
+          /* NOTE: file read successfully */
+          result.content_size = file_size32;
+        }
+        else {
+          // TODO log error
+          DEBUGPlatformFreeFileMemory(thread, result.content);
+          result.content = 0;
+        }
+      }
+      else {
+        // TODO log error
+      }
+    }
+    else {
+      // TODO log error
+    }
+    close(file_handle);
+  }
+  else {
+    // TODO log error
+  }
+
+  return result;
+}
+
+DEBUG_PLATFORM_WRITE_ENTIRE_FILE(DEBUGPlatformWriteEntireFile) {
+  bool32 result = false;
+  int file_handle = open(filename, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  if (file_handle >= 0) {
+    /* NOTE: file written successfully */
+    result = LinuxWriteAll(file_handle, memory, memory_size);
+    close(file_handle);
+  }
+  else {
+    // TODO log error
+  }
+
+  return result;
+}
+#endif
+
+inline struct timespec
+LinuxGetLastFileWriteTime(char *filename) {
+  struct timespec last_write_time = {};
+  struct stat file_stat;
+  if (stat(filename, &file_stat) == 0) {
+    last_write_time = file_stat.st_mtim;
+  }
+  return last_write_time;
+}
+
+inline bool32
+LinuxFileTimesAreEqual(struct timespec a, struct timespec b) {
+  bool32 result = (a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec);
+  return result;
+}
+
+/* Unlinks dest before writing it so that the copy is a new file rather than the one we
+ * still have mapped. The loader also recognizes libraries by inode, so reusing the old
+ * one could hand us back the code we just unloaded.
+ */
+internal bool32
+LinuxCopyFile(char *source_name, char *dest_name) {
+  bool32 result = false;
+  int source_handle = open(source_name, O_RDONLY);
+  if (source_handle >= 0) {
+    unlink(dest_name);
+    int dest_handle = open(dest_name, O_WRONLY|O_CREAT|O_TRUNC, 0755);
+    if (dest_handle >= 0) {
+      result = true;
+      char buffer[64*1024];
+      for (;;) {
+        ssize_t bytes_read = read(source_handle, buffer, sizeof(buffer));
+        if (bytes_read < 0 && errno == EINTR) {
+          continue;
+        }
+        if (bytes_read <= 0) {
+          result = (bytes_read == 0);
+          break;
+        }
+        if (!LinuxWriteAll(dest_handle, buffer, (uint64)bytes_read)) {
+          result = false;
+          break;
+        }
+      }
+      close(dest_handle);
+    }
+    close(source_handle);
+  }
+  return result;
+}
+
+internal LinuxGameCode
+LinuxLoadGameCode(char *source_so_name, char *temp_so_name) {
+  LinuxGameCode result = {};
+
+  result.so_last_write_time = LinuxGetLastFileWriteTime(source_so_name);
+  if (LinuxCopyFile(source_so_name, temp_so_name)) {
+    result.game_code_so = dlopen(temp_so_name, RTLD_NOW|RTLD_LOCAL);
+  }
+
+  if (result.game_code_so) {
+    result.UpdateAndRender = (game_update_and_render *)dlsym(result.game_code_so, "GameUpdateAndRender");
+    result.GetSoundSamples = (game_get_sound_samples *)dlsym(result.game_code_so, "GameGetSoundSamples");
+
+    result.is_valid = (result.UpdateAndRender && result.GetSoundSamples);
+  }
+  else {
+    // TODO log error
+    char *error = dlerror();
+    if (error) {
+      fprintf(stderr, "Couldn't load game code: %s\n", error);
+    }
+  }
+
+  if (!result.is_valid) {
+    result.UpdateAndRender = 0;
+    result.GetSoundSamples = 0;
+  }
+
+  return result;
+}
+
+internal void
+LinuxUnloadGameCode(LinuxGameCode *game_code) {
+  if (game_code->game_code_so) {
+    dlclose(game_code->game_code_so);
+    game_code->game_code_so = 0;
+  }
+  game_code->is_valid = false;
+  game_code->UpdateAndRender = 0;
+  game_code->GetSoundSamples = 0;
+}
+
+// ---------------------------------------------------------------------------------------
+// Display
+// ---------------------------------------------------------------------------------------
+
+internal int
+LinuxTrapXError(Display *display, XErrorEvent *event) {
+  global_x_error = true;
+  return 0;
+}
+
+/* Tries to put the pixels in a shared memory segment the server maps too, so presenting
+ * is a copy on the server side instead of a trip through the socket. Remote displays
+ * refuse the attach, which only shows up as an async error, hence the sync and trap.
+ */
+internal bool32
+LinuxCreateShmImage(LinuxWindow *window, LinuxOffscreenBuffer *buffer, int32 width, int32 height) {
+  bool32 result = false;
+  if (XShmQueryExtension(window->display)) {
+    buffer->image = XShmCreateImage(window->display, window->visual, window->depth, ZPixmap, 0,
+                                    &buffer->shm_info, width, height);
+    if (buffer->image) {
+      int32 image_size = buffer->image->bytes_per_line * buffer->image->height;
+      buffer->shm_info.shmid = shmget(IPC_PRIVATE, image_size, IPC_CREAT|0600);
+      if (buffer->shm_info.shmid >= 0) {
+        buffer->shm_info.shmaddr = (char *)shmat(buffer->shm_info.shmid, 0, 0);
+        buffer->shm_info.readOnly = False;
+        buffer->image->data = buffer->shm_info.shmaddr;
+
+        if (buffer->shm_info.shmaddr != (char *)-1) {
+          global_x_error = false;
+          XErrorHandler old_handler = XSetErrorHandler(LinuxTrapXError);
+          XShmAttach(window->display, &buffer->shm_info);
+          XSync(window->display, False);
+          XSetErrorHandler(old_handler);
+          result = !global_x_error;
+          if (!result) {
+            shmdt(buffer->shm_info.shmaddr);
+          }
+        }
+        // NOTE: the segment goes away once both of us have detached, even if we crash
+        shmctl(buffer->shm_info.shmid, IPC_RMID, 0);
+      }
+      if (!result) {
+        buffer->image->data = 0;
+        XDestroyImage(buffer->image);
+        buffer->image = 0;
+      }
+    }
+  }
+  return result;
+}
+
+/* Pass a null window for offscreen mode. The pixels are then just memory that nobody
+ * looks at.
+ */
+internal void
+LinuxResizeBackbuffer(LinuxWindow *window, LinuxOffscreenBuffer *buffer, int32 width, int32 height) {
+  // TODO: free the old buffer once we support resizing
+  Assert(!buffer->memory);
+
+  int32 bytes_per_pixel = 4;
+
+  buffer->bytes_per_pixel = bytes_per_pixel;
+  buffer->width = width;
+  buffer->height = height;
+  buffer->pitch = width * buffer->bytes_per_pixel; // the width of buffer in bytes (also known as stride)
+
+  if (window && LinuxCreateShmImage(window, buffer, width, height)) {
+    buffer->uses_shm = true;
+    buffer->pitch = buffer->image->bytes_per_line;
+    buffer->memory = buffer->image->data;
+  }
+  else {
+    int32 bitmap_memory_size = width * height * buffer->bytes_per_pixel;
+    buffer->memory = LinuxAllocateMemory(bitmap_memory_size);
+    if (window && buffer->memory) {
+      // NOTE: XPutImage reads straight out of our memory, the image just describes it
+      buffer->image = XCreateImage(window->display, window->visual, window->depth, ZPixmap, 0,
+                                   (char *)buffer->memory, width, height, 32, buffer->pitch);
+    }
+  }
+}
+
+// Blits just [min, max) of the buffer 1-to-1, e.g. the part the game drew this frame.
+internal void
+LinuxRenderBufferRect(LinuxOffscreenBuffer *buffer, LinuxWindow *window,
+                      int32 min_x, int32 min_y, int32 max_x, int32 max_y) {
+  if (buffer->image && min_x < max_x && min_y < max_y) {
+    if (buffer->uses_shm) {
+      XShmPutImage(window->display, window->window, window->gc, buffer->image,
+                   min_x, min_y, min_x, min_y, max_x - min_x, max_y - min_y, False);
+    }
+    else {
+      XPutImage(window->display, window->window, window->gc, buffer->image,
+                min_x, min_y, min_x, min_y, max_x - min_x, max_y - min_y);
+    }
+    // NOTE: the server reads shared pixels whenever it gets around to it, so we have to
+    // wait for it before the game draws over them
+    XSync(window->display, False);
+  }
+}
+
+internal void
+LinuxRenderBuffer(LinuxOffscreenBuffer *buffer, LinuxWindow *window) {
+  LinuxRenderBufferRect(buffer, window, 0, 0, buffer->width, buffer->height);
+}
+
+// Writes the backbuffer out as a 32-bit BMP. Returns whether all of it got written.
+internal bool32
+LinuxWriteCapture(LinuxOffscreenBuffer *buffer, char *path) {
+  bool32 result = false;
+  int file_handle = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+  if (file_handle >= 0) {
+    uint32 row_size = buffer->width * sizeof(uint32);
+    LinuxBitmapHeader header = {};
+    header.file_type = 0x4D42; // "BM"
+    header.bitmap_offset = sizeof(header);
+    header.file_size = header.bitmap_offset + row_size * buffer->height;
+    header.size = sizeof(header) - 14;
+    header.width = buffer->width;
+    // NOTE: a negative height means the rows go top down, like ours
+    header.height = -buffer->height;
+    header.planes = 1;
+    header.bits_per_pixel = 32;
+    header.size_of_bitmap = row_size * buffer->height;
+
+    // NOTE: our BB GG RR XX pixels are what BMP stores too
+    result = LinuxWriteAll(file_handle, &header, sizeof(header));
+    uint8 *row = (uint8 *)buffer->memory;
+    for (int32 y = 0; result && y < buffer->height; ++y) {
+      result = LinuxWriteAll(file_handle, row, row_size);
+      row += buffer->pitch;
+    }
+    close(file_handle);
+  }
+  return result;
+}
+
+internal bool32
+LinuxOpenWindow(LinuxWindow *window, int32 width, int32 height) {
+  bool32 result = false;
+  window->display = XOpenDisplay(0);
+  if (window->display) {
+    int screen = DefaultScreen(window->display);
+    XVisualInfo visual_info;
+    if (XMatchVisualInfo(window->display, screen, 24, TrueColor, &visual_info)) {
+      window->visual = visual_info.visual;
+      window->depth = visual_info.depth;
+
+      Window root = RootWindow(window->display, screen);
+      XSetWindowAttributes attributes = {};
+      attributes.colormap = XCreateColormap(window->display, root, window->visual, AllocNone);
+      attributes.background_pixel = 0;
+      attributes.border_pixel = 0;
+      attributes.event_mask = KeyPressMask|KeyReleaseMask|ExposureMask|StructureNotifyMask|FocusChangeMask;
+
+      window->window = XCreateWindow(window->display, root, 0, 0, width, height, 0,
+                                     window->depth, InputOutput, window->visual,
+                                     CWColormap|CWBackPixel|CWBorderPixel|CWEventMask, &attributes);
+      if (window->window) {
+        XStoreName(window->display, window->window, "Snake");
+
+        // NOTE: otherwise the window manager just kills us when the window is closed
+        window->wm_delete_window = XInternAtom(window->display, "WM_DELETE_WINDOW", False);
+        XSetWMProtocols(window->display, window->window, &window->wm_delete_window, 1);
+
+        // Key repeats come in as presses without the releases in between
+        XkbSetDetectableAutoRepeat(window->display, True, 0);
+
+        window->gc = XCreateGC(window->display, window->window, 0, 0);
+        XMapWindow(window->display, window->window);
+        XFlush(window->display);
+        result = true;
+      }
+    }
+    if (!result) {
+      XCloseDisplay(window->display);
+      window->display = 0;
+    }
+  }
+  return result;
+}
+
+// ---------------------------------------------------------------------------------------
+// Input
+// ---------------------------------------------------------------------------------------
+
+internal void
+LinuxProcessInputMessage(GameButtonState *new_state, bool32 is_down) {
+  // Only update when the state changes
+  if (new_state->ended_down != is_down) {
+    new_state->ended_down = is_down;
+    ++new_state->half_transition_count;
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Replays
+// ---------------------------------------------------------------------------------------
+
+/* Makes the faulting page writable and notes that it was written. Anything that isn't a
+ * write to the read only game store is a real crash: we put the default handler back and
+ * let the instruction fault again.
+ *
+ * NOTE: the kernel can't fault on our behalf, so a syscall like read() into a page that is
+ * still read only fails with EFAULT instead of landing here. Nothing reads into the game
+ * store directly at the moment.
+ *
+ * In gdb, `handle SIGSEGV nostop noprint` keeps these out of the way.
+ */
+internal void
+LinuxWriteWatchHandler(int signal_number, siginfo_t *info, void *context) {
+  LinuxPlatformState *state = global_write_watch_state;
+  uint8 *address = (uint8 *)info->si_addr;
+  uint8 *store = (uint8 *)state->game_store_block;
+  if (address >= store && address < store + state->total_size) {
+    uint64 page_idx = (uint64)(address - store) / state->page_size;
+    __atomic_fetch_or(&state->written_pages[page_idx >> 6], (1ull << (page_idx & 63)), __ATOMIC_RELAXED);
+    if (mprotect(store + page_idx * state->page_size, state->page_size, PROT_READ|PROT_WRITE) != 0) {
+      // NOTE: every page we unprotect can split the mapping, and there's a limit on how
+      // many pieces a process can have. Give up watching until the next reset.
+      state->write_watch_failed = true;
+      mprotect(store, (size_t)state->total_size, PROT_READ|PROT_WRITE);
+    }
+  }
+  else {
+    signal(signal_number, SIG_DFL);
+  }
+}
+
+// Forgets which pages were written and starts watching again
+internal void
+LinuxResetWriteWatch(LinuxPlatformState *state) {
+  state->write_watch_failed = false;
+  for (uint64 word_idx = 0; word_idx < state->dirty_page_word_count; ++word_idx) {
+    state->written_pages[word_idx] = 0;
+  }
+  mprotect(state->game_store_block, (size_t)state->total_size, PROT_READ);
+}
+
+internal bool32
+LinuxStartWriteWatch(LinuxPlatformState *state) {
+  global_write_watch_state = state;
+
+  struct sigaction action = {};
+  action.sa_sigaction = LinuxWriteWatchHandler;
+  action.sa_flags = SA_SIGINFO|SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  bool32 result = (sigaction(SIGSEGV, &action, 0) == 0);
+  if (result) {
+    LinuxResetWriteWatch(state);
+  }
+  return result;
+}
+
+internal void
+LinuxGetInputFileLocation(LinuxPlatformState *state, int slot_index, char *dest, int dest_count) {
+  char temp[64];
+  snprintf(temp, sizeof(temp), "loop_recording_%d.hmi", slot_index);
+  LinuxRelativeEXEFilePath(state, temp, dest, dest_count);
+}
+
+internal LinuxReplayBuffer *
+LinuxGetReplayBuffer(LinuxPlatformState *state, int unsigned index) {
+  Assert(index < ArrayCount(state->replay_buffers));
+  LinuxReplayBuffer *replay = &state->replay_buffers[index];
+  return replay;
+}
+
+/* The backing file and mapping are only created the first time a slot is recorded into
+ * instead of for every slot at startup. A fresh file reads as zeros just like the fresh
+ * game store did, so the buffer starts out in sync with every page the game hasn't
+ * written to yet, and touched_pages knows about the rest.
+ */
+internal LinuxReplayBuffer *
+LinuxOpenReplayBuffer(LinuxPlatformState *state, int unsigned index) {
+  LinuxReplayBuffer *replay_buffer = LinuxGetReplayBuffer(state, index);
+  if (!replay_buffer->memory_block) {
+    LinuxGetInputFileLocation(state, index, replay_buffer->filename, sizeof(replay_buffer->filename));
+
+    replay_buffer->file_handle = open(replay_buffer->filename, O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if (replay_buffer->file_handle >= 0 &&
+        ftruncate(replay_buffer->file_handle, (off_t)state->total_size) == 0) {
+      replay_buffer->memory_block = mmap(0, (size_t)state->total_size, PROT_READ|PROT_WRITE,
+                                         MAP_SHARED, replay_buffer->file_handle, 0);
+      if (replay_buffer->memory_block == MAP_FAILED) {
+        replay_buffer->memory_block = 0;
+      }
+    }
+
+    replay_buffer->dirty_pages = (uint64 *)LinuxAllocateMemory(state->dirty_page_word_count * sizeof(uint64));
+
+    if (!replay_buffer->memory_block || !replay_buffer->dirty_pages) {
+      // TODO diagnostic
+      replay_buffer->memory_block = 0;
+    }
+    else {
+      for (uint64 word_idx = 0; word_idx < state->dirty_page_word_count; ++word_idx) {
+        replay_buffer->dirty_pages[word_idx] = state->touched_pages[word_idx];
+      }
+    }
+  }
+  return replay_buffer;
+}
+
+inline void
+LinuxMarkPageDirty(LinuxReplayBuffer *replay_buffer, uint64 page_idx) {
+  replay_buffer->dirty_pages[page_idx >> 6] |= (1ull << (page_idx & 63));
+}
+
+/* Takes the pages of the game store that were written since the last call and marks them
+ * dirty in every open replay buffer.
+ */
+internal void
+LinuxCollectWrittenPages(LinuxPlatformState *state) {
+  if (state->write_watch_failed) {
+    // TODO diagnostic. We lost track of what was written so treat everything as dirty.
+    for (uint64 page_idx = 0; page_idx < state->page_count; ++page_idx) {
+      state->written_pages[page_idx >> 6] |= (1ull << (page_idx & 63));
+    }
+  }
+  for (uint64 word_idx = 0; word_idx < state->dirty_page_word_count; ++word_idx) {
+    state->touched_pages[word_idx] |= state->written_pages[word_idx];
+  }
+  for (int replay_index = 0;
+       replay_index < ArrayCount(state->replay_buffers);
+       ++replay_index) {
+    LinuxReplayBuffer *replay_buffer = LinuxGetReplayBuffer(state, replay_index);
+    if (replay_buffer->memory_block) {
+      for (uint64 word_idx = 0; word_idx < state->dirty_page_word_count; ++word_idx) {
+        replay_buffer->dirty_pages[word_idx] |= state->written_pages[word_idx];
+      }
+    }
+  }
+  LinuxResetWriteWatch(state);
+}
+
+/* Copies the buffer's dirty pages from source to dest, merging neighboring pages into one
+ * copy, and clears them. Returns the number of pages copied.
+ */
+internal uint64
+LinuxCopyDirtyPages(LinuxPlatformState *state, LinuxReplayBuffer *replay_buffer, void *dest, void *source) {
+  uint64 pages_copied = 0;
+  uint64 run_start = 0;
+  uint64 run_count = 0;
+  for (uint64 word_idx = 0; word_idx < state->dirty_page_word_count; ++word_idx) {
+    uint64 word = replay_buffer->dirty_pages[word_idx];
+    for (uint64 bit_idx = 0; bit_idx < 64; ++bit_idx) {
+      uint64 page_idx = (word_idx << 6) + bit_idx;
+      bool32 is_dirty = (word >> bit_idx) & 1;
+      if (is_dirty && run_count && (run_start + run_count == page_idx)) {
+        ++run_count;
+      }
+      else {
+        if (run_count) {
+          uint64 offset = run_start * state->page_size;
+          memcpy((uint8 *)dest + offset, (uint8 *)source + offset, run_count * state->page_size);
+          pages_copied += run_count;
+          run_count = 0;
+        }
+        if (is_dirty) {
+          run_start = page_idx;
+          run_count = 1;
+        }
+      }
+      if (!word) {
+        break; // NOTE: nothing else in this word and any run was just flushed
+      }
+    }
+    replay_buffer->dirty_pages[word_idx] = 0;
+  }
+  if (run_count) {
+    uint64 offset = run_start * state->page_size;
+    memcpy((uint8 *)dest + offset, (uint8 *)source + offset, run_count * state->page_size);
+    pages_copied += run_count;
+  }
+  return pages_copied;
+}
+
+/* Starts a loop. Instead of copying the whole game store (more than half a gig, almost all
+ * of it untouched) into the slot, only the pages written since the slot last matched the
+ * store are copied.
+ */
+internal void
+LinuxStartRecordingInput(LinuxPlatformState *state, int input_recording_index) {
+  LinuxReplayBuffer *replay_buffer = LinuxOpenReplayBuffer(state, input_recording_index);
+  if (replay_buffer->memory_block) {
+    state->input_recording_index = input_recording_index;
+    state->recording_handle = replay_buffer->file_handle;
+
+    // Move file pointer
+    lseek(state->recording_handle, (off_t)state->total_size, SEEK_SET);
+
+    LinuxCollectWrittenPages(state);
+    uint64 pages_copied = LinuxCopyDirtyPages(state, replay_buffer,
+                                              replay_buffer->memory_block, state->game_store_block);
+
+    printf("Loop snapshot: %llu of %llu pages\n",
+           (unsigned long long)pages_copied, (unsigned long long)state->page_count);
+  }
+}
+
+internal void
+LinuxStopRecordingInput(LinuxPlatformState *state) {
+  state->input_recording_index = 0;
+}
+
+/* Rewinds the game store to the slot's snapshot. Only the pages the game touched since
+ * then are copied back. Those same pages now differ from every other slot, so they get
+ * marked dirty there, and the write watch is reset so our own copy doesn't show up as a
+ * game write next time.
+ */
+internal void
+LinuxStartInputPlayback(LinuxPlatformState *state, int input_playback_index) {
+  LinuxReplayBuffer *replay_buffer = LinuxGetReplayBuffer(state, input_playback_index);
+  if (replay_buffer->memory_block) {
+    state->input_playback_index = input_playback_index;
+    state->playback_handle = replay_buffer->file_handle;
+
+    // Move file pointer
+    lseek(state->playback_handle, (off_t)state->total_size, SEEK_SET);
+
+    LinuxCollectWrittenPages(state);
+    for (int replay_index = 0;
+         replay_index < ArrayCount(state->replay_buffers);
+         ++replay_index) {
+      LinuxReplayBuffer *other_buffer = LinuxGetReplayBuffer(state, replay_index);
+      if (other_buffer != replay_buffer && other_buffer->memory_block) {
+        for (uint64 word_idx = 0; word_idx < state->dirty_page_word_count; ++word_idx) {
+          other_buffer->dirty_pages[word_idx] |= replay_buffer->dirty_pages[word_idx];
+        }
+      }
+    }
+    LinuxCopyDirtyPages(state, replay_buffer, state->game_store_block, replay_buffer->memory_block);
+    LinuxResetWriteWatch(state);
+
+    // The game's idea of what's on screen went back in time with the rest of it
+    state->screen_needs_full_repaint = true;
+  }
+}
+
+internal void
+LinuxStopInputPlayback(LinuxPlatformState *state) {
+  state->input_playback_index = 0;
+}
+
+internal void
+LinuxRecordInput(LinuxPlatformState *state, GameInput *input) {
+  LinuxWriteAll(state->recording_handle, input, sizeof(*input));
+}
+
+/* Starts a replay of a brand new game. Unlike the loop above this doesn't snapshot memory:
+ * the game gets a new seed and is reinitialized, and the header records enough to do the
+ * same on playback. The file can be played back with `headless_snake -replay`.
+ */
+internal void
+LinuxStartGameReplay(LinuxPlatformState *state, GameMemory *memory, int32 screen_width, int32 screen_height) {
+  ReplayWriter *writer = &state->game_replay;
+  if (!writer->chunk) {
+    // NOTE: a keyframe can be as big as all of permanent storage, but only the part the
+    // game uses is ever touched.
+    writer->max_keyframe_size = (uint32)memory->permanent_storage_size;
+    writer->max_keyframes = 4096; // 11 hours of keyframes at 60 fps
+    writer->last_keyframe = (uint8 *)LinuxAllocateMemory(writer->max_keyframe_size);
+    writer->chunk = (uint8 *)LinuxAllocateMemory(ReplayChunkSize(writer->max_keyframe_size));
+    writer->keyframes = (ReplayKeyframe *)LinuxAllocateMemory(writer->max_keyframes * sizeof(ReplayKeyframe));
+    if (!writer->last_keyframe || !writer->keyframes) {
+      // TODO diagnostic
+      writer->chunk = 0;
+    }
+  }
+
+  char replay_name[] = "snake_replay.snr";
+  char filename[LINUX_STATE_FILE_NAME_COUNT];
+  LinuxRelativeEXEFilePath(state, replay_name, filename, sizeof(filename));
+  state->game_replay_handle = writer->chunk ? open(filename, O_WRONLY|O_CREAT|O_TRUNC, 0644) : -1;
+  if (state->game_replay_handle >= 0) {
+    memory->rand_seed ^= LinuxGetWallClock();
+    memory->is_initialized = false;
+
+    BeginReplay(writer, memory, screen_width, screen_height);
+    LinuxWriteAll(state->game_replay_handle, &writer->header, sizeof(writer->header));
+  }
+  else {
+    state->game_replay_handle = 0;
+  }
+}
+
+internal void
+LinuxRecordGameReplayFrame(LinuxPlatformState *state, GameMemory *memory, GameInput *input) {
+  ReplayWriter *writer = &state->game_replay;
+  uint64 chunk_size = ReplayRecordFrame(writer, memory, input);
+  LinuxWriteAll(state->game_replay_handle, writer->chunk, chunk_size);
+}
+
+internal void
+LinuxStopGameReplay(LinuxPlatformState *state, GameMemory *memory) {
+  ReplayWriter *writer = &state->game_replay;
+  EndReplay(writer, memory);
+  LinuxWriteAll(state->game_replay_handle, writer->keyframes,
+                writer->header.keyframe_count * sizeof(ReplayKeyframe));
+
+  // NOTE: rewrite the header now that we know where the game ended up
+  pwrite(state->game_replay_handle, &writer->header, sizeof(writer->header), 0);
+  close(state->game_replay_handle);
+  state->game_replay_handle = 0;
+}
+
+internal void
+LinuxPlaybackInput(LinuxPlatformState *state, GameInput *input) {
+  ssize_t bytes_read = read(state->playback_handle, input, sizeof(*input));
+  if (bytes_read == 0) {
+    // NOTE: hit the end of the stream so go back to beginning.
+    LinuxStartInputPlayback(state, state->input_playback_index);
+    read(state->playback_handle, input, sizeof(*input));
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Events
+// ---------------------------------------------------------------------------------------
+
+internal void
+LinuxProcessKeyboard(LinuxPlatformState *state,
+                     GameControllerInput *keyboard_controller,
+                     LinuxInputSnapshot *input_snapshot) {
+  bool32 is_down = input_snapshot->is_down;
+  // stop key repeats
+  if (input_snapshot->was_down != is_down) {
+    switch(input_snapshot->key_sym) {
+      case XK_w: {
+        LinuxProcessInputMessage(&keyboard_controller->move_up, is_down);
+      } break;
+      case XK_a: {
+        LinuxProcessInputMessage(&keyboard_controller->move_left, is_down);
+      } break;
+      case XK_s: {
+        LinuxProcessInputMessage(&keyboard_controller->move_down, is_down);
+      } break;
+      case XK_d: {
+        LinuxProcessInputMessage(&keyboard_controller->move_right, is_down);
+      } break;
+      case XK_q: {
+        LinuxProcessInputMessage(&keyboard_controller->left_shoulder, is_down);
+      } break;
+      case XK_e: {
+        LinuxProcessInputMessage(&keyboard_controller->right_shoulder, is_down);
+      } break;
+      case XK_Up: {
+        LinuxProcessInputMessage(&keyboard_controller->action_up, is_down);
+      } break;
+      case XK_Left: {
+        LinuxProcessInputMessage(&keyboard_controller->action_left, is_down);
+      } break;
+      case XK_Down: {
+        LinuxProcessInputMessage(&keyboard_controller->action_down, is_down);
+      } break;
+      case XK_Right: {
+        LinuxProcessInputMessage(&keyboard_controller->action_right, is_down);
+      } break;
+      case XK_space: {
+        LinuxProcessInputMessage(&keyboard_controller->start, is_down);
+      } break;
+      case XK_BackSpace: {
+        LinuxProcessInputMessage(&keyboard_controller->back, is_down);
+      } break;
+      case XK_Escape: {
+        global_running = false;
+      } break;
+      case XK_p: {
+        if (is_down) {
+          global_pause = !global_pause;
+        }
+      } break;
+      case XK_r: {
+        if (is_down) {
+          state->game_replay_toggle_requested = true;
+        }
+      } break;
+      case XK_F1: {
+        if (is_down) {
+          state->debug_overlay_toggle_requested = true;
+        }
+      } break;
+      case XK_l: {
+        if (is_down) {
+          if (state->input_playback_index == 0) {
+            if (state->input_recording_index == 0) {
+              Assert(state->input_playback_index == 0);
+              LinuxStartRecordingInput(state, 1);
+            }
+            else {
+              LinuxStopRecordingInput(state);
+              LinuxStartInputPlayback(state, 1);
+            }
+          }
+          else {
+            LinuxStopInputPlayback(state);
+          }
+        }
+      } break;
+
+      case XK_F4: {
+        if (input_snapshot->alt_is_down) {
+          global_running = false;
+        }
+      } break;
+    }
+  }
+}
+
+internal void
+LinuxProcessPendingMessages(LinuxPlatformState *state, LinuxWindow *window,
+                            GameControllerInput *keyboard_controller) {
+  // Don't block in XNextEvent since we want to use the idle time
+  while (XPending(window->display)) {
+    XEvent event;
+    XNextEvent(window->display, &event);
+    switch (event.type) {
+      case ClientMessage: {
+        if ((Atom)event.xclient.data.l[0] == window->wm_delete_window) {
+          global_running = false;
+        }
+      } break;
+
+      case DestroyNotify: {
+        global_running = false;
+      } break;
+
+      case Expose: {
+        // Only repaint once the last expose in the batch arrives
+        if (event.xexpose.count == 0) {
+          LinuxRenderBuffer(&global_backbuffer, window);
+        }
+      } break;
+
+      case FocusOut: {
+        // NOTE: we won't see the releases for anything held while unfocused
+        for (int32 key_idx = 0; key_idx < ArrayCount(state->keys_down); ++key_idx) {
+          state->keys_down[key_idx] = 0;
+        }
+        for (int32 button_idx = 0;
+             button_idx < ArrayCount(keyboard_controller->buttons);
+             ++button_idx) {
+          LinuxProcessInputMessage(&keyboard_controller->buttons[button_idx], false);
+        }
+      } break;
+
+      case KeyPress:
+      case KeyRelease: {
+        uint32 key_code = event.xkey.keycode & 0xFF;
+        LinuxInputSnapshot input_snapshot = {};
+        input_snapshot.key_sym = XLookupKeysym(&event.xkey, 0);
+        input_snapshot.was_down = state->keys_down[key_code];
+        input_snapshot.is_down = (event.type == KeyPress);
+        input_snapshot.alt_is_down = (event.xkey.state & Mod1Mask);
+        state->keys_down[key_code] = (uint8)input_snapshot.is_down;
+
+        LinuxProcessKeyboard(state, keyboard_controller, &input_snapshot);
+      } break;
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Main
+// ---------------------------------------------------------------------------------------
+
+int
+main(int argc, char **argv) {
+  // Seed the random number generator
+  int rounds = 1;
+  uint64 rand_seed = LinuxGetWallClock() ^ (uint64)(intptr_t)&printf;
+  uint64 rand_rounds = (uint64)(intptr_t)&rounds;
+  pcg32_srandom_r(&rng, rand_seed, rand_rounds);
+  printf("Rand seed: %llu, Rand rounds: %llu\n",
+         (unsigned long long)rand_seed, (unsigned long long)rand_rounds);
+
+  bool32 offscreen = false;
+  int32 frame_limit = 0;
+  char *capture_filename = 0;
+  int32 screen_width = 1280;
+  int32 screen_height = 720;
+
+  // Initialize game memory
+  // TODO create different memory profiles based on the type of computer running this
+  GameMemory game_store = {};
+
+  game_store.rand_seed = rand_seed;
+  game_store.rand_rounds = rand_rounds;
+
+  for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+    char *arg = argv[arg_idx];
+    bool32 has_value = (arg_idx + 1 < argc);
+    if (strcmp(arg, "-snakes") == 0 && has_value) {
+      // NOTE: plays the swarm mode with the keyboard on snake 0
+      game_store.config.swarm_snake_count = atoi(argv[++arg_idx]);
+      game_store.config.swarm_human_count = 1;
+    }
+    else if (strcmp(arg, "-size") == 0 && arg_idx + 2 < argc) {
+      screen_width = atoi(argv[++arg_idx]);
+      screen_height = atoi(argv[++arg_idx]);
+    }
+    else if (strcmp(arg, "-offscreen") == 0) {
+      offscreen = true;
+    }
+    else if (strcmp(arg, "-frames") == 0 && has_value) {
+      frame_limit = atoi(argv[++arg_idx]);
+    }
+    else if (strcmp(arg, "-capture") == 0 && has_value) {
+      capture_filename = argv[++arg_idx];
+    }
+#if SNAKE_INTERNAL
+    else if (strcmp(arg, "-trace") == 0) {
+      game_store.debug_table.trace_enabled = true;
+    }
+    else if (strcmp(arg, "-overlay") == 0) {
+      game_store.debug_table.overlay_enabled = true;
+    }
+#endif
+    else {
+      fprintf(stderr, "usage: %s [-snakes N] [-size W H] [-offscreen] [-frames N] [-trace] [-overlay] [-capture FILE]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (screen_width <= 0 || screen_height <= 0) {
+    fprintf(stderr, "bad screen size %dx%d\n", screen_width, screen_height);
+    return 1;
+  }
+
+  LinuxWindow window = {};
+  if (!offscreen && !LinuxOpenWindow(&window, screen_width, screen_height)) {
+    fprintf(stderr, "Couldn't open a window, running offscreen\n");
+    offscreen = true;
+  }
+  LinuxWindow *present_window = offscreen ? 0 : &window;
+  LinuxResizeBackbuffer(present_window, &global_backbuffer, screen_width, screen_height);
+
+  // NOTE: the game runs its sim at a fixed rate internally so we're free to render at
+  // the full monitor refresh rate.
+  int monitor_refresh_hz = 60;
+  real32 game_update_hz = (real32)monitor_refresh_hz;
+  real32 target_seconds_per_frame = 1.0f / game_update_hz;
+  uint64 target_ns_per_frame = (uint64)(1e9f * target_seconds_per_frame);
+
+#if SNAKE_INTERNAL
+  void *base_address = (void *)Terabytes(2);
+#else
+  void *base_address = 0;
+#endif
+
+  // Initialize state
+  LinuxPlatformState linux_state = {};
+  LinuxGetEXEFilename(&linux_state);
+
+  char source_game_code_so_full_path[LINUX_STATE_FILE_NAME_COUNT];
+  char temp_game_code_so_full_path[LINUX_STATE_FILE_NAME_COUNT];
+  LinuxRelativeEXEFilePath(&linux_state, "snake_game.so", source_game_code_so_full_path, sizeof(source_game_code_so_full_path));
+  LinuxRelativeEXEFilePath(&linux_state, "snake_game_temp.so", temp_game_code_so_full_path, sizeof(temp_game_code_so_full_path));
+
+#if SNAKE_INTERNAL
+  game_store.DEBUGPlatformReadEntireFile = DEBUGPlatformReadEntireFile;
+  game_store.DEBUGPlatformWriteEntireFile = DEBUGPlatformWriteEntireFile;
+  game_store.DEBUGPlatformFreeFileMemory = DEBUGPlatformFreeFileMemory;
+
+  // NOTE: the game code points its own at the same table every frame
+  global_debug_table = &game_store.debug_table;
+  game_store.debug_table.target_seconds_per_frame = target_seconds_per_frame;
+#endif
+
+  // NOTE: the board, snake body and free tile index are all carved out of permanent
+  // storage. 256 MB is enough for a 4096x4096 board with a snake covering all of it.
+  game_store.permanent_storage_size = Megabytes(256);
+  game_store.temp_storage_size = Megabytes(500); // NOTE: Reduced from 1 GB strictly for live loop editing performance
+
+  // NOTE: only reserved. Pages are backed as the game touches them. The fixed address
+  // keeps pointers inside the store valid across loop snapshots and runs; if something
+  // already lives there we take whatever the kernel gives us instead.
+  // TODO: add support for huge pages
+  linux_state.total_size = game_store.permanent_storage_size + game_store.temp_storage_size;
+  int map_flags = MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE;
+  linux_state.game_store_block = MAP_FAILED;
+  if (base_address) {
+    linux_state.game_store_block = mmap(base_address, (size_t)linux_state.total_size, PROT_READ|PROT_WRITE,
+                                        map_flags|MAP_FIXED_NOREPLACE, -1, 0);
+  }
+  if (linux_state.game_store_block == MAP_FAILED) {
+    linux_state.game_store_block = mmap(0, (size_t)linux_state.total_size, PROT_READ|PROT_WRITE,
+                                        map_flags, -1, 0);
+  }
+  if (linux_state.game_store_block == MAP_FAILED) {
+    linux_state.game_store_block = 0;
+  }
+
+  game_store.permanent_storage = linux_state.game_store_block;
+  game_store.temp_storage = ((uint8 *)game_store.permanent_storage +
+      game_store.permanent_storage_size);
+
+  linux_state.page_size = (uint32)sysconf(_SC_PAGESIZE);
+  linux_state.page_count = (linux_state.total_size + linux_state.page_size - 1) / linux_state.page_size;
+  linux_state.dirty_page_word_count = (linux_state.page_count + 63) / 64;
+  linux_state.written_pages = (uint64 *)LinuxAllocateMemory(linux_state.dirty_page_word_count * sizeof(uint64));
+  linux_state.touched_pages = (uint64 *)LinuxAllocateMemory(linux_state.dirty_page_word_count * sizeof(uint64));
+
+  // NOTE: one worker for every core besides this one, which helps out while it waits
+  long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+  PlatformWorkQueue render_queue = {};
+  LinuxMakeQueue(&render_queue, (core_count > 1) ? (uint32)(core_count - 1) : 0);
+  game_store.render_queue = &render_queue;
+  game_store.PlatformAddEntry = LinuxAddEntry;
+  game_store.PlatformCompleteAllWork = LinuxCompleteAllWork;
+
+  FramePacer pacer;
+  InitFramePacer(&pacer, target_ns_per_frame);
+
+  // NOTE: per frame stats go to snake_telemetry.bin next to the executable. Run
+  // snake_telemetry_tool on it to read them.
+  LinuxTelemetry *telemetry = (LinuxTelemetry *)LinuxAllocateMemory(sizeof(LinuxTelemetry));
+  if (telemetry) {
+    char telemetry_full_path[LINUX_STATE_FILE_NAME_COUNT];
+    LinuxRelativeEXEFilePath(&linux_state, "snake_telemetry.bin", telemetry_full_path, sizeof(telemetry_full_path));
+    LinuxStartTelemetry(telemetry, telemetry_full_path);
+  }
+
+  if (game_store.permanent_storage && linux_state.written_pages && linux_state.touched_pages &&
+      global_backbuffer.memory &&
+      LinuxStartWriteWatch(&linux_state)) {
+    global_running = true;
+    global_pause = false;
+
+    GameInput input[2] = {};
+    GameInput *new_input = &input[0];
+    GameInput *old_input = &input[1];
+
+    // Start tracking time
+    uint64 last_counter = LinuxGetWallClock();
+
+    // NOTE: watch before the first load so that a build landing in between isn't missed.
+    // Without inotify we fall back to comparing write times every frame.
+    LinuxCodeWatch code_watch = {};
+    bool32 code_watch_active = LinuxStartCodeWatch(&code_watch, source_game_code_so_full_path, 50);
+    LinuxGameCode game = LinuxLoadGameCode(source_game_code_so_full_path, temp_game_code_so_full_path);
+
+    // The game gets the measured length of the previous frame so that a missed frame
+    // is made up by its sim accumulator rather than silently dropped.
+    real32 last_frame_seconds = target_seconds_per_frame;
+
+    // Timing is reported once a second rather than every frame
+    int32 report_frame_count = 0;
+    real32 report_seconds = 0;
+    uint64 report_cycles = 0;
+    int32 frame_count = 0;
+
+    // @start
+    uint64 last_cycle_count = __rdtsc();
+    while (global_running) {
+      new_input->dt_for_frame = last_frame_seconds;
+
+      bool32 reload_game_code = false;
+      if (code_watch_active) {
+        reload_game_code = LinuxCodeWatchTakeReload(&code_watch);
+      }
+      else {
+        struct timespec new_so_write_time = LinuxGetLastFileWriteTime(source_game_code_so_full_path);
+        reload_game_code = !LinuxFileTimesAreEqual(new_so_write_time, game.so_last_write_time);
+      }
+      if (reload_game_code) {
+        LinuxUnloadGameCode(&game);
+        game = LinuxLoadGameCode(source_game_code_so_full_path, temp_game_code_so_full_path);
+        // NOTE: the new code might draw things differently
+        linux_state.screen_needs_full_repaint = true;
+
+        if (code_watch_active) {
+          uint64 reload_latency_ns = LinuxGetWallClock() - code_watch.last_change_ns;
+          printf("Reloaded game code %.1fms after the build finished\n", (real64)reload_latency_ns / 1e6);
+          if (telemetry) {
+            TelemetryRecord record = {};
+            record.type = TelemetryRecord_Reload;
+            record.frame_index = frame_count;
+            record.reload.latency_ns = (uint32)Min(reload_latency_ns, 0xFFFFFFFFull);
+            LinuxLogTelemetry(&telemetry->ring, &record);
+          }
+        }
+      }
+
+      // TODO Make a zeroing macro
+      GameControllerInput *old_keyboard_controller = GetController(old_input, 0);
+      GameControllerInput *new_keyboard_controller = GetController(new_input, 0);
+      GameControllerInput zero_controller = {};
+      *new_keyboard_controller = zero_controller;
+      new_keyboard_controller->is_connected = true; // TODO actually verify instead of assuming
+      for (int32 button_idx = 0;
+          button_idx < ArrayCount(new_keyboard_controller->buttons);
+          ++button_idx) {
+        new_keyboard_controller->buttons[button_idx].ended_down =
+          old_keyboard_controller->buttons[button_idx].ended_down;
+      }
+
+      if (present_window) {
+        TIMED_BLOCK(PlatformInput);
+        LinuxProcessPendingMessages(&linux_state, present_window, new_keyboard_controller);
+      }
+
+      if (!global_pause) {
+        if (present_window) {
+          Window root_window;
+          Window child_window;
+          int root_x, root_y;
+          int mouse_x, mouse_y;
+          unsigned int mouse_mask = 0;
+          XQueryPointer(window.display, window.window, &root_window, &child_window,
+                        &root_x, &root_y, &mouse_x, &mouse_y, &mouse_mask);
+
+          new_input->mouse_x = mouse_x;
+          new_input->mouse_y = mouse_y;
+          new_input->mouse_z = 0;
+          LinuxProcessInputMessage(&new_input->mouse_buttons[0], (mouse_mask & Button1Mask) != 0);
+          LinuxProcessInputMessage(&new_input->mouse_buttons[1], (mouse_mask & Button2Mask) != 0);
+          LinuxProcessInputMessage(&new_input->mouse_buttons[2], (mouse_mask & Button3Mask) != 0);
+          // NOTE: X reports the side buttons as events only, not in the pointer mask
+        }
+
+#if SNAKE_INTERNAL
+        if (linux_state.debug_overlay_toggle_requested) {
+          linux_state.debug_overlay_toggle_requested = false;
+          game_store.debug_table.overlay_enabled = !game_store.debug_table.overlay_enabled;
+          // NOTE: the board under the overlay has to be drawn again
+          linux_state.screen_needs_full_repaint = true;
+        }
+#endif
+
+        // -----------------------------------------------------------------------------
+        // Update and render the game
+
+        ThreadContext thread = {};
+
+        GameOffscreenBuffer screen_buffer = {};
+        screen_buffer.memory = global_backbuffer.memory;
+        screen_buffer.width = global_backbuffer.width;
+        screen_buffer.height = global_backbuffer.height;
+        screen_buffer.pitch = global_backbuffer.pitch;
+        screen_buffer.bytes_per_pixel = global_backbuffer.bytes_per_pixel;
+        screen_buffer.needs_full_repaint = linux_state.screen_needs_full_repaint;
+        linux_state.screen_needs_full_repaint = false;
+
+        if (linux_state.input_recording_index) {
+          LinuxRecordInput(&linux_state, new_input);
+        }
+
+        if (linux_state.input_playback_index) {
+          LinuxPlaybackInput(&linux_state, new_input);
+        }
+
+        if (linux_state.game_replay_toggle_requested) {
+          linux_state.game_replay_toggle_requested = false;
+          if (linux_state.game_replay_handle) {
+            LinuxStopGameReplay(&linux_state, &game_store);
+          }
+          else {
+            LinuxStartGameReplay(&linux_state, &game_store, screen_buffer.width, screen_buffer.height);
+          }
+        }
+
+        if (game.UpdateAndRender) {
+          game.UpdateAndRender(&thread, &game_store, new_input, &screen_buffer);
+        }
+
+        // NOTE: after the update so the frame carries the hashes of the ticks it ran
+        if (linux_state.game_replay_handle) {
+          LinuxRecordGameReplayFrame(&linux_state, &game_store, new_input);
+        }
+
+        // -----------------------------------------------------------------------------
+        // Deal with frame time
+
+        /* NOTE:
+         * We calculate the time here because this is a stable place to check.
+         * We will never have anything escape this time window, which can happen
+         * if we run this at the top of the loop. We wouldn't know if the OS
+         * switched away before processing the next loop.
+         */
+        uint64 frame_deadline = last_counter + pacer.target_ns;
+        uint64 work_end_counter = LinuxGetWallClock();
+        {
+          TIMED_BLOCK(PlatformFrameWait);
+          LinuxWaitForFrame(&pacer, frame_deadline);
+        }
+
+        // We waited above until we hit the target_seconds_per_frame and now we take a
+        // time snapshot immediately following the wait. Everything below, rendering,
+        // etc. will count towards the next frame's time.
+        uint64 end_counter = LinuxGetWallClock();
+        last_frame_seconds = LinuxGetSecondsElapsed(last_counter, end_counter);
+
+        if (telemetry) {
+          TelemetryRecord record = {};
+          record.type = TelemetryRecord_Frame;
+          record.frame_index = frame_count;
+          record.frame.frame_ns = (uint32)Min(end_counter - last_counter, 0xFFFFFFFFull);
+          record.frame.work_ns = (uint32)Min(work_end_counter - last_counter, 0xFFFFFFFFull);
+          record.frame.late_ns = (uint32)((end_counter > frame_deadline) ?
+                                          Min(end_counter - frame_deadline, 0xFFFFFFFFull) : 0);
+          record.frame.missed = (work_end_counter >= frame_deadline);
+          LinuxLogTelemetry(&telemetry->ring, &record);
+        }
+        last_counter = end_counter;
+
+        // NOTE: the game only redraws what changed, so only that needs to go out
+        if (present_window) {
+          TIMED_BLOCK(PlatformPresent);
+          LinuxRenderBufferRect(&global_backbuffer, present_window,
+                                screen_buffer.dirty_min_x, screen_buffer.dirty_min_y,
+                                screen_buffer.dirty_max_x, screen_buffer.dirty_max_y);
+        }
+
+        GameInput *temp = new_input;
+        new_input = old_input; // TODO should I clear these here?
+        old_input = temp;
+
+        uint64 end_cycle_count = __rdtsc();
+        uint64 cycles_elapsed = end_cycle_count - last_cycle_count;
+        last_cycle_count = end_cycle_count;
+
+        ++report_frame_count;
+        report_seconds += last_frame_seconds;
+        report_cycles += cycles_elapsed;
+        if (report_seconds >= 1.0f) {
+          real64 ms_per_frame = 1000.0 * report_seconds / report_frame_count;
+          real64 fps = report_frame_count / report_seconds;
+          real64 mega_cycles_per_frame = (real64)report_cycles / (1000.0 * 1000.0) / report_frame_count;
+          printf("%.02fms/f, %.02ff/s, %.02fMc/f\n", ms_per_frame, fps, mega_cycles_per_frame);
+          report_frame_count = 0;
+          report_seconds = 0;
+          report_cycles = 0;
+        }
+
+#if SNAKE_INTERNAL
+        if (telemetry && game_store.debug_table.trace_enabled) {
+          LinuxLogDebugEvents(&telemetry->ring, &game_store.debug_table, frame_count);
+        }
+        DebugEndFrame(&game_store.debug_table, last_frame_seconds);
+#endif
+
+        ++frame_count;
+        if (frame_limit && frame_count >= frame_limit) {
+          global_running = false;
+        }
+      }
+      else {
+        // NOTE: don't spin a core while paused
+        struct timespec pause_spec = {0, (long)target_ns_per_frame};
+        nanosleep(&pause_spec, 0);
+        last_counter = LinuxGetWallClock();
+      }
+    }
+
+    LinuxUnloadGameCode(&game);
+  }
+  else {
+    // TODO: Error logging
+    fprintf(stderr, "Couldn't allocate the game store\n");
+  }
+
+  // Perform cleanup
+  if (capture_filename && global_backbuffer.memory) {
+    if (LinuxWriteCapture(&global_backbuffer, capture_filename)) {
+      printf("Wrote the last frame to %s\n", capture_filename);
+    }
+    else {
+      fprintf(stderr, "Couldn't write the last frame to %s\n", capture_filename);
+    }
+  }
+  if (linux_state.game_replay_handle) {
+    LinuxStopGameReplay(&linux_state, &game_store);
+  }
+  if (telemetry) {
+    LinuxStopTelemetry(telemetry);
+  }
+  if (pacer.frame_count) {
+    char pacer_buffer[2048];
+    FormatFramePacerStats(&pacer, pacer_buffer, sizeof(pacer_buffer));
+    fputs(pacer_buffer, stdout);
+  }
+#if SNAKE_INTERNAL
+  if (game_store.debug_table.frame_count) {
+    char counter_buffer[4096];
+    FormatDebugCounters(&game_store.debug_table, counter_buffer, sizeof(counter_buffer));
+    fputs(counter_buffer, stdout);
+  }
+#endif
+  for (int replay_index = 0;
+      replay_index < ArrayCount(linux_state.replay_buffers);
+      ++replay_index) {
+    LinuxReplayBuffer *replay_buffer = LinuxGetReplayBuffer(&linux_state, replay_index);
+    if (replay_buffer->file_handle) {
+      close(replay_buffer->file_handle);
+    }
+  }
+  unlink(temp_game_code_so_full_path);
+  if (window.display) {
+    if (global_backbuffer.uses_shm) {
+      XShmDetach(window.display, &global_backbuffer.shm_info);
+    }
+    XCloseDisplay(window.display);
+  }
+  return 0;
+}
@@ -0,0 +1,119 @@
+#if !defined(LINUX_SNAKE_GAME_H)
+
+struct LinuxOffscreenBuffer {
+  // NOTE: Pixels are always 32-bit wide, Little Endian 0x XX RR GG BB
+  //  memory order BB GG RR XX
+  void *memory;
+  int32 bytes_per_pixel;
+  int32 width;
+  int32 height;
+  int32 pitch; // the width of buffer in bytes (also known as stride)
+
+  // Null in offscreen mode. With MIT-SHM the pixels live in a shared memory segment the
+  // X server reads directly, otherwise XPutImage sends them over the socket.
+  XImage *image;
+  bool32 uses_shm;
+  XShmSegmentInfo shm_info;
+};
+
+// What -capture writes. A BITMAPFILEHEADER followed by a BITMAPINFOHEADER.
+#pragma pack(push, 1)
+struct LinuxBitmapHeader {
+  uint16 file_type;
+  uint32 file_size;
+  uint16 reserved1;
+  uint16 reserved2;
+  uint32 bitmap_offset;
+  uint32 size;
+  int32 width;
+  int32 height;
+  uint16 planes;
+  uint16 bits_per_pixel;
+  uint32 compression;
+  uint32 size_of_bitmap;
+  int32 horz_resolution;
+  int32 vert_resolution;
+  uint32 colors_used;
+  uint32 colors_important;
+};
+#pragma pack(pop)
+
+struct LinuxWindow {
+  Display *display;
+  Window window;
+  GC gc;
+  Visual *visual;
+  int32 depth;
+  Atom wm_delete_window;
+};
+
+struct LinuxGameCode {
+  void *game_code_so;
+  struct timespec so_last_write_time;
+
+  // IMPORTANT: either of the callbacks can be 0. You must check before calling.
+  game_update_and_render *UpdateAndRender;
+  game_get_sound_samples *GetSoundSamples;
+
+  bool32 is_valid;
+};
+
+#define LINUX_STATE_FILE_NAME_COUNT 4096
+struct LinuxReplayBuffer {
+  int file_handle;
+  char filename[LINUX_STATE_FILE_NAME_COUNT];
+  void *memory_block;
+
+  // One bit per page of the game store that no longer matches memory_block. Created along
+  // with the backing file the first time the slot is used.
+  uint64 *dirty_pages;
+};
+
+struct LinuxPlatformState {
+  uint64 total_size;
+  void *game_store_block;
+  LinuxReplayBuffer replay_buffers[4];
+
+  // There's no MEM_WRITE_WATCH here, so the game store is kept read only and the first
+  // write to each page faults into LinuxWriteWatchHandler, which sets its bit below and
+  // makes the page writable. Snapshots then only copy the pages with their bit set.
+  uint32 page_size;
+  uint64 page_count;
+  uint64 dirty_page_word_count;
+  uint64 *written_pages; // dirty_page_word_count words
+  uint64 *touched_pages; // every page written since startup, for slots opened later
+  bool32 volatile write_watch_failed;
+
+  int recording_handle;
+  int input_recording_index;
+
+  int playback_handle;
+  int input_playback_index;
+
+  // Passed on to the game when the backbuffer might not hold what it drew last frame
+  bool32 screen_needs_full_repaint;
+
+  // Seeded game replays (see snake_replay.h). 'R' starts a fresh game and records it.
+  bool32 game_replay_toggle_requested;
+  int game_replay_handle;
+  ReplayWriter game_replay;
+
+  // F1 turns the debug overlay (snake_debug_overlay.cpp) on and off
+  bool32 debug_overlay_toggle_requested;
+
+  // X sends a press for every key repeat, so we remember what's held ourselves
+  uint8 keys_down[256];
+
+  char exe_filename[LINUX_STATE_FILE_NAME_COUNT];
+  char *one_past_last_exe_filename_slash;
+};
+
+struct LinuxInputSnapshot {
+  KeySym key_sym;
+  bool32 is_down;
+  bool32 was_down;
+  bool32 alt_is_down;
+};
+
+#define LINUX_SNAKE_GAME_H
+#endif
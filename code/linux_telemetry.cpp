@@ -0,0 +1,189 @@
+/* POSIX telemetry log. See snake_telemetry.h for the ring and the file format.
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <x86intrin.h>
+#include "snake_telemetry.h"
+
+struct LinuxTelemetry {
+  TelemetryRing ring;
+
+  int file_handle;
+  pthread_t drain_thread;
+  uint32 volatile stop_requested;
+
+  uint64 start_tsc;
+  uint64 start_ns;
+
+  // Only touched by the drain thread
+  TelemetryRecord drain_buffer[256];
+};
+
+inline uint64
+LinuxTelemetryClock() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  uint64 result = (uint64)spec.tv_sec * 1000000000ull + (uint64)spec.tv_nsec;
+  return result;
+}
+
+// Appends a record, stamping it with the tsc unless it has one. Safe to call from any thread.
+internal void
+LinuxLogTelemetry(TelemetryRing *ring, TelemetryRecord *record) {
+  if (ring->is_active) {
+    uint32 record_idx = __atomic_load_n(&ring->next_record_to_write, __ATOMIC_RELAXED);
+    for (;;) {
+      uint32 next_record_to_read = __atomic_load_n(&ring->next_record_to_read, __ATOMIC_ACQUIRE);
+      if (record_idx - next_record_to_read >= TELEMETRY_RING_SIZE) {
+        // NOTE: the drain is a whole ring behind. Don't wait for it.
+        __atomic_add_fetch(&ring->dropped_count, 1, __ATOMIC_RELAXED);
+        return;
+      }
+      if (__atomic_compare_exchange_n(&ring->next_record_to_write, &record_idx, record_idx + 1,
+                                      true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    }
+
+    TelemetrySlot *slot = ring->slots + (record_idx & (TELEMETRY_RING_SIZE - 1));
+    slot->record = *record;
+    if (!slot->record.tsc) {
+      slot->record.tsc = __rdtsc();
+    }
+    // NOTE: the record has to be visible before the sequence that hands it out
+    __atomic_store_n(&slot->sequence, record_idx + 1, __ATOMIC_RELEASE);
+  }
+}
+
+#if SNAKE_INTERNAL
+// Hands the frame's timed block events to the log. Call before DebugEndFrame throws them away.
+internal void
+LinuxLogDebugEvents(TelemetryRing *ring, DebugTable *table, uint32 frame_index) {
+  uint32 event_count = DebugEventCount(table);
+  for (uint32 event_idx = 0; event_idx < event_count; ++event_idx) {
+    DebugEvent *event = table->events + event_idx;
+    TelemetryRecord record = {};
+    record.type = (event->type == DebugEvent_BeginBlock) ? TelemetryRecord_BlockBegin : TelemetryRecord_BlockEnd;
+    record.frame_index = frame_index;
+    record.tsc = event->tsc;
+    record.block.block_id = event->block_id;
+    record.block.thread_id = event->thread_id;
+    LinuxLogTelemetry(ring, &record);
+  }
+}
+#endif
+
+// Writes out every record that's ready. Only the drain thread (or Stop after it) calls this.
+internal void
+LinuxDrainTelemetry(LinuxTelemetry *telemetry) {
+  TelemetryRing *ring = &telemetry->ring;
+  uint32 record_idx = ring->next_record_to_read;
+  for (;;) {
+    int32 record_count = 0;
+    while (record_count < ArrayCount(telemetry->drain_buffer)) {
+      TelemetrySlot *slot = ring->slots + (record_idx & (TELEMETRY_RING_SIZE - 1));
+      // A writer that claimed this slot but hasn't finished holds up the ones after it
+      if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != record_idx + 1) {
+        break;
+      }
+      telemetry->drain_buffer[record_count++] = slot->record;
+      ++record_idx;
+    }
+    // NOTE: the copies are done, so the writers can have the slots back
+    __atomic_store_n(&ring->next_record_to_read, record_idx, __ATOMIC_RELEASE);
+
+    if (record_count == 0) {
+      break;
+    }
+    size_t bytes_to_write = record_count * sizeof(TelemetryRecord);
+    uint8 *at = (uint8 *)telemetry->drain_buffer;
+    while (bytes_to_write) {
+      ssize_t bytes_written = write(telemetry->file_handle, at, bytes_to_write);
+      if (bytes_written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        // TODO: diagnostic. The records are gone either way.
+        break;
+      }
+      at += bytes_written;
+      bytes_to_write -= (size_t)bytes_written;
+    }
+  }
+}
+
+internal void *
+LinuxTelemetryThreadProc(void *parameter) {
+  LinuxTelemetry *telemetry = (LinuxTelemetry *)parameter;
+  while (!__atomic_load_n(&telemetry->stop_requested, __ATOMIC_ACQUIRE)) {
+    LinuxDrainTelemetry(telemetry);
+    struct timespec drain_interval = {0, TELEMETRY_DRAIN_MS * 1000000};
+    nanosleep(&drain_interval, 0);
+  }
+  return 0;
+}
+
+/* Creates the log file at path and starts draining into it. Until this succeeds the ring
+ * stays inactive and logging does nothing.
+ */
+internal bool32
+LinuxStartTelemetry(LinuxTelemetry *telemetry, char *path) {
+  bool32 result = false;
+  telemetry->file_handle = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+  if (telemetry->file_handle >= 0) {
+    telemetry->start_tsc = __rdtsc();
+    telemetry->start_ns = LinuxTelemetryClock();
+
+    TelemetryFileHeader header = {};
+    header.magic = TELEMETRY_MAGIC;
+    header.version = TELEMETRY_VERSION;
+    header.record_size = sizeof(TelemetryRecord);
+    header.start_tsc = telemetry->start_tsc;
+    if (write(telemetry->file_handle, &header, sizeof(header)) == sizeof(header)) {
+      telemetry->stop_requested = 0;
+      telemetry->ring.is_active = true;
+      if (pthread_create(&telemetry->drain_thread, 0, LinuxTelemetryThreadProc, telemetry) == 0) {
+        result = true;
+      }
+      else {
+        telemetry->ring.is_active = false;
+      }
+    }
+    if (!result) {
+      close(telemetry->file_handle);
+      telemetry->file_handle = -1;
+    }
+  }
+  return result;
+}
+
+// Writes out what's left and fills in the header's tsc rate and drop count
+internal void
+LinuxStopTelemetry(LinuxTelemetry *telemetry) {
+  if (telemetry->ring.is_active) {
+    telemetry->ring.is_active = false;
+    __atomic_store_n(&telemetry->stop_requested, 1, __ATOMIC_RELEASE);
+    pthread_join(telemetry->drain_thread, 0);
+    LinuxDrainTelemetry(telemetry);
+
+    uint64 elapsed_tsc = __rdtsc() - telemetry->start_tsc;
+    uint64 elapsed_ns = LinuxTelemetryClock() - telemetry->start_ns;
+
+    TelemetryFileHeader header = {};
+    header.magic = TELEMETRY_MAGIC;
+    header.version = TELEMETRY_VERSION;
+    header.record_size = sizeof(TelemetryRecord);
+    header.dropped_count = telemetry->ring.dropped_count;
+    header.start_tsc = telemetry->start_tsc;
+    if (elapsed_ns) {
+      header.tsc_per_second = (uint64)((real64)elapsed_tsc * 1e9 / (real64)elapsed_ns);
+    }
+    pwrite(telemetry->file_handle, &header, sizeof(header), 0);
+    close(telemetry->file_handle);
+    telemetry->file_handle = -1;
+  }
+}
@@ -0,0 +1,92 @@
+/* POSIX work queue. See PlatformWorkQueue in snake_game.h.
+ *
+ * The same lock free ring as win32_work_queue.cpp, on pthreads and an unnamed semaphore.
+ */
+
+#include <pthread.h>
+#include <semaphore.h>
+
+struct PlatformWorkQueueEntry {
+  platform_work_queue_callback *callback;
+  void *data;
+};
+
+struct PlatformWorkQueue {
+  uint32 volatile completion_goal;
+  uint32 volatile completion_count;
+
+  uint32 volatile next_entry_to_write;
+  uint32 volatile next_entry_to_read;
+  sem_t semaphore;
+
+  PlatformWorkQueueEntry entries[256];
+};
+
+internal PLATFORM_ADD_ENTRY(LinuxAddEntry) {
+  uint32 new_next_entry_to_write = (queue->next_entry_to_write + 1) % ArrayCount(queue->entries);
+  Assert(new_next_entry_to_write != __atomic_load_n(&queue->next_entry_to_read, __ATOMIC_RELAXED));
+  PlatformWorkQueueEntry *entry = queue->entries + queue->next_entry_to_write;
+  entry->callback = callback;
+  entry->data = data;
+  __atomic_add_fetch(&queue->completion_goal, 1, __ATOMIC_RELAXED);
+  // NOTE: the entry has to be visible before the index that hands it out
+  __atomic_store_n(&queue->next_entry_to_write, new_next_entry_to_write, __ATOMIC_RELEASE);
+  sem_post(&queue->semaphore);
+}
+
+// Returns true when there was nothing to do
+internal bool32
+LinuxDoNextWorkQueueEntry(PlatformWorkQueue *queue) {
+  bool32 we_should_sleep = false;
+
+  uint32 original_next_entry_to_read = __atomic_load_n(&queue->next_entry_to_read, __ATOMIC_RELAXED);
+  uint32 new_next_entry_to_read = (original_next_entry_to_read + 1) % ArrayCount(queue->entries);
+  if (original_next_entry_to_read != __atomic_load_n(&queue->next_entry_to_write, __ATOMIC_ACQUIRE)) {
+    uint32 entry_idx = __sync_val_compare_and_swap(&queue->next_entry_to_read,
+                                                   original_next_entry_to_read, new_next_entry_to_read);
+    if (entry_idx == original_next_entry_to_read) {
+      PlatformWorkQueueEntry entry = queue->entries[entry_idx];
+      entry.callback(queue, entry.data);
+      __atomic_add_fetch(&queue->completion_count, 1, __ATOMIC_RELEASE);
+    }
+  }
+  else {
+    we_should_sleep = true;
+  }
+  return we_should_sleep;
+}
+
+internal PLATFORM_COMPLETE_ALL_WORK(LinuxCompleteAllWork) {
+  while (queue->completion_goal != __atomic_load_n(&queue->completion_count, __ATOMIC_ACQUIRE)) {
+    LinuxDoNextWorkQueueEntry(queue);
+  }
+  queue->completion_goal = 0;
+  queue->completion_count = 0;
+}
+
+internal void *
+LinuxWorkQueueThreadProc(void *parameter) {
+  PlatformWorkQueue *queue = (PlatformWorkQueue *)parameter;
+  for (;;) {
+    if (LinuxDoNextWorkQueueEntry(queue)) {
+      sem_wait(&queue->semaphore);
+    }
+  }
+  return 0;
+}
+
+// Starts thread_count workers. They run until the process exits.
+internal void
+LinuxMakeQueue(PlatformWorkQueue *queue, uint32 thread_count) {
+  queue->completion_goal = 0;
+  queue->completion_count = 0;
+  queue->next_entry_to_write = 0;
+  queue->next_entry_to_read = 0;
+
+  sem_init(&queue->semaphore, 0, 0);
+  for (uint32 thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+    pthread_t thread;
+    pthread_create(&thread, 0, LinuxWorkQueueThreadProc, queue);
+    pthread_detach(thread);
+  }
+}
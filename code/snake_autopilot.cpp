@@ -0,0 +1,428 @@
+/* Autopilot for the single snake game. See snake_autopilot.h.
+ *
+ * Included by snake_game.cpp after the single snake sim.
+ */
+
+// ---------------------------------------------------------------------------------------
+// Hamiltonian cycle
+// ---------------------------------------------------------------------------------------
+
+/* The cycle runs on a w x h grid with h even. Columns 1..w-1 are walked row by row,
+ * east on even rows and west on odd ones, and column 0 is the way back up to the start.
+ * Nothing is stored. Positions and tiles are worked out on the fly.
+ */
+inline int32
+CyclePositionOnGrid(int32 u, int32 v, int32 w, int32 h) {
+  int32 result;
+  if (u == 0) {
+    result = (h * (w - 1)) + (h - 1 - v);
+  }
+  else if ((v & 1) == 0) {
+    result = (v * (w - 1)) + (u - 1);
+  }
+  else {
+    result = (v * (w - 1)) + (w - 1 - u);
+  }
+  return result;
+}
+
+inline int32
+CyclePosition(Autopilot *autopilot, int x, int y) {
+  int32 result;
+  if (autopilot->cycle_transposed) {
+    result = CyclePositionOnGrid(y - 1, x - 1, autopilot->cycle_width, autopilot->cycle_height);
+  }
+  else {
+    result = CyclePositionOnGrid(x - 1, y - 1, autopilot->cycle_width, autopilot->cycle_height);
+  }
+  return result;
+}
+
+SnakePiece CycleTile(Autopilot *autopilot, int32 position) {
+  int32 w = autopilot->cycle_width;
+  int32 h = autopilot->cycle_height;
+  Assert(position >= 0 && position < autopilot->cycle_length);
+
+  int32 u, v;
+  if (position >= h * (w - 1)) {
+    u = 0;
+    v = h - 1 - (position - (h * (w - 1)));
+  }
+  else {
+    v = position / (w - 1);
+    int32 offset = position % (w - 1);
+    u = ((v & 1) == 0) ? (offset + 1) : (w - 1 - offset);
+  }
+
+  SnakePiece result;
+  if (autopilot->cycle_transposed) {
+    result.x = (int16)(v + 1);
+    result.y = (int16)(u + 1);
+  }
+  else {
+    result.x = (int16)(u + 1);
+    result.y = (int16)(v + 1);
+  }
+  return result;
+}
+
+// How many cycle steps it takes to get from `from` to `to`.
+inline int32
+CycleDistance(Autopilot *autopilot, int32 from, int32 to) {
+  int32 result = to - from;
+  if (result < 0) {
+    result += autopilot->cycle_length;
+  }
+  return result;
+}
+
+void InitializeAutopilot(GameState *state) {
+  Autopilot *autopilot = &state->autopilot;
+  autopilot->has_cycle = false;
+  if ((state->num_tiles_y % 2) == 0 && state->num_tiles_x >= 2) {
+    autopilot->has_cycle = true;
+    autopilot->cycle_transposed = false;
+    autopilot->cycle_width = state->num_tiles_x;
+    autopilot->cycle_height = state->num_tiles_y;
+  }
+  else if ((state->num_tiles_x % 2) == 0 && state->num_tiles_y >= 2) {
+    autopilot->has_cycle = true;
+    autopilot->cycle_transposed = true;
+    autopilot->cycle_width = state->num_tiles_y;
+    autopilot->cycle_height = state->num_tiles_x;
+  }
+  // NOTE: a board with both sides odd has no Hamiltonian cycle
+  autopilot->cycle_length = autopilot->has_cycle ? (state->num_tiles_x * state->num_tiles_y) : 0;
+}
+
+// ---------------------------------------------------------------------------------------
+// Bitboard searches
+// ---------------------------------------------------------------------------------------
+
+/* Scratch bits for every board tile. Padded on both sides by more than a board row so
+ * that SpreadBits can read a row above and below any word without checking.
+ */
+internal uint64 *
+PushTileBits(MemoryArena *arena, GameState *state) {
+  int32 pad = (state->board_stride >> 6) + 2;
+  int32 count = state->board_bit_words + (2 * pad);
+  uint64 *result = PushArray(arena, count, uint64, 64);
+  for (int32 word_idx = 0; word_idx < count; ++word_idx) {
+    result[word_idx] = 0;
+  }
+  return result + pad;
+}
+
+/* Word `i` of `bits` grown by one tile in every direction. With row-major tile bits the
+ * east and west neighbors are one bit away and north and south are a board stride away.
+ */
+inline uint64
+SpreadBits(uint64 *bits, int32 i, int32 row_words, int32 row_shift) {
+  uint64 center = bits[i];
+  uint64 result = center;
+  result |= (center << 1) | (bits[i - 1] >> 63);
+  result |= (center >> 1) | (bits[i + 1] << 63);
+  if (row_shift) {
+    result |= (bits[i - row_words] << row_shift) | (bits[i - row_words - 1] >> (64 - row_shift));
+    result |= (bits[i + row_words] >> row_shift) | (bits[i + row_words + 1] << (64 - row_shift));
+  }
+  else {
+    result |= bits[i - row_words] | bits[i + row_words];
+  }
+  return result;
+}
+
+/* BFS from the head to the nearest food. Each of the four first steps gets its own
+ * frontier and a tile goes to whichever frontier reaches it first, so the winning
+ * frontier is the direction to take. Returns NONE when no food is reachable or the
+ * search ran out of budget.
+ */
+internal Direction
+AutopilotFindFood(GameState *state, MemoryArena *arena, int32 *budget) {
+  Autopilot *autopilot = &state->autopilot;
+  SnakeState *snake = &state->snake;
+  int32 word_count = state->board_bit_words;
+  int32 row_words = state->board_stride >> 6;
+  int32 row_shift = state->board_stride & 63;
+
+  uint64 *visited = PushTileBits(arena, state);
+  uint64 *fronts[4];
+  uint64 *nexts[4];
+  for (int32 dir_idx = 0; dir_idx < 4; ++dir_idx) {
+    fronts[dir_idx] = PushTileBits(arena, state);
+    nexts[dir_idx] = PushTileBits(arena, state);
+  }
+
+  SnakePiece *head = GetSnakeHead(snake);
+  SetTileBit(visited, BoardTileIndex(state, head->x, head->y));
+
+  Direction result = NONE;
+  bool32 searching = false;
+  int32 lo = word_count;
+  int32 hi = -1;
+  for (int32 dir_idx = 0; dir_idx < 4 && result == NONE; ++dir_idx) {
+    Direction dir = (Direction)(dir_idx + 1);
+    SnakePiece next = NextSnakePiece(head, dir);
+    int tile_idx = BoardTileIndex(state, next.x, next.y);
+    if (!TileBitIsSet(state->blocked_bits, tile_idx)) {
+      if (TileBitIsSet(state->food_bits, tile_idx)) {
+        result = dir;
+      }
+      SetTileBit(fronts[dir_idx], tile_idx);
+      SetTileBit(visited, tile_idx);
+      lo = Min(lo, tile_idx >> 6);
+      hi = Max(hi, tile_idx >> 6);
+      searching = true;
+    }
+  }
+
+  while (searching && result == NONE) {
+    // NOTE: the window only ever grows so words outside it are still zero from the push
+    lo = Max(0, lo - (row_words + 1));
+    hi = Min(word_count - 1, hi + (row_words + 1));
+    int32 cost = 4 * (hi - lo + 1);
+    if (*budget < cost) {
+      ++autopilot->budget_hits;
+      break;
+    }
+    *budget -= cost;
+
+    searching = false;
+    for (int32 dir_idx = 0; dir_idx < 4; ++dir_idx) {
+      uint64 *front = fronts[dir_idx];
+      uint64 *next = nexts[dir_idx];
+      for (int32 word_idx = lo; word_idx <= hi; ++word_idx) {
+        uint64 bits = (SpreadBits(front, word_idx, row_words, row_shift) &
+                       ~state->blocked_bits[word_idx] & ~visited[word_idx]);
+        next[word_idx] = bits;
+        if (bits) {
+          visited[word_idx] |= bits;
+          searching = true;
+          if ((bits & state->food_bits[word_idx]) && result == NONE) {
+            result = (Direction)(dir_idx + 1);
+          }
+        }
+      }
+      nexts[dir_idx] = front;
+      fronts[dir_idx] = next;
+    }
+  }
+
+  return result;
+}
+
+/* Floods the open tiles reachable from `start_tile`. Stops early when the budget runs
+ * out, in which case the caller should treat the region as roomy. Returns the bits.
+ */
+internal uint64 *
+AutopilotFlood(GameState *state, MemoryArena *arena, int start_tile, int32 *budget, bool32 *out_of_budget) {
+  int32 word_count = state->board_bit_words;
+  int32 row_words = state->board_stride >> 6;
+  int32 row_shift = state->board_stride & 63;
+
+  uint64 *reached = PushTileBits(arena, state);
+  SetTileBit(reached, start_tile);
+
+  *out_of_budget = false;
+  int32 lo = start_tile >> 6;
+  int32 hi = lo;
+  bool32 changed = true;
+  while (changed) {
+    lo = Max(0, lo - (row_words + 1));
+    hi = Min(word_count - 1, hi + (row_words + 1));
+    int32 cost = hi - lo + 1;
+    if (*budget < cost) {
+      *out_of_budget = true;
+      break;
+    }
+    *budget -= cost;
+
+    // NOTE: updating in place lets the fill run ahead within a pass, which only helps
+    changed = false;
+    for (int32 word_idx = lo; word_idx <= hi; ++word_idx) {
+      uint64 bits = SpreadBits(reached, word_idx, row_words, row_shift) & ~state->blocked_bits[word_idx];
+      bits |= reached[word_idx];
+      if (bits != reached[word_idx]) {
+        reached[word_idx] = bits;
+        changed = true;
+      }
+    }
+  }
+  return reached;
+}
+
+// Whether the snake could still get back to its tail after stepping in `dir`.
+internal bool32
+AutopilotTailReachable(GameState *state, MemoryArena *arena, Direction dir, int32 *budget) {
+  SnakeState *snake = &state->snake;
+  bool32 result = true;
+  if (snake->length > 1) {
+    SnakePiece next = NextSnakePiece(GetSnakeHead(snake), dir);
+    SnakePiece *tail = GetSnakeTail(snake);
+    bool32 out_of_budget;
+    uint64 *reached = AutopilotFlood(state, arena, BoardTileIndex(state, next.x, next.y),
+                                     budget, &out_of_budget);
+    if (!out_of_budget) {
+      result = false;
+      for (int32 dir_idx = 0; dir_idx < 4; ++dir_idx) {
+        SnakePiece beside_tail = NextSnakePiece(tail, (Direction)(dir_idx + 1));
+        if (TileBitIsSet(reached, BoardTileIndex(state, beside_tail.x, beside_tail.y))) {
+          result = true;
+          break;
+        }
+      }
+    }
+  }
+  return result;
+}
+
+// Last resort. The open neighbor with the biggest region behind it.
+internal Direction
+AutopilotMostRoom(GameState *state, MemoryArena *arena, int32 *budget) {
+  SnakeState *snake = &state->snake;
+  SnakePiece *head = GetSnakeHead(snake);
+  Direction result = NONE;
+  int32 most_room = -1;
+  for (int32 dir_idx = 0; dir_idx < 4; ++dir_idx) {
+    Direction dir = (Direction)(dir_idx + 1);
+    SnakePiece next = NextSnakePiece(head, dir);
+    int tile_idx = BoardTileIndex(state, next.x, next.y);
+    if (!TileBitIsSet(state->blocked_bits, tile_idx)) {
+      TemporaryMemory flood_memory = BeginTemporaryMemory(arena);
+      bool32 out_of_budget;
+      uint64 *reached = AutopilotFlood(state, arena, tile_idx, budget, &out_of_budget);
+      int32 room = 0;
+      if (out_of_budget) {
+        room = state->board_tile_count;
+      }
+      else {
+        for (int32 word_idx = 0; word_idx < state->board_bit_words; ++word_idx) {
+          room += CountSetBits64(reached[word_idx]);
+        }
+      }
+      EndTemporaryMemory(flood_memory);
+
+      if (room > most_room) {
+        most_room = room;
+        result = dir;
+      }
+    }
+  }
+  return result;
+}
+
+/* Picks a move that keeps the body inside the cycle stretch from tail to head. The next
+ * cycle tile is always fine. Skipping ahead is fine as long as it leaves enough of the
+ * stretch in front of the tail for all the growth still to come, and doesn't skip past
+ * the next food along the cycle. That way every move gets closer to that food along the
+ * cycle and the snake can't go back and forth. The BFS direction wins whenever it passes
+ * the same checks.
+ */
+internal Direction
+AutopilotCycleMove(GameState *state, Direction food_dir) {
+  Autopilot *autopilot = &state->autopilot;
+  SnakeState *snake = &state->snake;
+  SnakePiece *head = GetSnakeHead(snake);
+  SnakePiece *tail = GetSnakeTail(snake);
+  int32 head_position = CyclePosition(autopilot, head->x, head->y);
+  int32 room = autopilot->cycle_length;
+  if (snake->length > 1) {
+    room = CycleDistance(autopilot, head_position, CyclePosition(autopilot, tail->x, tail->y));
+  }
+
+  // Food under the body turns into growth once the tail gets there
+  int32 growth = snake->pending_growth;
+  int32 target = autopilot->cycle_length;
+  for (int32 food_idx = 0; food_idx < state->num_foods; ++food_idx) {
+    SnakeFood *food = &state->foods[food_idx];
+    if (*GetBoardTile(state, food->x, food->y) & TILE_BODY) {
+      ++growth;
+    }
+    int32 distance = CycleDistance(autopilot, head_position, CyclePosition(autopilot, food->x, food->y));
+    if (distance > 0) {
+      target = Min(target, distance);
+    }
+  }
+
+  Direction result = NONE;
+  Direction cycle_dir = NONE;
+  int32 best_distance = 0;
+  for (int32 dir_idx = 0; dir_idx < 4; ++dir_idx) {
+    Direction dir = (Direction)(dir_idx + 1);
+    SnakePiece next = NextSnakePiece(head, dir);
+    int tile_idx = BoardTileIndex(state, next.x, next.y);
+    if (TileBitIsSet(state->blocked_bits, tile_idx)) {
+      continue;
+    }
+
+    int32 distance = CycleDistance(autopilot, head_position, CyclePosition(autopilot, next.x, next.y));
+    int32 next_growth = growth + (TileBitIsSet(state->food_bits, tile_idx) ? 1 : 0);
+    bool32 keeps_order = (distance == 1) || (distance > 1 && distance < room - next_growth - 1);
+    if (keeps_order && distance <= target) {
+      if (dir == food_dir) {
+        result = dir;
+        ++autopilot->food_moves;
+        break;
+      }
+      if (distance == 1) {
+        cycle_dir = dir;
+      }
+      if (distance > best_distance) {
+        best_distance = distance;
+        result = dir;
+      }
+    }
+  }
+
+  if (result == NONE) {
+    result = cycle_dir;
+  }
+  if (result != NONE && result != food_dir) {
+    ++autopilot->cycle_moves;
+  }
+  return result;
+}
+
+// ---------------------------------------------------------------------------------------
+// Controller
+// ---------------------------------------------------------------------------------------
+
+// Chooses the direction for the next move. Only call while the snake is alive.
+void AutopilotDecide(GameState *state) {
+  Autopilot *autopilot = &state->autopilot;
+  SnakeState *snake = &state->snake;
+  MemoryArena *arena = &state->frame_arena;
+  TemporaryMemory scratch = BeginTemporaryMemory(arena);
+  int32 budget = AUTOPILOT_WORD_BUDGET;
+
+  Direction food_dir = AutopilotFindFood(state, arena, &budget);
+  Direction choice = NONE;
+  if (autopilot->has_cycle) {
+    choice = AutopilotCycleMove(state, food_dir);
+  }
+  else if (food_dir != NONE && AutopilotTailReachable(state, arena, food_dir, &budget)) {
+    choice = food_dir;
+    ++autopilot->food_moves;
+  }
+
+  if (choice == NONE) {
+    // Either there's no cycle or we've been steered off of it
+    choice = AutopilotMostRoom(state, arena, &budget);
+    ++autopilot->room_moves;
+  }
+
+  EndTemporaryMemory(scratch);
+  ++autopilot->decisions;
+
+  snake->new_direction = NONE;
+  if (choice != NONE) {
+    ChangeSnakeDirection(snake, choice);
+  }
+}
+
+// Run once per sim tick, before SimulateTick. Thinks right before each move.
+void AutopilotTick(GameState *state) {
+  if (state->autopilot.enabled && state->snake.alive && state->snake_move_ticks_left <= 1) {
+    AutopilotDecide(state);
+  }
+}
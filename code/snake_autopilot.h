@@ -0,0 +1,45 @@
+#if !defined(SNAKE_AUTOPILOT_H)
+
+/* Autopilot for the single snake game.
+ *
+ * Once per move it runs a breadth first search from the head to the nearest food. The
+ * search works on the blocked/food bitboards 64 tiles at a time and keeps one frontier for
+ * each first step, so the direction falls out without keeping parents around.
+ *
+ * Whenever the board has a Hamiltonian cycle (at least one side even) the snake only takes
+ * moves that keep its body inside the stretch of the cycle between tail and head. The
+ * plain cycle move is always one of those, so the snake can never trap itself and will
+ * eventually fill the board. The BFS step and any shortcut along the cycle are taken only
+ * when they keep that invariant.
+ *
+ * Boards without a cycle check that the tail is still reachable after the BFS step, and
+ * otherwise head for whichever neighbor has the most room.
+ *
+ * All scratch comes from the frame arena and every search stops once it has touched
+ * AUTOPILOT_WORD_BUDGET bitboard words.
+ */
+
+// Roughly a millisecond of searching
+#define AUTOPILOT_WORD_BUDGET (1 << 18)
+
+struct Autopilot {
+  bool32 enabled;
+
+  // The cycle is laid out on a cycle_width x cycle_height grid. It's transposed when only
+  // the board's width is even.
+  bool32 has_cycle;
+  bool32 cycle_transposed;
+  int32 cycle_width;
+  int32 cycle_height;
+  int32 cycle_length;
+
+  // Stats
+  uint64 decisions;
+  uint64 food_moves;
+  uint64 cycle_moves;
+  uint64 room_moves;
+  uint64 budget_hits;
+};
+
+#define SNAKE_AUTOPILOT_H
+#endif
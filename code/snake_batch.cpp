@@ -0,0 +1,323 @@
+/* Batched structure-of-arrays sim. See snake_batch.h.
+ *
+ * Include after snake_game.cpp.
+ */
+
+#include "snake_batch.h"
+
+void InitializeSnakeBatch(SnakeBatch *batch, MemoryArena *arena, GameState **states, int32 game_count) {
+  *batch = {};
+  batch->game_count = game_count;
+  batch->lane_count = ((game_count + SNAKE_BATCH_MAX_WIDTH - 1) / SNAKE_BATCH_MAX_WIDTH) * SNAKE_BATCH_MAX_WIDTH;
+  batch->states = states;
+  switch(GetSimdLevel()) {
+    case SimdLevel_AVX2: {
+      batch->width = 8;
+    } break;
+
+    case SimdLevel_SSE41: {
+      batch->width = 4;
+    } break;
+
+    default: {
+      batch->width = 1;
+    } break;
+  }
+
+  int32 lanes = batch->lane_count;
+  batch->head_x = PushArray(arena, lanes, int32, 64);
+  batch->head_y = PushArray(arena, lanes, int32, 64);
+  batch->dir = PushArray(arena, lanes, int32, 64);
+  batch->new_dir = PushArray(arena, lanes, int32, 64);
+  batch->length = PushArray(arena, lanes, int32, 64);
+  batch->alive = PushArray(arena, lanes, int32, 64);
+  batch->move_ticks_left = PushArray(arena, lanes, int32, 64);
+  batch->move_interval = PushArray(arena, lanes, int32, 64);
+  batch->east_wall_x = PushArray(arena, lanes, int32, 64);
+  batch->south_wall_y = PushArray(arena, lanes, int32, 64);
+  batch->board_stride = PushArray(arena, lanes, int32, 64);
+  batch->board_offset = PushArray(arena, lanes, int64, 64);
+  batch->tick_base = PushArray(arena, lanes, uint64, 64);
+
+  batch->board_base = states[0]->board;
+  for (int32 lane = 0; lane < lanes; ++lane) {
+    // Padding lanes stay dead forever and are never gathered from
+    batch->alive[lane] = 0;
+    batch->board_offset[lane] = 0;
+  }
+}
+
+void BatchLoadLane(SnakeBatch *batch, int32 lane) {
+  Assert(lane < batch->game_count);
+  GameState *state = batch->states[lane];
+  SnakeState *snake = &state->snake;
+  SnakePiece *head = GetSnakeHead(snake);
+
+  batch->head_x[lane] = head->x;
+  batch->head_y[lane] = head->y;
+  batch->dir[lane] = snake->dir;
+  batch->new_dir[lane] = snake->new_direction;
+  batch->length[lane] = snake->length;
+  batch->alive[lane] = snake->alive ? 1 : 0;
+  batch->move_ticks_left[lane] = state->snake_move_ticks_left;
+  batch->move_interval[lane] = state->snake_move_interval;
+
+  batch->east_wall_x[lane] = state->num_tiles_x + 1;
+  batch->south_wall_y[lane] = state->num_tiles_y + 1;
+  batch->board_stride[lane] = state->board_stride;
+  batch->board_offset[lane] = (int64)(state->board - batch->board_base);
+  batch->tick_base[lane] = state->sim_tick - batch->ticks;
+}
+
+void BatchStoreLane(SnakeBatch *batch, int32 lane) {
+  Assert(lane < batch->game_count);
+  GameState *state = batch->states[lane];
+  SnakeState *snake = &state->snake;
+
+  // NOTE: the head and length are always written through to the GameState on a move
+  snake->dir = (Direction)batch->dir[lane];
+  snake->new_direction = (Direction)batch->new_dir[lane];
+  snake->alive = batch->alive[lane];
+  state->snake_move_ticks_left = batch->move_ticks_left[lane];
+  state->snake_move_interval = batch->move_interval[lane];
+  state->sim_tick = batch->tick_base[lane] + batch->ticks;
+}
+
+void BatchLoad(SnakeBatch *batch) {
+  for (int32 lane = 0; lane < batch->game_count; ++lane) {
+    BatchLoadLane(batch, lane);
+  }
+}
+
+void BatchStore(SnakeBatch *batch) {
+  for (int32 lane = 0; lane < batch->game_count; ++lane) {
+    BatchStoreLane(batch, lane);
+  }
+}
+
+// Same rules as ChangeSnakeDirection, applied to the lanes.
+void BatchChangeDirection(SnakeBatch *batch, int32 lane, Direction new_dir) {
+  if (batch->alive[lane]) {
+    Direction dir = (Direction)batch->dir[lane];
+    Direction inverse_head_dir = OppositeDirection(dir);
+    if (dir != new_dir &&
+        (new_dir != inverse_head_dir || batch->length[lane] == 1) &&
+        batch->new_dir[lane] != new_dir) {
+      batch->new_dir[lane] = new_dir;
+    }
+  }
+}
+
+// The scalar tail of a move. `dies` has already been worked out from the board flags.
+inline void
+BatchFinishMove(SnakeBatch *batch, int32 lane, int32 next_x, int32 next_y, int32 next_tile_idx, bool32 dies) {
+  GameState *state = batch->states[lane];
+  SnakeState *snake = &state->snake;
+  ++batch->moves;
+
+  if (dies) {
+    batch->alive[lane] = 0;
+    snake->alive = false;
+    ++batch->deaths;
+  }
+  else {
+    SnakePiece next;
+    next.x = (int16)next_x;
+    next.y = (int16)next_y;
+    AdvanceSnake(state, next, next_tile_idx);
+    batch->head_x[lane] = next_x;
+    batch->head_y[lane] = next_y;
+    batch->length[lane] = snake->length;
+  }
+
+  int32 interval = SnakeMoveIntervalTicks(snake);
+  batch->move_interval[lane] = interval;
+  batch->move_ticks_left[lane] = interval;
+}
+
+// Plain C version of one lane of the kernel, for machines without SSE4.1 or AVX2.
+inline void
+BatchSimulateLane(SnakeBatch *batch, int32 lane) {
+  if (batch->alive[lane] && --batch->move_ticks_left[lane] <= 0) {
+    if (batch->new_dir[lane] != NONE) {
+      batch->dir[lane] = batch->new_dir[lane];
+      batch->new_dir[lane] = NONE;
+    }
+
+    int32 dir = batch->dir[lane];
+    int32 next_x = batch->head_x[lane] + (dir == EAST) - (dir == WEST);
+    int32 next_y = batch->head_y[lane] + (dir == SOUTH) - (dir == NORTH);
+    int32 next_tile_idx = next_x + (next_y * batch->board_stride[lane]);
+    uint8 flags = batch->board_base[batch->board_offset[lane] + next_tile_idx];
+
+    bool32 hits_wall = (next_x == 0 || next_x == batch->east_wall_x[lane] ||
+                        next_y == 0 || next_y == batch->south_wall_y[lane]);
+    bool32 dies = hits_wall || (flags & TILE_BODY);
+    if (!dies && (flags & TILE_FOOD)) {
+      ++batch->food_hits;
+    }
+    BatchFinishMove(batch, lane, next_x, next_y, next_tile_idx, dies);
+  }
+}
+
+// The kernel eight games at a time
+SIMD_TARGET("avx2,popcnt") internal void
+BatchSimulateTick8(SnakeBatch *batch) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i one = _mm256_set1_epi32(1);
+  __m256i north = _mm256_set1_epi32(NORTH);
+  __m256i east = _mm256_set1_epi32(EAST);
+  __m256i south = _mm256_set1_epi32(SOUTH);
+  __m256i west = _mm256_set1_epi32(WEST);
+  __m256i body_flag = _mm256_set1_epi32(TILE_BODY);
+  __m256i food_flag = _mm256_set1_epi32(TILE_FOOD);
+
+  for (int32 lane = 0; lane < batch->lane_count; lane += 8) {
+    __m256i alive = _mm256_cmpgt_epi32(_mm256_load_si256((__m256i *)(batch->alive + lane)), zero);
+    __m256i ticks_left = _mm256_load_si256((__m256i *)(batch->move_ticks_left + lane));
+    ticks_left = _mm256_sub_epi32(ticks_left, _mm256_and_si256(alive, one));
+    _mm256_store_si256((__m256i *)(batch->move_ticks_left + lane), ticks_left);
+
+    __m256i move = _mm256_and_si256(alive, _mm256_cmpgt_epi32(one, ticks_left));
+    int32 move_bits = _mm256_movemask_ps(_mm256_castsi256_ps(move));
+    if (move_bits == 0) {
+      // The common case. Nobody in this group moves on this tick.
+      continue;
+    }
+
+    // Pick up queued turns
+    __m256i new_dir = _mm256_load_si256((__m256i *)(batch->new_dir + lane));
+    __m256i turn = _mm256_andnot_si256(_mm256_cmpeq_epi32(new_dir, zero), move);
+    __m256i dir = _mm256_load_si256((__m256i *)(batch->dir + lane));
+    dir = _mm256_blendv_epi8(dir, new_dir, turn);
+    new_dir = _mm256_andnot_si256(turn, new_dir);
+    _mm256_store_si256((__m256i *)(batch->dir + lane), dir);
+    _mm256_store_si256((__m256i *)(batch->new_dir + lane), new_dir);
+
+    // Compare results are all ones (-1), so WEST - EAST gives the x step and so on
+    __m256i dx = _mm256_sub_epi32(_mm256_cmpeq_epi32(dir, west), _mm256_cmpeq_epi32(dir, east));
+    __m256i dy = _mm256_sub_epi32(_mm256_cmpeq_epi32(dir, north), _mm256_cmpeq_epi32(dir, south));
+    __m256i next_x = _mm256_add_epi32(_mm256_load_si256((__m256i *)(batch->head_x + lane)), _mm256_and_si256(dx, move));
+    __m256i next_y = _mm256_add_epi32(_mm256_load_si256((__m256i *)(batch->head_y + lane)), _mm256_and_si256(dy, move));
+
+    __m256i hits_wall = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi32(next_x, zero),
+                        _mm256_cmpeq_epi32(next_x, _mm256_load_si256((__m256i *)(batch->east_wall_x + lane)))),
+        _mm256_or_si256(_mm256_cmpeq_epi32(next_y, zero),
+                        _mm256_cmpeq_epi32(next_y, _mm256_load_si256((__m256i *)(batch->south_wall_y + lane)))));
+
+    __m256i stride = _mm256_load_si256((__m256i *)(batch->board_stride + lane));
+    __m256i tile = _mm256_add_epi32(next_x, _mm256_mullo_epi32(next_y, stride));
+
+    // Gather the board flags, four games at a time since the boards live in different
+    // blocks and need 64-bit offsets. Lanes that don't move are masked off.
+    __m256i offset_lo = _mm256_add_epi64(_mm256_load_si256((__m256i *)(batch->board_offset + lane)),
+                                         _mm256_cvtepi32_epi64(_mm256_castsi256_si128(tile)));
+    __m256i offset_hi = _mm256_add_epi64(_mm256_load_si256((__m256i *)(batch->board_offset + lane + 4)),
+                                         _mm256_cvtepi32_epi64(_mm256_extracti128_si256(tile, 1)));
+    __m128i flags_lo = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), (int const *)batch->board_base,
+                                                   offset_lo, _mm256_castsi256_si128(move), 1);
+    __m128i flags_hi = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), (int const *)batch->board_base,
+                                                   offset_hi, _mm256_extracti128_si256(move, 1), 1);
+    __m256i flags = _mm256_inserti128_si256(_mm256_castsi128_si256(flags_lo), flags_hi, 1);
+
+    __m256i hits_body = _mm256_cmpgt_epi32(_mm256_and_si256(flags, body_flag), zero);
+    __m256i dies = _mm256_and_si256(move, _mm256_or_si256(hits_wall, hits_body));
+    __m256i eats = _mm256_andnot_si256(dies, _mm256_and_si256(move, _mm256_cmpgt_epi32(_mm256_and_si256(flags, food_flag), zero)));
+    batch->food_hits += _mm_popcnt_u32(_mm256_movemask_ps(_mm256_castsi256_ps(eats)));
+
+    int32 next_x_lanes[8], next_y_lanes[8], tile_lanes[8];
+    _mm256_storeu_si256((__m256i *)next_x_lanes, next_x);
+    _mm256_storeu_si256((__m256i *)next_y_lanes, next_y);
+    _mm256_storeu_si256((__m256i *)tile_lanes, tile);
+    int32 die_bits = _mm256_movemask_ps(_mm256_castsi256_ps(dies));
+
+    while (move_bits) {
+      int32 bit = (int32)FindLeastSignificantSetBit((uint32)move_bits);
+      move_bits &= move_bits - 1;
+      BatchFinishMove(batch, lane + bit, next_x_lanes[bit], next_y_lanes[bit], tile_lanes[bit],
+                      (die_bits >> bit) & 1);
+    }
+  }
+}
+
+// The kernel four games at a time
+SIMD_TARGET("sse4.1") internal void
+BatchSimulateTick4(SnakeBatch *batch) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i one = _mm_set1_epi32(1);
+  __m128i north = _mm_set1_epi32(NORTH);
+  __m128i east = _mm_set1_epi32(EAST);
+  __m128i south = _mm_set1_epi32(SOUTH);
+  __m128i west = _mm_set1_epi32(WEST);
+
+  for (int32 lane = 0; lane < batch->lane_count; lane += 4) {
+    __m128i alive = _mm_cmpgt_epi32(_mm_load_si128((__m128i *)(batch->alive + lane)), zero);
+    __m128i ticks_left = _mm_load_si128((__m128i *)(batch->move_ticks_left + lane));
+    ticks_left = _mm_sub_epi32(ticks_left, _mm_and_si128(alive, one));
+    _mm_store_si128((__m128i *)(batch->move_ticks_left + lane), ticks_left);
+
+    __m128i move = _mm_and_si128(alive, _mm_cmpgt_epi32(one, ticks_left));
+    int32 move_bits = _mm_movemask_ps(_mm_castsi128_ps(move));
+    if (move_bits == 0) {
+      continue;
+    }
+
+    __m128i new_dir = _mm_load_si128((__m128i *)(batch->new_dir + lane));
+    __m128i turn = _mm_andnot_si128(_mm_cmpeq_epi32(new_dir, zero), move);
+    __m128i dir = _mm_load_si128((__m128i *)(batch->dir + lane));
+    dir = _mm_blendv_epi8(dir, new_dir, turn);
+    new_dir = _mm_andnot_si128(turn, new_dir);
+    _mm_store_si128((__m128i *)(batch->dir + lane), dir);
+    _mm_store_si128((__m128i *)(batch->new_dir + lane), new_dir);
+
+    __m128i dx = _mm_sub_epi32(_mm_cmpeq_epi32(dir, west), _mm_cmpeq_epi32(dir, east));
+    __m128i dy = _mm_sub_epi32(_mm_cmpeq_epi32(dir, north), _mm_cmpeq_epi32(dir, south));
+    __m128i next_x = _mm_add_epi32(_mm_load_si128((__m128i *)(batch->head_x + lane)), _mm_and_si128(dx, move));
+    __m128i next_y = _mm_add_epi32(_mm_load_si128((__m128i *)(batch->head_y + lane)), _mm_and_si128(dy, move));
+
+    __m128i hits_wall = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi32(next_x, zero),
+                     _mm_cmpeq_epi32(next_x, _mm_load_si128((__m128i *)(batch->east_wall_x + lane)))),
+        _mm_or_si128(_mm_cmpeq_epi32(next_y, zero),
+                     _mm_cmpeq_epi32(next_y, _mm_load_si128((__m128i *)(batch->south_wall_y + lane)))));
+    __m128i stride = _mm_load_si128((__m128i *)(batch->board_stride + lane));
+    __m128i tile = _mm_add_epi32(next_x, _mm_mullo_epi32(next_y, stride));
+
+    int32 next_x_lanes[4], next_y_lanes[4], tile_lanes[4];
+    _mm_storeu_si128((__m128i *)next_x_lanes, next_x);
+    _mm_storeu_si128((__m128i *)next_y_lanes, next_y);
+    _mm_storeu_si128((__m128i *)tile_lanes, tile);
+    int32 wall_bits = _mm_movemask_ps(_mm_castsi128_ps(hits_wall));
+
+    // No gathers before AVX2 so the flag lookups are scalar
+    while (move_bits) {
+      int32 bit = (int32)FindLeastSignificantSetBit((uint32)move_bits);
+      move_bits &= move_bits - 1;
+      int32 game = lane + bit;
+      uint8 flags = batch->board_base[batch->board_offset[game] + tile_lanes[bit]];
+      bool32 dies = ((wall_bits >> bit) & 1) || (flags & TILE_BODY);
+      if (!dies && (flags & TILE_FOOD)) {
+        ++batch->food_hits;
+      }
+      BatchFinishMove(batch, game, next_x_lanes[bit], next_y_lanes[bit], tile_lanes[bit], dies);
+    }
+  }
+}
+
+/* Advances every game in the batch by one tick. */
+void BatchSimulateTick(SnakeBatch *batch) {
+  if (batch->width == 8) {
+    BatchSimulateTick8(batch);
+  }
+  else if (batch->width == 4) {
+    BatchSimulateTick4(batch);
+  }
+  else {
+    for (int32 lane = 0; lane < batch->lane_count; ++lane) {
+      BatchSimulateLane(batch, lane);
+    }
+  }
+
+  ++batch->ticks;
+}
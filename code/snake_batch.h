@@ -0,0 +1,53 @@
+#if !defined(SNAKE_BATCH_H)
+
+/* Structure-of-arrays stepping for many independent games.
+ *
+ * The fields every game touches on every tick (move timer, direction, head, alive) are
+ * pulled out of each GameState into lane arrays so that up to SNAKE_BATCH_MAX_WIDTH games
+ * can be advanced per instruction. Only games that actually move on a tick go back to their
+ * GameState for the ring, board and food work, through the same AdvanceSnake that the
+ * scalar UpdateSnake uses. The results are bit-identical to calling SimulateTick on each
+ * game.
+ *
+ * While a batch is loaded the lane arrays are the authoritative copy of those fields. Call
+ * BatchStoreLane before reading a GameState directly and BatchLoadLane after changing one.
+ */
+
+// The kernel takes 8 games a step with AVX2, 4 with SSE4.1 and 1 otherwise (see
+// GetSimdLevel). Lanes are always padded for the widest.
+#define SNAKE_BATCH_MAX_WIDTH 8
+
+struct SnakeBatch {
+  int32 game_count;
+  int32 lane_count; // game_count rounded up to SNAKE_BATCH_MAX_WIDTH
+  int32 width; // games per step on this machine
+  GameState **states;
+
+  // Hot lanes, one entry per game
+  int32 *head_x;
+  int32 *head_y;
+  int32 *dir;
+  int32 *new_dir;
+  int32 *length;
+  int32 *alive;
+  int32 *move_ticks_left;
+  int32 *move_interval;
+
+  // Per game constants
+  int32 *east_wall_x;
+  int32 *south_wall_y;
+  int32 *board_stride;
+  int64 *board_offset; // from board_base so the gather can use 64-bit indices
+  uint8 *board_base;
+
+  uint64 ticks;
+  uint64 *tick_base; // sim_tick = tick_base + ticks
+
+  // Stats
+  uint64 moves;
+  uint64 food_hits;
+  uint64 deaths;
+};
+
+#define SNAKE_BATCH_H
+#endif
@@ -0,0 +1,1103 @@
+/* Benchmarks for the platform independent game layer.
+ *
+ * This is a console program that pulls in the game code directly so that internal
+ * functions can be timed without going through the DLL interface. Run it from a shell
+ * and compare the numbers before and after a change.
+ */
+
+#include "snake_game.cpp"
+#include "snake_batch.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if SNAKE_WIN32
+#include <windows.h>
+#include "win32_work_queue.cpp"
+#define BenchMakeQueue Win32MakeQueue
+#define BenchAddEntry Win32AddEntry
+#define BenchCompleteAllWork Win32CompleteAllWork
+#else
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "linux_work_queue.cpp"
+#include "linux_code_watch.cpp"
+#include "linux_frame_pacer.cpp"
+#define BenchMakeQueue LinuxMakeQueue
+#define BenchAddEntry LinuxAddEntry
+#define BenchCompleteAllWork LinuxCompleteAllWork
+#endif
+
+// ---------------------------------------------------------------------------------------
+// Utils
+// ---------------------------------------------------------------------------------------
+
+internal real64
+BenchGetSeconds() {
+#if SNAKE_WIN32
+  LARGE_INTEGER counter, freq;
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&freq);
+  return (real64)counter.QuadPart / (real64)freq.QuadPart;
+#else
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (real64)spec.tv_sec + ((real64)spec.tv_nsec / 1e9);
+#endif
+}
+
+/* Hands memory zeroed storage of the given sizes for a tiles_x by tiles_y board, the way
+ * a platform layer does at startup. Anything else in the config is the caller's to set
+ * before the game first sees it. Pair with BenchFreeMemory.
+ */
+internal void
+BenchCreateMemory(GameMemory *memory, int32 tiles_x, int32 tiles_y, uint64 seed, uint64 stream,
+                  uint64 permanent_storage_size, uint64 temp_storage_size) {
+  *memory = {};
+  memory->config.tiles_x = tiles_x;
+  memory->config.tiles_y = tiles_y;
+  memory->rand_seed = seed;
+  memory->rand_rounds = stream;
+  memory->permanent_storage_size = permanent_storage_size;
+  memory->temp_storage_size = temp_storage_size;
+  memory->permanent_storage = calloc(1, (size_t)permanent_storage_size);
+  memory->temp_storage = calloc(1, (size_t)temp_storage_size);
+}
+
+internal void
+BenchFreeMemory(GameMemory *memory) {
+  free(memory->permanent_storage);
+  free(memory->temp_storage);
+}
+
+// ---------------------------------------------------------------------------------------
+// Free tile sampling
+// ---------------------------------------------------------------------------------------
+
+/* Fills a board with the free tile index the same way CreateFood does and reports the
+ * cost per placement as the board fills up. The rejection sampler that the index replaced
+ * is timed alongside it so that the difference at high fill levels is obvious.
+ */
+internal void
+BenchFreeTileFill(int32 tiles_x, int32 tiles_y, real64 target_fill) {
+  int32 tile_count = tiles_x * tiles_y;
+  int32 *tiles = (int32 *)malloc(tile_count * sizeof(int32));
+  int32 *positions = (int32 *)malloc(tile_count * sizeof(int32));
+  uint8 *board = (uint8 *)calloc(tile_count, sizeof(uint8));
+
+  pcg32_random_t random;
+  pcg32_srandom_r(&random, 8000, 1);
+
+  FreeTileIndex index;
+  InitFreeTileIndex(&index, tiles, positions, tile_count);
+  for (int32 tile = 0; tile < tile_count; ++tile) {
+    AddFreeTile(&index, tile);
+  }
+
+  printf("free tile fill: %dx%d board to %.1f%% occupancy\n", tiles_x, tiles_y, target_fill * 100.0);
+
+  real64 checkpoints[] = {0.5, 0.9, 0.99, target_fill};
+  int checkpoint_idx = 0;
+  int32 placed = 0;
+  int32 last_placed = 0;
+  int32 target_placed = (int32)(target_fill * (real64)tile_count);
+  real64 start = BenchGetSeconds();
+  real64 last_time = start;
+
+  while (placed < target_placed) {
+    int32 tile = RandomFreeTile(&index, &random);
+    Assert(tile >= 0 && board[tile] == TILE_EMPTY);
+    RemoveFreeTile(&index, tile);
+    board[tile] = TILE_FOOD;
+    ++placed;
+
+    if (placed >= (int32)(checkpoints[checkpoint_idx] * (real64)tile_count)) {
+      real64 now = BenchGetSeconds();
+      printf("  index    %6.2f%% full: %8.2f ns/placement\n",
+             100.0 * (real64)placed / (real64)tile_count,
+             1e9 * (now - last_time) / (real64)(placed - last_placed));
+      last_time = now;
+      last_placed = placed;
+      ++checkpoint_idx;
+    }
+  }
+  real64 index_seconds = BenchGetSeconds() - start;
+
+  // Churn at the target fill: free one tile and claim another, like a snake moving while
+  // food keeps spawning.
+  int32 churn_count = 1000000;
+  start = BenchGetSeconds();
+  for (int32 idx = 0; idx < churn_count; ++idx) {
+    int32 occupied;
+    do {
+      occupied = (int32)pcg32_boundedrand_r(&random, tile_count);
+    } while (board[occupied] == TILE_EMPTY);
+    board[occupied] = TILE_EMPTY;
+    AddFreeTile(&index, occupied);
+
+    int32 tile = RandomFreeTile(&index, &random);
+    RemoveFreeTile(&index, tile);
+    board[tile] = TILE_FOOD;
+  }
+  real64 churn_seconds = BenchGetSeconds() - start;
+  printf("  index    churn at %.1f%%: %8.2f ns/placement\n",
+         100.0 * (real64)(tile_count - index.count) / (real64)tile_count,
+         1e9 * churn_seconds / (real64)churn_count);
+
+  // Rejection sampling at the same fill level for comparison.
+  int32 rejection_count = 10000;
+  uint64 draws = 0;
+  start = BenchGetSeconds();
+  for (int32 idx = 0; idx < rejection_count; ++idx) {
+    for (;;) {
+      ++draws;
+      int32 tile = (int32)pcg32_boundedrand_r(&random, tile_count);
+      if (board[tile] == TILE_EMPTY) {
+        break;
+      }
+    }
+  }
+  real64 rejection_seconds = BenchGetSeconds() - start;
+  printf("  rejection at %.1f%%: %8.2f ns/placement, %.1f draws/placement\n",
+         100.0 * (real64)(tile_count - index.count) / (real64)tile_count,
+         1e9 * rejection_seconds / (real64)rejection_count,
+         (real64)draws / (real64)rejection_count);
+  printf("  total fill time %.3fs\n", index_seconds);
+
+  free(board);
+  free(positions);
+  free(tiles);
+}
+
+// ---------------------------------------------------------------------------------------
+// Batched sim
+// ---------------------------------------------------------------------------------------
+
+internal GameState *
+BenchCreateGame(GameMemory *memory, int32 tiles_x, int32 tiles_y, uint64 seed, uint64 stream) {
+  uint64 tile_count = (uint64)(tiles_x + 2) * (uint64)(tiles_y + 2);
+  BenchCreateMemory(memory, tiles_x, tiles_y, seed, stream,
+                    Kilobytes(64) + tile_count * 32,
+                    Kilobytes(64) + tile_count * 2); // autopilot scratch
+
+  GameState *state = (GameState *)memory->permanent_storage;
+  GameOffscreenBuffer no_screen = {};
+  ThreadContext thread = {};
+  InitializeGame(memory, state, &no_screen);
+  ResetGame(&thread, memory, state);
+  memory->is_initialized = true;
+  return state;
+}
+
+// Scripted input shared by both paths: a turn request now and then, from its own stream.
+inline Direction
+BenchScriptedTurn(pcg32_random_t *input_rng) {
+  uint32 r = pcg32_random_r(input_rng);
+  Direction result = NONE;
+  if ((r & 7) == 0) {
+    result = (Direction)(((r >> 3) & 3) + 1);
+  }
+  return result;
+}
+
+internal bool32
+BenchGamesMatch(GameState *a, GameState *b) {
+  bool32 result = (a->sim_tick == b->sim_tick &&
+                   a->score == b->score &&
+                   a->num_foods == b->num_foods &&
+                   a->snake_move_ticks_left == b->snake_move_ticks_left &&
+                   a->snake_move_interval == b->snake_move_interval &&
+                   a->snake.length == b->snake.length &&
+                   a->snake.head_idx == b->snake.head_idx &&
+                   a->snake.pending_growth == b->snake.pending_growth &&
+                   a->snake.alive == b->snake.alive &&
+                   a->snake.dir == b->snake.dir &&
+                   a->snake.new_direction == b->snake.new_direction &&
+                   a->rng.state == b->rng.state &&
+                   a->free_tiles.count == b->free_tiles.count &&
+                   GameStateHash(a) == GameStateHash(b));
+  result = result && (memcmp(a->board, b->board, a->board_tile_count) == 0);
+  result = result && (memcmp(a->foods, b->foods, a->num_foods * sizeof(SnakeFood)) == 0);
+  result = result && (memcmp(a->snake.pieces, b->snake.pieces, a->snake.ring_size * sizeof(SnakePiece)) == 0);
+  return result;
+}
+
+/* Runs the same games with the same scripted input through SimulateTick one game at a time
+ * and through the batched kernel, then checks that every game ended up bit-identical.
+ */
+internal void
+BenchSnakeBatch(int32 game_count, int32 tick_count, int32 tiles_x, int32 tiles_y) {
+  GameMemory *scalar_memories = (GameMemory *)calloc(game_count, sizeof(GameMemory));
+  GameMemory *batch_memories = (GameMemory *)calloc(game_count, sizeof(GameMemory));
+  GameState **scalar_states = (GameState **)calloc(game_count, sizeof(GameState *));
+  GameState **batch_states = (GameState **)calloc(game_count, sizeof(GameState *));
+  pcg32_random_t *scalar_inputs = (pcg32_random_t *)calloc(game_count, sizeof(pcg32_random_t));
+  pcg32_random_t *batch_inputs = (pcg32_random_t *)calloc(game_count, sizeof(pcg32_random_t));
+  for (int32 game_idx = 0; game_idx < game_count; ++game_idx) {
+    scalar_states[game_idx] = BenchCreateGame(&scalar_memories[game_idx], tiles_x, tiles_y, 8000, game_idx);
+    batch_states[game_idx] = BenchCreateGame(&batch_memories[game_idx], tiles_x, tiles_y, 8000, game_idx);
+    pcg32_srandom_r(&scalar_inputs[game_idx], 1234, game_idx);
+    pcg32_srandom_r(&batch_inputs[game_idx], 1234, game_idx);
+  }
+
+  ThreadContext thread = {};
+
+  // Scalar
+  real64 start = BenchGetSeconds();
+  for (int32 tick = 0; tick < tick_count; ++tick) {
+    for (int32 game_idx = 0; game_idx < game_count; ++game_idx) {
+      GameState *state = scalar_states[game_idx];
+      if (!state->snake.alive) {
+        ResetGame(&thread, &scalar_memories[game_idx], state);
+      }
+      Direction turn = BenchScriptedTurn(&scalar_inputs[game_idx]);
+      if (turn != NONE) {
+        ChangeSnakeDirection(&state->snake, turn);
+      }
+      SimulateTick(state);
+    }
+  }
+  real64 scalar_seconds = BenchGetSeconds() - start;
+
+  // Batched
+  size_t batch_storage_size = Megabytes(1) + game_count * 128;
+  void *batch_storage = calloc(1, batch_storage_size);
+  MemoryArena batch_arena;
+  InitializeArena(&batch_arena, batch_storage_size, batch_storage);
+  SnakeBatch batch;
+  InitializeSnakeBatch(&batch, &batch_arena, batch_states, game_count);
+  BatchLoad(&batch);
+  printf("batched sim: %d games on a %dx%d board, %d ticks, %d lanes per step\n",
+         game_count, tiles_x, tiles_y, tick_count, batch.width);
+
+  start = BenchGetSeconds();
+  for (int32 tick = 0; tick < tick_count; ++tick) {
+    for (int32 game_idx = 0; game_idx < game_count; ++game_idx) {
+      if (!batch.alive[game_idx]) {
+        BatchStoreLane(&batch, game_idx);
+        ResetGame(&thread, &batch_memories[game_idx], batch_states[game_idx]);
+        BatchLoadLane(&batch, game_idx);
+      }
+      Direction turn = BenchScriptedTurn(&batch_inputs[game_idx]);
+      if (turn != NONE) {
+        BatchChangeDirection(&batch, game_idx, turn);
+      }
+    }
+    BatchSimulateTick(&batch);
+  }
+  real64 batch_seconds = BenchGetSeconds() - start;
+  BatchStore(&batch);
+
+  int32 mismatches = 0;
+  for (int32 game_idx = 0; game_idx < game_count; ++game_idx) {
+    if (!BenchGamesMatch(scalar_states[game_idx], batch_states[game_idx])) {
+      ++mismatches;
+    }
+  }
+
+  real64 total_ticks = (real64)game_count * (real64)tick_count;
+  printf("  scalar  %12.0f ticks/sec\n", total_ticks / scalar_seconds);
+  printf("  batched %12.0f ticks/sec (%.2fx), %llu moves, %llu food hits, %llu deaths\n",
+         total_ticks / batch_seconds, scalar_seconds / batch_seconds,
+         (unsigned long long)batch.moves, (unsigned long long)batch.food_hits,
+         (unsigned long long)batch.deaths);
+  printf("  %s: %d of %d games differ\n", mismatches ? "MISMATCH" : "bit-identical", mismatches, game_count);
+
+  for (int32 game_idx = 0; game_idx < game_count; ++game_idx) {
+    BenchFreeMemory(&scalar_memories[game_idx]);
+    BenchFreeMemory(&batch_memories[game_idx]);
+  }
+  free(batch_storage);
+  free(batch_inputs);
+  free(scalar_inputs);
+  free(batch_states);
+  free(scalar_states);
+  free(batch_memories);
+  free(scalar_memories);
+}
+
+// ---------------------------------------------------------------------------------------
+// Swarm
+// ---------------------------------------------------------------------------------------
+
+/* One core stepping a big swarm. The budget is a 60Hz tick, so anything under 16.7ms per
+ * tick keeps up in real time.
+ *
+ * Snakes start start_length long. Spread over a big board, one tile snakes almost never
+ * meet, and then the collision handling never shows up in the timing.
+ */
+internal void
+BenchSwarm(int32 snake_count, int32 tiles_x, int32 tiles_y, int32 tick_count, int32 start_length) {
+  GameMemory memory;
+  BenchCreateMemory(&memory, tiles_x, tiles_y, 8000, 1,
+                    Megabytes(1) + ((uint64)(tiles_x + 2) * (uint64)(tiles_y + 2) * 16) +
+                    ((uint64)snake_count * Kilobytes(8)),
+                    Kilobytes(64));
+  memory.config.swarm_snake_count = snake_count;
+  memory.config.swarm_start_length = start_length;
+
+  GameState *state = (GameState *)memory.permanent_storage;
+  GameOffscreenBuffer no_screen = {};
+  ThreadContext thread = {};
+  InitializeGame(&memory, state, &no_screen);
+  real64 start = BenchGetSeconds();
+  ResetGame(&thread, &memory, state);
+  real64 reset_seconds = BenchGetSeconds() - start;
+  memory.is_initialized = true;
+
+  real64 worst_tick_seconds = 0.0;
+  start = BenchGetSeconds();
+  for (int32 tick = 0; tick < tick_count; ++tick) {
+    real64 tick_start = BenchGetSeconds();
+    SimulateSwarmTick(state);
+    worst_tick_seconds = Max(worst_tick_seconds, BenchGetSeconds() - tick_start);
+  }
+  real64 seconds = BenchGetSeconds() - start;
+
+  SwarmState *swarm = &state->swarm;
+  int32 alive = 0;
+  int64 total_length = 0;
+  int32 longest = 0;
+  int64 kills = 0;
+  for (int32 snake_idx = 0; snake_idx < swarm->snake_count; ++snake_idx) {
+    SnakeState *snake = &swarm->snakes[snake_idx].body;
+    kills += swarm->snakes[snake_idx].kills;
+    if (snake->alive) {
+      ++alive;
+      total_length += snake->length;
+      longest = Max(longest, snake->length);
+    }
+  }
+
+  // NOTE: every death is a collision, with a wall, a body or another head
+  printf("swarm: %d snakes on a %dx%d board starting %d long, %d ticks\n",
+         snake_count, tiles_x, tiles_y, start_length, tick_count);
+  printf("  reset %.2fms, %.4fms avg / %.4fms worst per tick, %.0f ticks/sec (%.0fx the %d Hz budget)\n",
+         reset_seconds * 1000.0, (seconds * 1000.0) / tick_count, worst_tick_seconds * 1000.0,
+         tick_count / seconds, (tick_count / seconds) / SIM_TICKS_PER_SECOND, SIM_TICKS_PER_SECOND);
+  printf("  over those ticks: %llu collisions, %llu head-on, %lld into another snake's body\n",
+         (unsigned long long)swarm->deaths, (unsigned long long)swarm->head_on_collisions, (long long)kills);
+  printf("  at the end: %d alive, avg length %.1f, longest %d, %d foods\n",
+         alive, alive ? (real64)total_length / alive : 0.0, longest, state->num_foods);
+
+  BenchFreeMemory(&memory);
+}
+
+// ---------------------------------------------------------------------------------------
+// Autopilot
+// ---------------------------------------------------------------------------------------
+
+// Replaces the snake with one `length` long laid along the autopilot's cycle.
+internal void
+BenchLaySnakeOnCycle(GameState *state, int32 length) {
+  Autopilot *autopilot = &state->autopilot;
+  SnakeState *snake = &state->snake;
+  for (int piece_idx = 0; piece_idx < snake->length; ++piece_idx) {
+    SnakePiece *piece = GetSnakePiece(snake, piece_idx);
+    VacateTile(state, BoardTileIndex(state, piece->x, piece->y), TILE_BODY);
+  }
+
+  snake->length = length;
+  snake->head_idx = length - 1;
+  snake->pending_growth = 0;
+  snake->new_direction = NONE;
+  for (int32 piece_idx = 0; piece_idx < length; ++piece_idx) {
+    SnakePiece piece = CycleTile(autopilot, piece_idx);
+    snake->pieces[piece_idx] = piece;
+    OccupyTile(state, BoardTileIndex(state, piece.x, piece.y), TILE_BODY);
+  }
+  SnakePiece next = CycleTile(autopilot, length % autopilot->cycle_length);
+  snake->dir = DirectionBetween(GetSnakeHead(snake), &next);
+}
+
+/* Average time per autopilot decision for a snake covering `fill` of the board. The snake
+ * keeps playing for `move_count` moves so the food search sees a range of distances.
+ */
+internal void
+BenchAutopilotDecisions(int32 tiles_per_side, real32 fill, int32 move_count) {
+  GameMemory memory;
+  GameState *state = BenchCreateGame(&memory, tiles_per_side, tiles_per_side, 8000, 3);
+  state->autopilot.enabled = true;
+  int32 length = Max(1, (int32)(fill * (real32)(tiles_per_side * tiles_per_side)));
+  BenchLaySnakeOnCycle(state, length);
+
+  real64 total_seconds = 0.0;
+  real64 worst_seconds = 0.0;
+  int32 moves = 0;
+  for (; moves < move_count && state->snake.alive; ++moves) {
+    real64 start = BenchGetSeconds();
+    AutopilotDecide(state);
+    real64 seconds = BenchGetSeconds() - start;
+    total_seconds += seconds;
+    worst_seconds = Max(worst_seconds, seconds);
+    UpdateSnake(state);
+  }
+
+  Autopilot *autopilot = &state->autopilot;
+  printf("  %4dx%-4d length %7d: %9.2fus avg %9.2fus worst, %llu food / %llu cycle / %llu room moves, %llu over budget%s\n",
+         tiles_per_side, tiles_per_side, length,
+         (total_seconds * 1e6) / Max(1, moves), worst_seconds * 1e6,
+         (unsigned long long)autopilot->food_moves, (unsigned long long)autopilot->cycle_moves,
+         (unsigned long long)autopilot->room_moves, (unsigned long long)autopilot->budget_hits,
+         state->snake.alive ? "" : ", DIED");
+  BenchFreeMemory(&memory);
+}
+
+// Plays a whole game on a small board and reports how far the autopilot got.
+internal void
+BenchAutopilotGame(int32 tiles_x, int32 tiles_y, uint64 max_ticks) {
+  GameMemory memory;
+  GameState *state = BenchCreateGame(&memory, tiles_x, tiles_y, 8000, 4);
+  state->autopilot.enabled = true;
+  SnakeState *snake = &state->snake;
+
+  real64 start = BenchGetSeconds();
+  uint64 tick = 0;
+  for (; tick < max_ticks && snake->alive && snake->length < snake->max_length; ++tick) {
+    AutopilotTick(state);
+    SimulateTick(state);
+  }
+  real64 seconds = BenchGetSeconds() - start;
+
+  printf("  %dx%d game: length %d of %d after %llu ticks (%.2fs), %s, %.2fus per decision\n",
+         tiles_x, tiles_y, snake->length, snake->max_length, (unsigned long long)tick, seconds,
+         !snake->alive ? "died" : (snake->length == snake->max_length ? "board full" : "out of ticks"),
+         (seconds * 1e6) / Max(1, state->autopilot.decisions));
+  BenchFreeMemory(&memory);
+}
+
+internal void
+BenchAutopilot() {
+  printf("autopilot decisions, budget %d words:\n", AUTOPILOT_WORD_BUDGET);
+  int32 sides[] = {32, 128, 512};
+  real32 fills[] = {0.0f, 0.25f, 0.5f, 0.9f};
+  for (int32 side_idx = 0; side_idx < ArrayCount(sides); ++side_idx) {
+    for (int32 fill_idx = 0; fill_idx < ArrayCount(fills); ++fill_idx) {
+      BenchAutopilotDecisions(sides[side_idx], fills[fill_idx], 500);
+    }
+  }
+  BenchAutopilotGame(16, 16, 10000000);
+  BenchAutopilotGame(24, 15, 10000000);
+  BenchAutopilotGame(32, 32, 100000000);
+  BenchAutopilotGame(15, 15, 10000000); // no cycle
+}
+
+// ---------------------------------------------------------------------------------------
+// State hashing
+// ---------------------------------------------------------------------------------------
+
+/* What a desync check costs per tick with the incrementally kept board hash versus
+ * recomputing it, one tile at a time and with SIMD, on a board `fill` covered by snake.
+ * A food flag on the tail tile flips between repeats so no two hashes are of the same
+ * board, and every recompute has to agree with the incremental hash.
+ */
+internal void
+BenchStateHash(int32 tiles_per_side, real32 fill, int32 repeat_count) {
+  GameMemory memory;
+  GameState *state = BenchCreateGame(&memory, tiles_per_side, tiles_per_side, 8000, 5);
+  int32 length = Max(1, (int32)(fill * (real32)(tiles_per_side * tiles_per_side)));
+  BenchLaySnakeOnCycle(state, length);
+  SnakePiece *tail = GetSnakePiece(&state->snake, 0);
+  int32 flip_tile_idx = BoardTileIndex(state, tail->x, tail->y);
+
+  uint64 *expected = (uint64 *)calloc(repeat_count, sizeof(uint64));
+  int32 mismatches = 0;
+
+  real64 start = BenchGetSeconds();
+  for (int32 repeat = 0; repeat < repeat_count; ++repeat) {
+    state->board[flip_tile_idx] ^= TILE_FOOD;
+    expected[repeat] = ComputeBoardHashScalar(state);
+  }
+  real64 scalar_seconds = (BenchGetSeconds() - start) / repeat_count;
+
+  start = BenchGetSeconds();
+  for (int32 repeat = 0; repeat < repeat_count; ++repeat) {
+    state->board[flip_tile_idx] ^= TILE_FOOD;
+    mismatches += (ComputeBoardHash(state) != expected[repeat]);
+  }
+  real64 simd_seconds = (BenchGetSeconds() - start) / repeat_count;
+
+  // NOTE: repeat counts are even so the board is back to where it started
+  for (int32 repeat = 0; repeat < repeat_count; ++repeat) {
+    if (repeat & 1) {
+      VacateTile(state, flip_tile_idx, TILE_FOOD);
+    }
+    else {
+      OccupyTile(state, flip_tile_idx, TILE_FOOD);
+    }
+    mismatches += (state->board_hash != expected[repeat]);
+  }
+
+  int32 state_hash_count = 1000000;
+  uint64 last_state_hash = GameStateHash(state);
+  start = BenchGetSeconds();
+  for (int32 repeat = 0; repeat < state_hash_count; ++repeat) {
+    ++state->sim_tick;
+    uint64 state_hash = GameStateHash(state);
+    mismatches += (state_hash == last_state_hash); // every tick has to hash differently
+    last_state_hash = state_hash;
+  }
+  real64 incremental_seconds = (BenchGetSeconds() - start) / state_hash_count;
+  mismatches += (GameStateHash(state) != FullGameStateHash(state));
+
+  printf("  %4dx%-4d length %8d: scalar %9.1fus, %d wide %9.1fus (%.1fx), incremental %6.1fns%s\n",
+         tiles_per_side, tiles_per_side, length, scalar_seconds * 1e6,
+         BoardHashWidth(), simd_seconds * 1e6, scalar_seconds / simd_seconds,
+         incremental_seconds * 1e9, mismatches ? ", MISMATCH" : "");
+  free(expected);
+  BenchFreeMemory(&memory);
+}
+
+internal void
+BenchStateHashes() {
+  printf("state hash, full recompute vs incremental:\n");
+  BenchStateHash(256, 0.1f, 100);
+  BenchStateHash(1024, 0.1f, 20);
+  BenchStateHash(1024, 0.9f, 20);
+  BenchStateHash(2048, 0.5f, 6);
+}
+
+// ---------------------------------------------------------------------------------------
+// Rect fill
+// ---------------------------------------------------------------------------------------
+
+// The column at a time fill that FillRect replaced, kept here to measure against
+internal void
+BenchDrawRectColumns(GameOffscreenBuffer* buffer, uint32 color,
+                     int x_start, int y_start, int width, int height) {
+  uint8 *end_of_buffer = (uint8 *)buffer->memory + (buffer->height * buffer->pitch);
+  for (int x = x_start; x < x_start + width; ++x) {
+    uint8 *pixel = (uint8 *)buffer->memory +
+                   (x * buffer->bytes_per_pixel) +
+                   (y_start * buffer->pitch);
+    for (int y = y_start; y < y_start + height; ++y) {
+      Assert((pixel >= buffer->memory) && ((pixel + buffer->bytes_per_pixel) <= end_of_buffer));
+      *(uint32 *)pixel = color;
+      pixel += buffer->pitch;
+    }
+  }
+}
+
+/* Covers a whole backbuffer in tile_size blocks the way RenderGrid does, with the old
+ * column fill and with FillRect, and checks both leave the same pixels behind.
+ */
+internal void
+BenchFillRect(int32 width, int32 height, int32 tile_size, int32 frame_count) {
+  GameOffscreenBuffer buffers[2] = {};
+  for (int32 buffer_idx = 0; buffer_idx < ArrayCount(buffers); ++buffer_idx) {
+    GameOffscreenBuffer *buffer = &buffers[buffer_idx];
+    buffer->width = width;
+    buffer->height = height;
+    buffer->bytes_per_pixel = sizeof(uint32);
+    buffer->pitch = width * buffer->bytes_per_pixel;
+    buffer->memory = malloc((size_t)(buffer->pitch * height));
+    memset(buffer->memory, 0, (size_t)(buffer->pitch * height)); // fault the pages in before timing
+  }
+
+  int32 tiles_x = width / tile_size;
+  int32 tiles_y = height / tile_size;
+  real64 seconds[2];
+  for (int32 buffer_idx = 0; buffer_idx < ArrayCount(buffers); ++buffer_idx) {
+    GameOffscreenBuffer *buffer = &buffers[buffer_idx];
+    real64 start = BenchGetSeconds();
+    for (int32 frame = 0; frame < frame_count; ++frame) {
+      uint32 color = RGBColor(frame & 0xFF, 255, 255);
+      for (int32 tile_y = 0; tile_y < tiles_y; ++tile_y) {
+        for (int32 tile_x = 0; tile_x < tiles_x; ++tile_x) {
+          if (buffer_idx == 0) {
+            BenchDrawRectColumns(buffer, color, tile_x * tile_size, tile_y * tile_size, tile_size, tile_size);
+          }
+          else {
+            FillRect(buffer, color, tile_x * tile_size, tile_y * tile_size, tile_size, tile_size);
+          }
+        }
+      }
+    }
+    seconds[buffer_idx] = (BenchGetSeconds() - start) / frame_count;
+  }
+
+  bool32 same = (memcmp(buffers[0].memory, buffers[1].memory, (size_t)(buffers[0].pitch * height)) == 0);
+  real64 megapixels = (real64)(tiles_x * tile_size) * (real64)(tiles_y * tile_size) / 1e6;
+  printf("  %dx%d in %3dpx tiles: columns %8.3fms, rows %d wide %8.3fms (%.1fx), %.0f Mpixel/s%s\n",
+         width, height, tile_size, seconds[0] * 1000.0, RenderFillWidth(), seconds[1] * 1000.0,
+         seconds[0] / seconds[1], megapixels / seconds[1], same ? "" : ", MISMATCH");
+
+  for (int32 buffer_idx = 0; buffer_idx < ArrayCount(buffers); ++buffer_idx) {
+    free(buffers[buffer_idx].memory);
+  }
+}
+
+internal void
+BenchFillRects() {
+  printf("rect fill, one frame of tiles:\n");
+  int32 tile_sizes[] = {2, 5, 16, 40, 1080};
+  for (int32 size_idx = 0; size_idx < ArrayCount(tile_sizes); ++size_idx) {
+    BenchFillRect(1920, 1080, tile_sizes[size_idx], 60);
+  }
+}
+
+/* Renders the same autopilot game at 60Hz twice, repainting everything every frame and
+ * repainting only what changed, and reports what a frame costs each way along with how
+ * many commands the full repaint pushed and how many fills they came down to.
+ */
+internal void
+BenchRenderFrames(int32 tiles_per_side, int32 width, int32 height, int32 frame_count) {
+  real64 seconds[2];
+  real64 blit_pixels[2];
+  RenderStats totals[2] = {};
+  for (int32 pass = 0; pass < 2; ++pass) {
+    bool32 repaint_everything = (pass == 0);
+    GameMemory memory;
+    uint64 tile_count = (uint64)(tiles_per_side + 2) * (uint64)(tiles_per_side + 2);
+    BenchCreateMemory(&memory, tiles_per_side, tiles_per_side, 8000, 6,
+                      Kilobytes(64) + tile_count * 32,
+                      Megabytes(1) + tile_count * 32); // room for a full repaint's commands
+
+    GameOffscreenBuffer screen = {};
+    screen.width = width;
+    screen.height = height;
+    screen.bytes_per_pixel = sizeof(uint32);
+    screen.pitch = width * screen.bytes_per_pixel;
+    screen.memory = calloc(1, (size_t)(screen.pitch * height));
+
+    GameState *state = (GameState *)memory.permanent_storage;
+    ThreadContext thread = {};
+    GameInput input = {};
+    input.dt_for_frame = 1.0f / 60.0f;
+    seconds[pass] = 0.0;
+    blit_pixels[pass] = 0.0;
+    for (int32 frame = 0; frame < frame_count; ++frame) {
+      GameControllerInput *controller = GetController(&input, 0);
+      bool32 press = (frame == 0) || (memory.is_initialized && !state->snake.alive);
+      controller->start.ended_down = press;
+      controller->start.half_transition_count = press;
+      controller->back.ended_down = (frame == 0);
+      controller->back.half_transition_count = (frame < 2);
+
+      screen.needs_full_repaint = repaint_everything;
+      screen.dirty_min_x = screen.dirty_max_x = 0;
+      screen.dirty_min_y = screen.dirty_max_y = 0;
+      if (UpdateGame(&thread, &memory, &input, &screen)) {
+        real64 start = BenchGetSeconds();
+        RenderGame(&memory, &screen);
+        seconds[pass] += BenchGetSeconds() - start;
+        blit_pixels[pass] += (real64)(screen.dirty_max_x - screen.dirty_min_x) *
+                             (real64)(screen.dirty_max_y - screen.dirty_min_y);
+        totals[pass].commands += state->render_stats.commands;
+        totals[pass].culled += state->render_stats.culled;
+        totals[pass].fills += state->render_stats.fills;
+        totals[pass].pixels += state->render_stats.pixels;
+      }
+    }
+
+    BenchFreeMemory(&memory);
+    free(screen.memory);
+  }
+
+  printf("  %4dx%-4d on %dx%d: everything %8.3fms, changes %8.3fms (%.0fx), %.2f%% of the screen blitted\n",
+         tiles_per_side, tiles_per_side, width, height,
+         (seconds[0] * 1000.0) / frame_count, (seconds[1] * 1000.0) / frame_count,
+         seconds[0] / seconds[1],
+         100.0 * blit_pixels[1] / ((real64)frame_count * (real64)width * (real64)height));
+  printf("             full repaint: %u commands, %u culled, %u fills, %.0f pixels per frame\n",
+         totals[0].commands / frame_count, totals[0].culled / frame_count,
+         totals[0].fills / frame_count, (real64)totals[0].pixels / frame_count);
+}
+
+internal void
+BenchRender() {
+  printf("render per frame, full repaint vs dirty tiles:\n");
+  BenchRenderFrames(32, 1280, 720, 3000);
+  BenchRenderFrames(128, 1280, 720, 3000);
+  BenchRenderFrames(512, 1920, 1080, 3000);
+  BenchRenderFrames(1024, 1920, 1080, 3000);
+}
+
+internal int32
+BenchCoreCount() {
+#if SNAKE_WIN32
+  SYSTEM_INFO system_info;
+  GetSystemInfo(&system_info);
+  int32 result = (int32)system_info.dwNumberOfProcessors;
+#else
+  int32 result = (int32)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return Max(result, 1);
+}
+
+/* Full repaints of a 4K screen of small tiles with 1 to N threads drawing. The game is
+ * played for a while first so there's a snake and food on the board, then the same frame
+ * is drawn over and over, and every thread count has to leave the exact pixels the single
+ * threaded renderer does.
+ */
+internal void
+BenchTiledRender(int32 tile_size, int32 frame_count) {
+  int32 width = 3840;
+  int32 height = 2160;
+  int32 tiles_x = width / tile_size;
+  int32 tiles_y = height / tile_size;
+  uint64 tile_count = (uint64)(tiles_x + 2) * (uint64)(tiles_y + 2);
+  GameMemory memory;
+  BenchCreateMemory(&memory, tiles_x, tiles_y, 8000, 7,
+                    Kilobytes(64) + tile_count * 32, Megabytes(1) + tile_count * 32);
+  memory.config.tile_size = tile_size;
+
+  GameOffscreenBuffer screen = {};
+  screen.width = width;
+  screen.height = height;
+  screen.bytes_per_pixel = sizeof(uint32);
+  screen.pitch = width * screen.bytes_per_pixel;
+  size_t screen_size = (size_t)(screen.pitch * height);
+  screen.memory = calloc(1, screen_size);
+  uint32 *reference = (uint32 *)malloc(screen_size);
+
+  ThreadContext thread = {};
+  GameInput input = {};
+  input.dt_for_frame = 1.0f / 60.0f;
+  for (int32 frame = 0; frame < 600; ++frame) {
+    GameControllerInput *controller = GetController(&input, 0);
+    controller->start.ended_down = (frame == 0);
+    controller->start.half_transition_count = (frame < 2);
+    controller->back.ended_down = (frame == 0);
+    controller->back.half_transition_count = (frame < 2);
+    UpdateGame(&thread, &memory, &input, &screen);
+  }
+
+  printf("  %dx%d in %dpx tiles:", width, height, tile_size);
+  real64 single_thread_seconds = 0.0;
+  int32 core_count = BenchCoreCount();
+  for (int32 thread_count = 1; ; thread_count *= 2) {
+    thread_count = Min(thread_count, core_count);
+    if (thread_count > 1) {
+      // NOTE: the workers are left asleep on their semaphore when we're done with them
+      PlatformWorkQueue *queue = (PlatformWorkQueue *)calloc(1, sizeof(PlatformWorkQueue));
+      BenchMakeQueue(queue, thread_count - 1);
+      memory.render_queue = queue;
+      memory.PlatformAddEntry = BenchAddEntry;
+      memory.PlatformCompleteAllWork = BenchCompleteAllWork;
+    }
+
+    memset(screen.memory, 0, screen_size);
+    real64 start = BenchGetSeconds();
+    for (int32 frame = 0; frame < frame_count; ++frame) {
+      screen.needs_full_repaint = true;
+      RenderGame(&memory, &screen);
+    }
+    real64 seconds = (BenchGetSeconds() - start) / frame_count;
+
+    if (thread_count == 1) {
+      single_thread_seconds = seconds;
+      memcpy(reference, screen.memory, screen_size);
+    }
+    else if (memcmp(reference, screen.memory, screen_size) != 0) {
+      printf("\n    MISMATCH: %d threads drew a different frame\n", thread_count);
+    }
+    printf(" %d thread%s %.2fms (%.1fx)", thread_count, (thread_count == 1) ? "" : "s",
+           seconds * 1000.0, single_thread_seconds / seconds);
+    if (thread_count == core_count) {
+      break;
+    }
+  }
+  printf("\n");
+
+  BenchFreeMemory(&memory);
+  free(screen.memory);
+  free(reference);
+}
+
+internal void
+BenchTiledRenders() {
+  printf("full repaint at 4K, threads (%d cores):\n", BenchCoreCount());
+  BenchTiledRender(2, 60);
+  BenchTiledRender(8, 120);
+}
+
+#if SNAKE_INTERNAL
+// ---------------------------------------------------------------------------------------
+// Timed blocks
+// ---------------------------------------------------------------------------------------
+
+// Cycles per empty timed block, to see what instrumenting something costs
+internal real64
+BenchTimedBlockCycles(DebugTable *table, int32 block_count, bool32 threaded) {
+  global_debug_table = table;
+  uint64 start = __rdtsc();
+  for (int32 block_idx = 0; block_idx < block_count; ++block_idx) {
+    if (threaded) {
+      TIMED_BLOCK_THREADED(RenderJob);
+    }
+    else {
+      TIMED_BLOCK(UpdateSnake);
+    }
+    if (table && (block_idx & 255) == 255) {
+      table->event_count = 0;
+    }
+  }
+  real64 result = (real64)(__rdtsc() - start) / block_count;
+  global_debug_table = 0;
+  return result;
+}
+
+/* What drawing the debug overlay costs, against a 60 Hz frame. Takes a game that's been
+ * played for a while so the graphs are full.
+ */
+internal void
+BenchDebugOverlay(GameMemory *memory, GameOffscreenBuffer *screen, int32 draw_count) {
+  global_debug_table = &memory->debug_table;
+  real64 start = BenchGetSeconds();
+  uint64 start_cycles = __rdtsc();
+  for (int32 draw_idx = 0; draw_idx < draw_count; ++draw_idx) {
+    DrawDebugOverlay(memory, screen);
+  }
+  real64 draw_us = 1e6 * (BenchGetSeconds() - start) / draw_count;
+  real64 draw_cycles = (real64)(__rdtsc() - start_cycles) / draw_count;
+  global_debug_table = 0;
+  printf("debug overlay on %dx%d: %.1fus, %.0fKc a draw, %.2f%% of a 60 Hz frame\n",
+         screen->width, screen->height, draw_us, draw_cycles / 1e3, 100.0 * draw_us / (1e6 / 60.0));
+}
+
+/* What a timed block costs with no table (the headless runner), counting and tracing, and
+ * then a breakdown of some frames of play through GameUpdateAndRender the way the
+ * platform layers see it. The debug overlay is measured on the game that's left.
+ */
+internal void
+BenchTimedBlocks(int32 tiles_per_side, int32 width, int32 height, int32 frame_count) {
+  DebugTable *table = (DebugTable *)calloc(1, sizeof(DebugTable));
+  int32 block_count = 10000000;
+  real64 off_cycles = BenchTimedBlockCycles(0, block_count, false);
+  real64 counting_cycles = BenchTimedBlockCycles(table, block_count, false);
+  real64 threaded_cycles = BenchTimedBlockCycles(table, block_count, true);
+  table->trace_enabled = true;
+  real64 tracing_cycles = BenchTimedBlockCycles(table, block_count, false);
+  free(table);
+  printf("timed block: %.1f cycles with no table, %.1f counting, %.1f counting threaded, %.1f tracing\n",
+         off_cycles, counting_cycles, threaded_cycles, tracing_cycles);
+
+  GameMemory *memory = (GameMemory *)calloc(1, sizeof(GameMemory));
+  uint64 tile_count = (uint64)(tiles_per_side + 2) * (uint64)(tiles_per_side + 2);
+  BenchCreateMemory(memory, tiles_per_side, tiles_per_side, 8000, 6,
+                    Kilobytes(64) + tile_count * 32, Megabytes(1) + tile_count * 32);
+
+  GameOffscreenBuffer screen = {};
+  screen.width = width;
+  screen.height = height;
+  screen.bytes_per_pixel = sizeof(uint32);
+  screen.pitch = width * screen.bytes_per_pixel;
+  screen.memory = calloc(1, (size_t)(screen.pitch * height));
+
+  GameState *state = (GameState *)memory->permanent_storage;
+  ThreadContext thread = {};
+  GameInput input = {};
+  input.dt_for_frame = 1.0f / 60.0f;
+  memory->debug_table.target_seconds_per_frame = input.dt_for_frame;
+  for (int32 frame = 0; frame < frame_count; ++frame) {
+    GameControllerInput *controller = GetController(&input, 0);
+    bool32 press = (frame == 0) || (memory->is_initialized && !state->snake.alive);
+    controller->start.ended_down = press;
+    controller->start.half_transition_count = press;
+    controller->back.ended_down = (frame == 0);
+    controller->back.half_transition_count = (frame < 2);
+
+    GameUpdateAndRender(&thread, memory, &input, &screen);
+    DebugEndFrame(&memory->debug_table, input.dt_for_frame);
+  }
+  global_debug_table = 0;
+
+  char buffer[4096];
+  FormatDebugCounters(&memory->debug_table, buffer, sizeof(buffer));
+  printf("%dx%d board on %dx%d:\n%s", tiles_per_side, tiles_per_side, width, height, buffer);
+
+  BenchDebugOverlay(memory, &screen, 1000);
+
+  BenchFreeMemory(memory);
+  free(screen.memory);
+  free(memory);
+}
+#endif
+
+#if !SNAKE_WIN32
+// ---------------------------------------------------------------------------------------
+// Hot reload
+// ---------------------------------------------------------------------------------------
+
+// Like a linker: the file is written in pieces with pauses in between and closed at the end
+internal void
+BenchWriteLibrary(char *path, uint8 *content, int32 piece_count, int32 piece_size,
+                  LinuxCodeWatch *watch, int32 *early_count) {
+  int file_handle = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0755);
+  for (int32 piece_idx = 0; piece_idx < piece_count; ++piece_idx) {
+    write(file_handle, content + piece_idx * piece_size, piece_size);
+    usleep(2000);
+    if (LinuxCodeWatchTakeReload(watch)) {
+      ++*early_count;
+    }
+  }
+  close(file_handle);
+}
+
+/* Rewrites a stand-in for snake_game.so over and over, half the time in place and half
+ * the time under another name and renamed over it the way build.sh does, and checks that
+ * the watcher signals exactly once per rewrite, never before the file is closed, and how
+ * long after. The frame loop side is a single atomic exchange, timed against the stat
+ * call it replaced.
+ */
+internal void
+BenchCodeWatch(int32 rewrite_count) {
+  char directory[] = "/tmp/snake_bench_XXXXXX";
+  if (!mkdtemp(directory)) {
+    printf("hot reload: couldn't make a temp directory\n");
+    return;
+  }
+  char path[256];
+  char build_path[256];
+  snprintf(path, sizeof(path), "%s/snake_game.so", directory);
+  snprintf(build_path, sizeof(build_path), "%s/snake_game_build.so", directory);
+
+  int32 piece_count = 16;
+  int32 piece_size = Kilobytes(64);
+  uint8 *content = (uint8 *)calloc(1, piece_count * piece_size);
+
+  int32 debounce_ms = 50;
+  LinuxCodeWatch *watch = (LinuxCodeWatch *)calloc(1, sizeof(LinuxCodeWatch));
+  if (!LinuxStartCodeWatch(watch, path, debounce_ms)) {
+    printf("hot reload: inotify isn't available\n");
+    return;
+  }
+
+  int32 early_count = 0;
+  int32 missed_count = 0;
+  int32 extra_count = 0;
+  real64 total_latency = 0.0;
+  real64 max_latency = 0.0;
+  for (int32 rewrite_idx = 0; rewrite_idx < rewrite_count; ++rewrite_idx) {
+    bool32 use_rename = (rewrite_idx & 1);
+    BenchWriteLibrary(use_rename ? build_path : path, content, piece_count, piece_size,
+                      watch, &early_count);
+    if (use_rename) {
+      rename(build_path, path);
+    }
+    real64 done = BenchGetSeconds();
+
+    bool32 signaled = false;
+    while (!signaled && BenchGetSeconds() - done < 1.0) {
+      signaled = LinuxCodeWatchTakeReload(watch);
+      if (!signaled) {
+        usleep(100);
+      }
+    }
+    if (signaled) {
+      real64 latency = BenchGetSeconds() - done;
+      total_latency += latency;
+      max_latency = Max(max_latency, latency);
+    }
+    else {
+      ++missed_count;
+    }
+
+    // Nothing else should show up for this rewrite
+    usleep((debounce_ms * 2) * 1000);
+    if (LinuxCodeWatchTakeReload(watch)) {
+      ++extra_count;
+    }
+  }
+
+  int32 check_count = 10000000;
+  real64 start = BenchGetSeconds();
+  int32 reload_count = 0;
+  for (int32 check_idx = 0; check_idx < check_count; ++check_idx) {
+    reload_count += LinuxCodeWatchTakeReload(watch);
+  }
+  real64 flag_seconds = (BenchGetSeconds() - start) / check_count;
+
+  int32 stat_count = 100000;
+  start = BenchGetSeconds();
+  for (int32 stat_idx = 0; stat_idx < stat_count; ++stat_idx) {
+    struct stat file_stat;
+    stat(path, &file_stat);
+  }
+  real64 stat_seconds = (BenchGetSeconds() - start) / stat_count;
+
+  int32 reloaded_count = rewrite_count - missed_count;
+  printf("hot reload, %d rewrites (%d ms debounce): %d early, %d missed, %d extra, "
+         "latency avg %.1fms max %.1fms\n",
+         rewrite_count, debounce_ms, early_count, missed_count, extra_count,
+         reloaded_count ? (total_latency * 1000.0) / reloaded_count : 0.0, max_latency * 1000.0);
+  printf("  per frame check: flag %.1fns, stat %.1fns\n", flag_seconds * 1e9, stat_seconds * 1e9);
+
+  unlink(path);
+  rmdir(directory);
+  free(content);
+  // NOTE: the watcher thread is left blocked on the deleted directory
+}
+
+// ---------------------------------------------------------------------------------------
+// Frame pacing
+// ---------------------------------------------------------------------------------------
+
+/* Paces frame_count frames of about work_ms of busy work each, first the way the loop
+ * used to (one clock_nanosleep straight to the deadline) and then with the sleep/spin
+ * pacer, and prints how far past the deadline the frames ended.
+ */
+internal void
+BenchFramePacer(int32 frame_count, real64 work_ms) {
+  uint64 target_ns = 16666667;
+  uint64 work_ns = (uint64)(work_ms * 1e6);
+
+  for (int32 pass_idx = 0; pass_idx < 2; ++pass_idx) {
+    bool32 use_pacer = (pass_idx == 1);
+    FramePacer pacer;
+    InitFramePacer(&pacer, target_ns);
+
+    uint64 last_counter = LinuxPacerClock();
+    for (int32 frame_idx = 0; frame_idx < frame_count; ++frame_idx) {
+      while (LinuxPacerClock() - last_counter < work_ns) {
+      }
+
+      uint64 deadline_ns = last_counter + target_ns;
+      if (use_pacer) {
+        last_counter = LinuxWaitForFrame(&pacer, deadline_ns);
+      }
+      else {
+        bool32 missed = (LinuxPacerClock() >= deadline_ns);
+        if (!missed) {
+          struct timespec deadline_spec;
+          deadline_spec.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+          deadline_spec.tv_nsec = (long)(deadline_ns % 1000000000ull);
+          while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline_spec, 0) == EINTR) {
+          }
+        }
+        last_counter = LinuxPacerClock();
+        PacerRecordFrame(&pacer, deadline_ns, last_counter, missed);
+      }
+    }
+
+    char buffer[2048];
+    FormatFramePacerStats(&pacer, buffer, sizeof(buffer));
+    printf("frame pacing with %s, %.1fms of work:\n%s", use_pacer ? "sleep then spin" : "sleep only",
+           work_ms, buffer);
+  }
+}
+#endif
+
+int
+main(int argc, char **argv) {
+  BenchFreeTileFill(1024, 1024, 0.999);
+  BenchSnakeBatch(4096, 2000, 51, 28);
+  BenchSwarm(1000, 2048, 2048, 6000, 64);
+  BenchAutopilot();
+  BenchStateHashes();
+  BenchFillRects();
+  BenchRender();
+  BenchTiledRenders();
+#if SNAKE_INTERNAL
+  BenchTimedBlocks(128, 1280, 720, 600);
+#endif
+#if !SNAKE_WIN32
+  BenchCodeWatch(20);
+  BenchFramePacer(120, 4.0);
+#endif
+  return 0;
+}
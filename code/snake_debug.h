@@ -0,0 +1,300 @@
+#if !defined(SNAKE_DEBUG_H)
+
+/* Timed blocks
+ *
+ * TIMED_BLOCK(Name) at the top of a scope adds the cycles until the end of the scope and
+ * a hit to the DebugBlock_Name counter. The counters live in GameMemory::debug_table so
+ * they belong to the platform and survive a game code reload. Each side keeps its own
+ * global_debug_table pointer to it: the game sets its own on every call in (see
+ * GameUpdateAndRender) and the platform sets its own at startup. While the pointer is
+ * null, e.g. in the headless runner and the benchmarks, blocks only cost the null check.
+ *
+ * A block is two rdtscs and two plain adds. That isn't free: BenchTimedBlocks measures
+ * about 95 cycles a block (80 to 100 from run to run), which is fine for the few dirty
+ * tiles RenderTile sees a frame but not for a per pixel loop. Only the main thread runs
+ * TIMED_BLOCK. Blocks that also run on the worker threads (render jobs) use
+ * TIMED_BLOCK_THREADED, which does the adds with atomics and costs about 120 to 135
+ * cycles. The main thread helps drain the queue, so a block id is always timed one way
+ * or the other, never both.
+ *
+ * With trace_enabled every block also appends a begin and an end DebugEvent, stamped with
+ * the tsc and the thread, which the platform hands to the telemetry log at the end of the
+ * frame for a Chrome trace (see snake_telemetry_tool). A frame that runs out of room
+ * drops the rest of its events and counts them.
+ *
+ * DebugEndFrame, called by the platform once a frame, moves the frame's counters to
+ * last_frame and adds them to the totals. It also keeps the last DEBUG_FRAME_HISTORY
+ * frames' times and counters for the overlay (snake_debug_overlay.cpp).
+ *
+ * With SNAKE_INTERNAL=0 all of this compiles out.
+ */
+
+#if SNAKE_INTERNAL
+
+#include <stdio.h>
+#if !defined(_MSC_VER)
+#include <x86intrin.h>
+#endif
+
+// NOTE: keep debug_block_names in the same order
+enum DebugBlockId {
+  // Game
+  DebugBlock_GameUpdateAndRender,
+  DebugBlock_UpdateGame,
+  DebugBlock_ProcessInput,
+  DebugBlock_SimulateTick,
+  DebugBlock_UpdateSnake,
+  DebugBlock_RenderGame,
+  DebugBlock_RenderGrid,
+  DebugBlock_RenderTile,
+  DebugBlock_RenderGroupToOutput,
+  DebugBlock_RenderJob,
+  DebugBlock_DebugOverlay,
+
+  // Platform
+  DebugBlock_PlatformInput,
+  DebugBlock_PlatformFillSoundBuffer,
+  DebugBlock_PlatformFrameWait,
+  DebugBlock_PlatformPresent,
+
+  DebugBlock_Count,
+};
+
+global_variable char *debug_block_names[] = {
+  "GameUpdateAndRender",
+  "UpdateGame",
+  "ProcessInput",
+  "SimulateTick",
+  "UpdateSnake",
+  "RenderGame",
+  "RenderGrid",
+  "RenderTile",
+  "RenderGroupToOutput",
+  "RenderJob",
+  "DebugOverlay",
+
+  "PlatformInput",
+  "PlatformFillSoundBuffer",
+  "PlatformFrameWait",
+  "PlatformPresent",
+};
+
+#define DEBUG_EVENT_CAPACITY 1024 // per frame
+#define DEBUG_FRAME_HISTORY 128
+
+// One block's cycles and hits, for a frame or for the whole run
+struct DebugBlockCounter {
+  uint64 cycle_count;
+  uint32 hit_count;
+};
+
+struct DebugFrameRecord {
+  real32 seconds; // as the platform measured it
+  uint32 cycles; // from the end of the frame before
+  uint32 block_cycles[DebugBlock_Count]; // NOTE: saturates, only the graphs read these
+};
+
+enum DebugEventType {
+  DebugEvent_BeginBlock,
+  DebugEvent_EndBlock,
+};
+
+struct DebugEvent {
+  uint64 tsc;
+  uint32 thread_id;
+  uint16 block_id;
+  uint16 type; // DebugEventType
+};
+
+struct DebugTable {
+  DebugBlockCounter counters[DebugBlock_Count]; // this frame's, still being added to
+  DebugBlockCounter last_frame[DebugBlock_Count];
+  DebugBlockCounter totals[DebugBlock_Count];
+  uint64 frame_count;
+
+  // The overlay's graphs. Frame frame_count goes to frames[frame_count % DEBUG_FRAME_HISTORY].
+  bool32 overlay_enabled;
+  real32 target_seconds_per_frame; // set by the platform
+  uint64 last_end_frame_tsc;
+  DebugFrameRecord frames[DEBUG_FRAME_HISTORY];
+
+  bool32 trace_enabled;
+  uint32 volatile event_count; // can run past DEBUG_EVENT_CAPACITY, the rest were dropped
+  uint64 dropped_event_count;
+  DebugEvent events[DEBUG_EVENT_CAPACITY];
+};
+
+global_variable DebugTable *global_debug_table;
+
+inline void
+AtomicAddU64(uint64 volatile *value, uint64 addend) {
+#if defined(_MSC_VER)
+  _InterlockedExchangeAdd64((__int64 volatile *)value, (__int64)addend);
+#else
+  __atomic_fetch_add(value, addend, __ATOMIC_RELAXED);
+#endif
+}
+
+// Returns the value from before the add
+inline uint32
+AtomicAddU32(uint32 volatile *value, uint32 addend) {
+#if defined(_MSC_VER)
+  uint32 result = (uint32)_InterlockedExchangeAdd((long volatile *)value, (long)addend);
+#else
+  uint32 result = __atomic_fetch_add(value, addend, __ATOMIC_RELAXED);
+#endif
+  return result;
+}
+
+// Something that tells threads apart without a call into the OS
+inline uint32
+GetThreadID() {
+#if defined(_MSC_VER)
+  // NOTE: the thread id out of the TEB
+  uint8 *thread_local_storage = (uint8 *)__readgsqword(0x30);
+  uint32 result = *(uint32 *)(thread_local_storage + 0x48);
+#else
+  // NOTE: the thread's control block points at itself
+  uint64 thread_pointer;
+  __asm__ volatile("mov %%fs:0, %0" : "=r"(thread_pointer));
+  uint32 result = (uint32)(thread_pointer >> 12);
+#endif
+  return result;
+}
+
+inline void
+RecordDebugEvent(DebugTable *table, DebugBlockId block_id, DebugEventType type, uint64 tsc) {
+  uint32 event_idx = AtomicAddU32(&table->event_count, 1);
+  if (event_idx < DEBUG_EVENT_CAPACITY) {
+    DebugEvent *event = table->events + event_idx;
+    event->tsc = tsc;
+    event->thread_id = GetThreadID();
+    event->block_id = (uint16)block_id;
+    event->type = (uint16)type;
+  }
+}
+
+struct TimedBlock {
+  DebugTable *table;
+  DebugBlockId block_id;
+  bool32 is_threaded;
+  uint64 start_tsc;
+
+  TimedBlock(DebugBlockId block_id_init, bool32 is_threaded_init) {
+    table = global_debug_table;
+    block_id = block_id_init;
+    is_threaded = is_threaded_init;
+    start_tsc = 0;
+    if (table) {
+      start_tsc = __rdtsc();
+      if (table->trace_enabled) {
+        RecordDebugEvent(table, block_id, DebugEvent_BeginBlock, start_tsc);
+      }
+    }
+  }
+
+  ~TimedBlock() {
+    if (table) {
+      uint64 end_tsc = __rdtsc();
+      DebugBlockCounter *counter = table->counters + block_id;
+      if (is_threaded) {
+        AtomicAddU64(&counter->cycle_count, end_tsc - start_tsc);
+        AtomicAddU32(&counter->hit_count, 1);
+      }
+      else {
+        counter->cycle_count += end_tsc - start_tsc;
+        ++counter->hit_count;
+      }
+      if (table->trace_enabled) {
+        RecordDebugEvent(table, block_id, DebugEvent_EndBlock, end_tsc);
+      }
+    }
+  }
+};
+
+#define TIMED_BLOCK__(name, threaded, line) TimedBlock timed_block_##line(DebugBlock_##name, threaded)
+#define TIMED_BLOCK_(name, threaded, line) TIMED_BLOCK__(name, threaded, line)
+#define TIMED_BLOCK(name) TIMED_BLOCK_(name, false, __LINE__)
+#define TIMED_BLOCK_THREADED(name) TIMED_BLOCK_(name, true, __LINE__)
+
+// The number of events the frame kept
+inline uint32
+DebugEventCount(DebugTable *table) {
+  uint32 result = Min(table->event_count, (uint32)DEBUG_EVENT_CAPACITY);
+  return result;
+}
+
+/* Rolls the frame's counters over and throws its events away, so any the platform wants
+ * have to be copied out first. Only call it while no other thread is in a block.
+ */
+inline void
+DebugEndFrame(DebugTable *table, real32 frame_seconds) {
+  uint64 end_tsc = __rdtsc();
+  DebugFrameRecord *frame = table->frames + (table->frame_count % DEBUG_FRAME_HISTORY);
+  frame->seconds = frame_seconds;
+  frame->cycles = 0;
+  if (table->last_end_frame_tsc) {
+    frame->cycles = (uint32)Min(end_tsc - table->last_end_frame_tsc, 0xFFFFFFFFull);
+  }
+  table->last_end_frame_tsc = end_tsc;
+
+  for (int32 block_idx = 0; block_idx < DebugBlock_Count; ++block_idx) {
+    DebugBlockCounter *counter = table->counters + block_idx;
+    DebugBlockCounter frame_stats = *counter;
+    *counter = {};
+
+    table->last_frame[block_idx] = frame_stats;
+    frame->block_cycles[block_idx] = (uint32)Min(frame_stats.cycle_count, 0xFFFFFFFFull);
+    table->totals[block_idx].cycle_count += frame_stats.cycle_count;
+    table->totals[block_idx].hit_count += frame_stats.hit_count;
+  }
+  ++table->frame_count;
+  if (table->event_count > DEBUG_EVENT_CAPACITY) {
+    table->dropped_event_count += table->event_count - DEBUG_EVENT_CAPACITY;
+  }
+  table->event_count = 0;
+}
+
+/* Writes the totals as a table for the platform to print or log. Returns the length, which
+ * is cut short if the buffer is too small.
+ */
+internal int32
+FormatDebugCounters(DebugTable *table, char *buffer, int32 buffer_size) {
+  int32 length = 0;
+  length += snprintf(buffer + length, buffer_size - length,
+                     "Timed blocks over %llu frames:\n"
+                     "  %-24s %12s %14s %12s %12s\n",
+                     (unsigned long long)table->frame_count,
+                     "block", "hits", "Mcycles", "cycles/hit", "Kcycles/f");
+  for (int32 block_idx = 0;
+       block_idx < DebugBlock_Count && length < buffer_size;
+       ++block_idx) {
+    DebugBlockCounter *total = table->totals + block_idx;
+    if (total->hit_count) {
+      length += snprintf(buffer + length, buffer_size - length,
+                         "  %-24s %12u %14.3f %12.0f %12.1f\n",
+                         debug_block_names[block_idx], total->hit_count,
+                         (real64)total->cycle_count / 1e6,
+                         (real64)total->cycle_count / (real64)total->hit_count,
+                         table->frame_count ? (real64)total->cycle_count / 1e3 / (real64)table->frame_count : 0.0);
+    }
+  }
+  if (table->dropped_event_count && length < buffer_size) {
+    length += snprintf(buffer + length, buffer_size - length, "  %llu trace events dropped\n",
+                       (unsigned long long)table->dropped_event_count);
+  }
+  if (length > buffer_size - 1) {
+    length = buffer_size - 1;
+  }
+  return length;
+}
+
+#else
+
+#define TIMED_BLOCK(name)
+#define TIMED_BLOCK_THREADED(name)
+
+#endif
+
+#define SNAKE_DEBUG_H
+#endif
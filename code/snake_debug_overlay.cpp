@@ -0,0 +1,193 @@
+/* Debug overlay
+ *
+ * What the timed blocks (snake_debug.h) saw, drawn over the top left of the frame while
+ * DebugTable::overlay_enabled is set. The platform layers toggle it with F1:
+ *   - the last DEBUG_FRAME_HISTORY frame times against the target, late ones in red
+ *   - where each of those frames' cycles went, stacked by subsystem, with a legend giving
+ *     the last frame's share of each
+ *   - the arenas' use and high water marks
+ *
+ * It's all rectangles and lines of text in the renderer's built in font, pushed into a
+ * render group. The graphs show the frames the platform has ended, so the one being drawn
+ * isn't in them yet.
+ *
+ * The overlay draws over the board and the dirty tile repaints don't know about it, so
+ * the platform asks for a full repaint when it's turned off.
+ *
+ * Included by snake_game.cpp when SNAKE_INTERNAL is on.
+ */
+
+#include <stdarg.h>
+
+#define DEBUG_FONT_SCALE 2
+#define DEBUG_LINE_HEIGHT ((RENDER_FONT_HEIGHT + 2) * DEBUG_FONT_SCALE)
+
+#define DEBUG_OVERLAY_MARGIN 8
+#define DEBUG_OVERLAY_PADDING 6
+#define DEBUG_GRAPH_HEIGHT 48
+#define DEBUG_GRAPH_COLUMN_WIDTH 2
+#define DEBUG_ARENA_BAR_HEIGHT 4
+
+struct DebugOverlaySubsystem {
+  char *name;
+  DebugBlockId block_id;
+  uint32 color; // 0xRRGGBB
+};
+
+// NOTE: blocks that don't nest inside each other, so the stack never counts a cycle twice
+global_variable DebugOverlaySubsystem debug_overlay_subsystems[] = {
+  {"SIM", DebugBlock_UpdateGame, 0x4090E0},
+  {"RENDER", DebugBlock_RenderGame, 0x40C060},
+  {"AUDIO", DebugBlock_PlatformFillSoundBuffer, 0xC060E0},
+  {"BLIT", DebugBlock_PlatformPresent, 0xE0A040},
+  {"SLEEP", DebugBlock_PlatformFrameWait, 0x505050},
+  {"OVERLAY", DebugBlock_DebugOverlay, 0xE0E040},
+};
+
+#define DEBUG_LEGEND_ROWS ((ArrayCount(debug_overlay_subsystems) + 1) / 2)
+#define DEBUG_ARENA_COUNT 3
+
+internal void
+PushDebugText(RenderGroup *group, uint32 color, int32 x, int32 y, char *format, ...) {
+  char text[RENDER_TEXT_CAPACITY];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  PushText(group, color, x, y, DEBUG_FONT_SCALE, text);
+}
+
+inline DebugFrameRecord *
+GetDebugFrame(DebugTable *table, int32 frames_ago) {
+  DebugFrameRecord *result = table->frames + ((table->frame_count - 1 - frames_ago) % DEBUG_FRAME_HISTORY);
+  return result;
+}
+
+inline real64
+ArenaMegabytes(size_t size) {
+  real64 result = (real64)size / (1024.0 * 1024.0);
+  return result;
+}
+
+internal void
+DrawDebugOverlay(GameMemory *memory, GameOffscreenBuffer *screen_buffer) {
+  TIMED_BLOCK(DebugOverlay);
+
+  GameState *state = (GameState *)memory->permanent_storage;
+  DebugTable *table = &memory->debug_table;
+
+  // NOTE: before the render group takes the rest of the frame arena
+  char *arena_names[DEBUG_ARENA_COUNT] = {"WORLD", "TEMP", "FRAME"};
+  MemoryArena arenas[DEBUG_ARENA_COUNT] = {state->world_arena, state->transient_arena, state->frame_arena};
+
+  TemporaryMemory overlay_memory = BeginTemporaryMemory(&state->frame_arena);
+  RenderGroup *group = AllocateRenderGroup(&state->frame_arena, screen_buffer, 1, 0, 0);
+
+  int32 graph_width = DEBUG_FRAME_HISTORY * DEBUG_GRAPH_COLUMN_WIDTH;
+  int32 panel_width = graph_width + 2 * DEBUG_OVERLAY_PADDING;
+  int32 panel_height = (DEBUG_OVERLAY_PADDING +
+                        2 * (DEBUG_LINE_HEIGHT + DEBUG_GRAPH_HEIGHT + DEBUG_OVERLAY_PADDING) +
+                        DEBUG_LEGEND_ROWS * DEBUG_LINE_HEIGHT + DEBUG_OVERLAY_PADDING +
+                        DEBUG_ARENA_COUNT * (DEBUG_LINE_HEIGHT + DEBUG_ARENA_BAR_HEIGHT + DEBUG_OVERLAY_PADDING));
+  PushRect(group, RGBColor(16, 16, 16), DEBUG_OVERLAY_MARGIN, DEBUG_OVERLAY_MARGIN, panel_width, panel_height);
+
+  uint32 text_color = RGBColor(224, 224, 224);
+  int32 left = DEBUG_OVERLAY_MARGIN + DEBUG_OVERLAY_PADDING;
+  int32 y = DEBUG_OVERLAY_MARGIN + DEBUG_OVERLAY_PADDING;
+
+  int32 history_count = (int32)Min(table->frame_count, (uint64)DEBUG_FRAME_HISTORY);
+  // The newest frame is drawn against the right edge
+  int32 history_left = left + (DEBUG_FRAME_HISTORY - history_count) * DEBUG_GRAPH_COLUMN_WIDTH;
+  DebugFrameRecord empty_frame = {};
+  DebugFrameRecord *last_frame = history_count ? GetDebugFrame(table, 0) : &empty_frame;
+
+  // Frame times. The graph tops out at twice the target, so the target is halfway up.
+  real32 target_seconds = table->target_seconds_per_frame;
+  if (target_seconds <= 0.0f) {
+    target_seconds = 1.0f / 60.0f;
+  }
+  // NOTE: the pacer ends a frame a hair past its deadline at best
+  real32 late_seconds = 1.05f * target_seconds;
+  int32 late_count = 0;
+  for (int32 frame_idx = 0; frame_idx < history_count; ++frame_idx) {
+    if (GetDebugFrame(table, frame_idx)->seconds > late_seconds) {
+      ++late_count;
+    }
+  }
+  PushDebugText(group, text_color, left, y, "FRAME %5.2f MS  TARGET %5.2f MS",
+                1000.0f * last_frame->seconds, 1000.0f * target_seconds);
+  y += DEBUG_LINE_HEIGHT;
+
+  for (int32 column = 0; column < history_count; ++column) {
+    DebugFrameRecord *frame = GetDebugFrame(table, history_count - 1 - column);
+    real32 graph_t = Min(1.0f, frame->seconds / (2.0f * target_seconds));
+    int32 bar_height = (int32)(graph_t * (real32)DEBUG_GRAPH_HEIGHT + 0.5f);
+    uint32 bar_color = (frame->seconds > late_seconds) ? RGBColor(224, 64, 64) : RGBColor(64, 192, 64);
+    PushRect(group, bar_color, history_left + column * DEBUG_GRAPH_COLUMN_WIDTH,
+             y + DEBUG_GRAPH_HEIGHT - bar_height, DEBUG_GRAPH_COLUMN_WIDTH, bar_height);
+  }
+  PushRect(group, RGBColor(255, 255, 255), left, y + DEBUG_GRAPH_HEIGHT / 2, graph_width, 1);
+  y += DEBUG_GRAPH_HEIGHT + DEBUG_OVERLAY_PADDING;
+
+  // Where the cycles went, as a share of each frame
+  PushDebugText(group, text_color, left, y, "%5.2f MCYCLES/F  LATE %3d/%d",
+                (real64)last_frame->cycles / 1e6, late_count, history_count);
+  y += DEBUG_LINE_HEIGHT;
+
+  for (int32 column = 0; column < history_count; ++column) {
+    DebugFrameRecord *frame = GetDebugFrame(table, history_count - 1 - column);
+    if (frame->cycles) {
+      uint64 stacked_cycles = 0;
+      int32 stacked_height = 0;
+      for (int32 subsystem_idx = 0; subsystem_idx < ArrayCount(debug_overlay_subsystems); ++subsystem_idx) {
+        DebugOverlaySubsystem *subsystem = debug_overlay_subsystems + subsystem_idx;
+        stacked_cycles += frame->block_cycles[subsystem->block_id];
+        int32 top_height = (int32)Min((stacked_cycles * DEBUG_GRAPH_HEIGHT + frame->cycles / 2) / frame->cycles,
+                                      (uint64)DEBUG_GRAPH_HEIGHT);
+        if (top_height > stacked_height) {
+          PushRect(group, subsystem->color, history_left + column * DEBUG_GRAPH_COLUMN_WIDTH,
+                   y + DEBUG_GRAPH_HEIGHT - top_height, DEBUG_GRAPH_COLUMN_WIDTH, top_height - stacked_height);
+          stacked_height = top_height;
+        }
+      }
+    }
+  }
+  y += DEBUG_GRAPH_HEIGHT + DEBUG_OVERLAY_PADDING;
+
+  for (int32 subsystem_idx = 0; subsystem_idx < ArrayCount(debug_overlay_subsystems); ++subsystem_idx) {
+    DebugOverlaySubsystem *subsystem = debug_overlay_subsystems + subsystem_idx;
+    int32 legend_x = left + (subsystem_idx % 2) * (graph_width / 2);
+    int32 legend_y = y + (subsystem_idx / 2) * DEBUG_LINE_HEIGHT;
+    real64 percent = 0.0;
+    if (last_frame->cycles) {
+      percent = 100.0 * (real64)last_frame->block_cycles[subsystem->block_id] / (real64)last_frame->cycles;
+    }
+    int32 swatch_size = RENDER_FONT_HEIGHT * DEBUG_FONT_SCALE;
+    PushRect(group, subsystem->color, legend_x, legend_y, swatch_size, swatch_size);
+    PushDebugText(group, text_color, legend_x + swatch_size + 2 * DEBUG_FONT_SCALE, legend_y, "%s %4.1f%%",
+                  subsystem->name, percent);
+  }
+  y += DEBUG_LEGEND_ROWS * DEBUG_LINE_HEIGHT + DEBUG_OVERLAY_PADDING;
+
+  // Arenas: what's in use now over the most that ever was, out of the whole arena
+  for (int32 arena_idx = 0; arena_idx < DEBUG_ARENA_COUNT; ++arena_idx) {
+    MemoryArena *arena = arenas + arena_idx;
+    PushDebugText(group, text_color, left, y, "%-5s USED %5.1f HI %5.1f/%4.0fMB", arena_names[arena_idx],
+                  ArenaMegabytes(arena->used), ArenaMegabytes(arena->high_water_mark),
+                  ArenaMegabytes(arena->size));
+    y += DEBUG_LINE_HEIGHT;
+
+    if (arena->size) {
+      int32 high_water_width = (int32)((real64)graph_width * (real64)arena->high_water_mark / (real64)arena->size);
+      int32 used_width = (int32)((real64)graph_width * (real64)arena->used / (real64)arena->size);
+      PushRect(group, RGBColor(48, 48, 48), left, y, graph_width, DEBUG_ARENA_BAR_HEIGHT);
+      PushRect(group, RGBColor(128, 96, 32), left, y, high_water_width, DEBUG_ARENA_BAR_HEIGHT);
+      PushRect(group, RGBColor(224, 160, 64), left, y, used_width, DEBUG_ARENA_BAR_HEIGHT);
+    }
+    y += DEBUG_ARENA_BAR_HEIGHT + DEBUG_OVERLAY_PADDING;
+  }
+  Assert(y <= DEBUG_OVERLAY_MARGIN + panel_height);
+
+  RenderGroupToOutput(group);
+  EndTemporaryMemory(overlay_memory);
+}
@@ -4,13 +4,14 @@
  * Make sure to not include anything static in the DLL. Put state in the game memory.
  */
 
-#include "pcg_basic.h"
 #include "snake_game.h"
+#include "snake_render.cpp"
+#if SNAKE_INTERNAL
+#include "snake_debug_overlay.cpp"
+#endif
 
-global_variable pcg32_random_t rng;
-
-// IDEA: create a process that plays the game flawlessly. Or introduce randomness in order
-// to test the game.
+// NOTE: the back button hands the snake to the autopilot (snake_autopilot.cpp), which
+// plays until the board is full.
 
 void GameOutputSound(GameState *state, GameSoundOutputBuffer *sound_buffer, int32 tone_hz) {
   int16 tone_volume = 1000;
@@ -51,81 +52,238 @@ int GetTilePixel(int tile_n, int num_tiles, int tile_size) {
   return ((tile_n - 1) % num_tiles) * tile_size;
 }
 
-void
-DrawBlock(GameOffscreenBuffer* buffer, uint32 color,
-          int x_start, int y_start, int block_size) {
-  uint8 *end_of_buffer = (uint8 *)buffer->memory + (buffer->height * buffer->pitch);
-  for (int x = x_start; x < x_start + block_size; ++x) {
-    uint8 *pixel = (uint8 *)buffer->memory +
-                   (x * buffer->bytes_per_pixel) +
-                   (y_start * buffer->pitch);
-    for (int y = y_start; y < y_start + block_size; ++y) {
-      Assert((pixel >= buffer->memory) && ((pixel + block_size) <= end_of_buffer));
-      *(uint32 *)pixel = color;
-      pixel += buffer->pitch;
-    }
+// ---------------------------------------------------------------------------------------
+// Free tile index
+// ---------------------------------------------------------------------------------------
+
+void InitFreeTileIndex(FreeTileIndex *index, int32 *tiles, int32 *positions, int32 capacity) {
+  index->count = 0;
+  index->capacity = capacity;
+  index->tiles = tiles;
+  index->positions = positions;
+  for (int32 idx = 0; idx < capacity; ++idx) {
+    positions[idx] = -1;
   }
 }
 
-void RenderGrid(GameOffscreenBuffer* buffer, GameState *state) {
-  for (int y = 1; y <= state->num_tiles_y; ++y) {
-    int y_pixel = GetTilePixel(y, state->num_tiles_y, state->tile_size);
-    for (int x = 1; x <= state->num_tiles_x; ++x) {
-      int x_pixel = GetTilePixel(x, state->num_tiles_x, state->tile_size);
-      DrawBlock(buffer, RGBColor(255, 255, 255), x_pixel, y_pixel, state->tile_size);
-    }
+inline void
+AddFreeTile(FreeTileIndex *index, int32 tile) {
+  Assert(tile >= 0 && tile < index->capacity);
+  Assert(index->positions[tile] == -1);
+  index->positions[tile] = index->count;
+  index->tiles[index->count++] = tile;
+}
+
+inline void
+RemoveFreeTile(FreeTileIndex *index, int32 tile) {
+  Assert(tile >= 0 && tile < index->capacity);
+  int32 slot = index->positions[tile];
+  Assert(slot >= 0 && slot < index->count);
+
+  // Swap the last free tile into the hole
+  int32 last_tile = index->tiles[--index->count];
+  index->tiles[slot] = last_tile;
+  index->positions[last_tile] = slot;
+  index->positions[tile] = -1;
+}
+
+// Returns -1 when there are no free tiles left.
+inline int32
+RandomFreeTile(FreeTileIndex *index, pcg32_random_t *random) {
+  int32 result = -1;
+  if (index->count > 0) {
+    result = index->tiles[pcg32_boundedrand_r(random, index->count)];
   }
+  return result;
 }
 
-SnakePiece * GetSnakePiece(SnakeState *snake, int index) {
-  Assert(index < ArrayCount(snake->pieces));
-  return &snake->pieces[index];
+// ---------------------------------------------------------------------------------------
+// Board
+// ---------------------------------------------------------------------------------------
+
+inline int
+BoardTileIndex(GameState *state, int x, int y) {
+  Assert(x >= 0 && x <= state->num_tiles_x + 1);
+  Assert(y >= 0 && y <= state->num_tiles_y + 1);
+  return x + (y * state->board_stride);
 }
 
-SnakePiece * GetSnakeHead(SnakeState *snake) {
-  return GetSnakePiece(snake, 0);
+inline uint8 *
+GetBoardTile(GameState *state, int x, int y) {
+  return &state->board[BoardTileIndex(state, x, y)];
+}
+
+inline bool32
+TileBitIsSet(uint64 *bits, int tile_idx) {
+  return (bits[tile_idx >> 6] >> (tile_idx & 63)) & 1;
+}
+
+inline void
+SetTileBit(uint64 *bits, int tile_idx) {
+  bits[tile_idx >> 6] |= ((uint64)1 << (tile_idx & 63));
+}
+
+inline void
+ClearTileBit(uint64 *bits, int tile_idx) {
+  bits[tile_idx >> 6] &= ~((uint64)1 << (tile_idx & 63));
 }
 
-int SnakePieceNextX(SnakePiece *piece) {
-  Direction dir = piece->dir;
-  if (dir == EAST) {
-    return piece->x + 1;
+// Mirrors the tile's flags into the bitboards.
+inline void
+SyncTileBits(GameState *state, int tile_idx) {
+  uint8 tile = state->board[tile_idx];
+  if (tile & (TILE_WALL|TILE_BODY)) {
+    SetTileBit(state->blocked_bits, tile_idx);
+  }
+  else {
+    ClearTileBit(state->blocked_bits, tile_idx);
   }
-  else if (dir == WEST) {
-    return piece->x - 1;
+  if (tile & TILE_FOOD) {
+    SetTileBit(state->food_bits, tile_idx);
   }
-  return piece->x;
+  else {
+    ClearTileBit(state->food_bits, tile_idx);
+  }
+}
+
+// Reports the bytes of the world arena a flag change on the tile writes, apart from the
+// free tile slots that move.
+inline void
+RewindTouchTile(GameState *state, int tile_idx) {
+  RewindHistory *rewind = &state->rewind;
+  RewindTouch(rewind, &state->board[tile_idx], sizeof(uint8));
+  RewindTouch(rewind, &state->blocked_bits[tile_idx >> 6], sizeof(uint64));
+  RewindTouch(rewind, &state->food_bits[tile_idx >> 6], sizeof(uint64));
+  RewindTouch(rewind, &state->free_tiles.positions[tile_idx], sizeof(int32));
 }
 
-int SnakePieceNextY(SnakePiece *piece) {
-  Direction dir = piece->dir;
-  if (dir == SOUTH) {
-    return piece->y + 1;
+// These keep the free tile index and the bitboards in sync with the board. Use them for
+// every flag change.
+inline void
+OccupyTile(GameState *state, int tile_idx, uint8 flag) {
+  uint8 *tile = &state->board[tile_idx];
+  RewindTouchTile(state, tile_idx);
+  if (*tile == TILE_EMPTY) {
+    // NOTE: the last free tile moves into this one's slot
+    FreeTileIndex *free_tiles = &state->free_tiles;
+    int32 last_tile = free_tiles->tiles[free_tiles->count - 1];
+    RewindTouch(&state->rewind, &free_tiles->tiles[free_tiles->positions[tile_idx]], sizeof(int32));
+    RewindTouch(&state->rewind, &free_tiles->positions[last_tile], sizeof(int32));
+    RemoveFreeTile(free_tiles, tile_idx);
   }
-  else if (dir == NORTH) {
-    return piece->y - 1;
+  state->board_hash ^= ZobristTileChange(tile_idx, *tile, *tile | flag);
+  *tile |= flag;
+  SyncTileBits(state, tile_idx);
+  MarkTileDirty(&state->dirty_tiles, tile_idx);
+}
+
+inline void
+VacateTile(GameState *state, int tile_idx, uint8 flag) {
+  uint8 *tile = &state->board[tile_idx];
+  if (*tile != TILE_EMPTY) {
+    RewindTouchTile(state, tile_idx);
+    state->board_hash ^= ZobristTileChange(tile_idx, *tile, *tile & ~flag);
+    *tile &= ~flag;
+    if (*tile == TILE_EMPTY) {
+      RewindTouch(&state->rewind, &state->free_tiles.tiles[state->free_tiles.count], sizeof(int32));
+      AddFreeTile(&state->free_tiles, tile_idx);
+    }
+    SyncTileBits(state, tile_idx);
+    MarkTileDirty(&state->dirty_tiles, tile_idx);
   }
-  return piece->y;
 }
 
-void MoveSnakePiece(SnakePiece *piece, Direction in_direction) {
-  switch(in_direction) {
+void ClearBoard(GameState *state) {
+  int board_rows = state->num_tiles_y + 2;
+  Assert(state->board_stride * board_rows == state->board_tile_count);
+
+  InitFreeTileIndex(&state->free_tiles,
+                    state->free_tiles.tiles, state->free_tiles.positions,
+                    state->board_tile_count);
+
+  // Nothing but walls, which the hash leaves out
+  state->board_hash = 0;
+  state->dirty_tiles.full_repaint = true;
+  RewindTouchAll(&state->rewind);
+
+  // Bits past the last tile count as blocked so searches never wander into them
+  for (int word_idx = 0; word_idx < state->board_bit_words; ++word_idx) {
+    state->blocked_bits[word_idx] = ~(uint64)0;
+    state->food_bits[word_idx] = 0;
+  }
+
+  for (int y = 0; y < board_rows; ++y) {
+    for (int x = 0; x < state->board_stride; ++x) {
+      bool32 is_border = (x == 0 || y == 0 ||
+                          x == state->board_stride - 1 || y == board_rows - 1);
+      int tile_idx = BoardTileIndex(state, x, y);
+      if (is_border) {
+        state->board[tile_idx] = TILE_WALL;
+      }
+      else {
+        state->board[tile_idx] = TILE_EMPTY;
+        ClearTileBit(state->blocked_bits, tile_idx);
+        AddFreeTile(&state->free_tiles, tile_idx);
+      }
+    }
+  }
+}
+
+inline bool32
+TileIsVisible(GameState *state, int x, int y) {
+  return (x <= state->visible_tiles_x && y <= state->visible_tiles_y);
+}
+
+inline uint32
+GridColor() {
+  return RGBColor(255, 255, 255);
+}
+
+// NOTE: pushes every tile. The renderer merges them into rows and skips the ones drawn over.
+void RenderGrid(RenderGroup *group, GameState *state) {
+  TIMED_BLOCK(RenderGrid);
+  for (int y = 1; y <= state->visible_tiles_y; ++y) {
+    for (int x = 1; x <= state->visible_tiles_x; ++x) {
+      PushTile(group, GridColor(), x - 1, y - 1);
+    }
+  }
+}
+
+// Index 0 is the head and `length - 1` is the tail.
+SnakePiece * GetSnakePiece(SnakeState *snake, int index) {
+  Assert(index >= 0 && index < snake->length);
+  int ring_idx = (snake->head_idx - index) & (snake->ring_size - 1);
+  return &snake->pieces[ring_idx];
+}
+
+SnakePiece * GetSnakeHead(SnakeState *snake) {
+  return GetSnakePiece(snake, 0);
+}
+
+SnakePiece * GetSnakeTail(SnakeState *snake) {
+  return GetSnakePiece(snake, snake->length - 1);
+}
+
+SnakePiece NextSnakePiece(SnakePiece *piece, Direction dir) {
+  SnakePiece result = *piece;
+  switch(dir) {
     case NORTH: {
-      piece->y--;
+      result.y--;
     } break;
 
     case SOUTH: {
-      piece->y++;
+      result.y++;
     } break;
 
     case EAST: {
-      piece->x++;
+      result.x++;
     } break;
 
     case WEST: {
-      piece->x--;
+      result.x--;
     } break;
   }
+  return result;
 }
 
 Direction OppositeDirection(Direction dir) {
@@ -151,287 +309,476 @@ Direction OppositeDirection(Direction dir) {
 
 void ExtendSnake(SnakeState *snake) {
   Assert((snake->length - 1) >= 0);
-  if (snake->length < ArrayCount(snake->pieces)) {
-    SnakePiece *tail = GetSnakePiece(snake, snake->length - 1);
-    SnakePiece new_piece;
-    new_piece.x = tail->x;
-    new_piece.y = tail->y;
-    // Can make use of this to shift the piece into place
-    MoveSnakePiece(&new_piece, OppositeDirection(tail->dir));
-    new_piece.dir = tail->dir;
-    snake->pieces[snake->length++] = new_piece;
+  if (snake->length + snake->pending_growth < snake->max_length) {
+    // The tail stays put on the next move, which makes room for the new piece.
+    snake->pending_growth++;
   }
   // TODO ELSE YOU WIN!
 }
 
+void ShrinkSnake(GameState *state, SnakeState *snake) {
+  if (snake->pending_growth > 0) {
+    snake->pending_growth--;
+  }
+  else if (snake->length > 1) {
+    // Dropping the length pops the tail since it's measured back from the head.
+    SnakePiece *tail = GetSnakeTail(snake);
+    VacateTile(state, BoardTileIndex(state, tail->x, tail->y), TILE_BODY);
+    snake->length--;
+    state->tail_vacated = false;
+  }
+}
+
 void ChangeSnakeDirection(SnakeState *snake, Direction new_dir) {
   if (snake->alive) {
-    SnakePiece *head = GetSnakeHead(snake);
-    Direction inverse_head_dir = OppositeDirection(head->dir);
-    if (head->dir != new_dir &&
+    Direction inverse_head_dir = OppositeDirection(snake->dir);
+    if (snake->dir != new_dir &&
         (new_dir != inverse_head_dir || snake->length == 1) &&
         snake->new_direction != new_dir) {
       snake->new_direction = new_dir;
-      if (snake->length > 1) {
-        // Record the path change
-        Assert(snake->num_dir_recordings < ArrayCount(snake->dir_recordings));
-        DirChangeRecord record = {};
-        record.dir = new_dir;
-        record.x = head->x;
-        record.y = head->y;
-        snake->dir_recordings[snake->num_dir_recordings++] = record;
-      }
     }
   }
 }
 
-// TODO LYNDA create an x and y version of GetTilePixel()
-void RenderRecordingSpot(GameOffscreenBuffer *buffer, GameState *state) {
-  uint32 color = RGBColor(0, 255, 255);
-  SnakeState *snake = &state->snake;
-  for (int idx = 0; idx < snake->num_dir_recordings; ++idx) {
-    DirChangeRecord *record = &snake->dir_recordings[idx];
-    int x_pixel = GetTilePixel(record->x, state->num_tiles_x, state->tile_size);
-    int y_pixel = GetTilePixel(record->y, state->num_tiles_y, state->tile_size);
-    DrawBlock(buffer, color, x_pixel, y_pixel, state->tile_size);
-  }
+inline uint32
+FoodColor() {
+  return RGBColor(100, 230, 140);
 }
 
-void RenderFood(GameOffscreenBuffer *buffer, GameState *state) {
-  uint32 color = RGBColor(100, 230, 140);
-  SnakeFood *food = &state->foods[0];
+void RenderFood(RenderGroup *group, GameState *state) {
+  uint32 color = FoodColor();
   for (int idx = 0; idx < state->num_foods; ++idx) {
     SnakeFood *food = &state->foods[idx];
-    if (food) {
-      int x_pixel = GetTilePixel(food->x, state->num_tiles_x, state->tile_size);
-      int y_pixel = GetTilePixel(food->y, state->num_tiles_y, state->tile_size);
-      DrawBlock(buffer, color, x_pixel, y_pixel, state->tile_size);
+    if (TileIsVisible(state, food->x, food->y)) {
+      PushTile(group, color, food->x - 1, food->y - 1);
+    }
+  }
+}
+
+/* Draws the part of a tile that touches its `side` edge, covering `fraction` of the tile.
+ * Used to slide the head into its new tile and the tail out of its old one.
+ */
+void RenderPartialTile(RenderGroup *group, GameState *state, uint32 color,
+                       SnakePiece *tile, Direction side, real32 fraction) {
+  int size = state->tile_size;
+  int covered = (int)(fraction * (real32)size + 0.5f);
+  if (covered > 0 && TileIsVisible(state, tile->x, tile->y)) {
+    int x_pixel = GetTilePixel(tile->x, state->num_tiles_x, size);
+    int y_pixel = GetTilePixel(tile->y, state->num_tiles_y, size);
+    switch(side) {
+      case NORTH: {
+        PushRect(group, color, x_pixel, y_pixel, size, covered);
+      } break;
+
+      case SOUTH: {
+        PushRect(group, color, x_pixel, y_pixel + size - covered, size, covered);
+      } break;
+
+      case WEST: {
+        PushRect(group, color, x_pixel, y_pixel, covered, size);
+      } break;
+
+      case EAST: {
+        PushRect(group, color, x_pixel + size - covered, y_pixel, covered, size);
+      } break;
     }
   }
 }
 
-void RenderSnake(GameOffscreenBuffer *buffer, GameState *state) {
+Direction DirectionBetween(SnakePiece *from, SnakePiece *to) {
+  if (to->x > from->x) {
+    return EAST;
+  }
+  else if (to->x < from->x) {
+    return WEST;
+  }
+  else if (to->y > from->y) {
+    return SOUTH;
+  }
+  else if (to->y < from->y) {
+    return NORTH;
+  }
+  return NONE;
+}
+
+inline uint32
+SnakeBodyColor(SnakeState *snake) {
+  return snake->alive ? RGBColor(20, 90, 255) : RGBColor(255, 0, 0);
+}
+
+inline uint32
+SnakeHeadColor(SnakeState *snake) {
+  return snake->alive ? RGBColor(10, 90, 203) : RGBColor(200, 0, 40);
+}
+
+/* `move_t` is how far we are between the last move and the next one, in [0, 1]. The sim
+ * state already has the head in its new tile, so we draw the head growing out of the tile
+ * it came from and the vacated tail tile shrinking away. Goes over whatever is already in
+ * those tiles.
+ */
+void RenderSnakeEnds(RenderGroup *group, GameState *state, real32 move_t) {
   SnakeState *snake = &state->snake;
+  uint32 color = SnakeBodyColor(snake);
+  uint32 head_color = SnakeHeadColor(snake);
   SnakePiece *head = GetSnakeHead(snake);
-  uint32 color = snake->alive ? RGBColor(20, 90, 255) : RGBColor(255, 0, 0);
-  uint32 head_color = snake->alive ? RGBColor(10, 90, 203) : RGBColor(200, 0, 40);
-  for (int piece_idx = 0; piece_idx < snake->length; ++piece_idx) {
+  Direction head_came_from = DirectionBetween(head, &state->prev_head);
+  if (!TileIsVisible(state, head->x, head->y)) {
+    // Off screen
+  }
+  else if (head_came_from == NONE || move_t >= 1.0f) {
+    PushTile(group, head_color, head->x - 1, head->y - 1);
+  }
+  else {
+    if (snake->length == 1) {
+      // Nothing else covers the tile the head left so keep it filled until we've moved on.
+      RenderPartialTile(group, state, head_color, &state->prev_head, OppositeDirection(head_came_from), 1.0f - move_t);
+    }
+    RenderPartialTile(group, state, head_color, head, head_came_from, move_t);
+  }
+
+  if (state->tail_vacated && snake->length > 1 && move_t < 1.0f) {
+    SnakePiece *tail = GetSnakeTail(snake);
+    Direction tail_went = DirectionBetween(&state->vacated_tail, tail);
+    RenderPartialTile(group, state, color, &state->vacated_tail, tail_went, 1.0f - move_t);
+  }
+}
+
+void RenderSnake(RenderGroup *group, GameState *state, real32 move_t) {
+  SnakeState *snake = &state->snake;
+  uint32 color = SnakeBodyColor(snake);
+  for (int piece_idx = 1; piece_idx < snake->length; ++piece_idx) {
     SnakePiece *piece = GetSnakePiece(snake, piece_idx);
-    if (piece) {
-      int x_pixel = GetTilePixel(piece->x, state->num_tiles_x, state->tile_size);
-      int y_pixel = GetTilePixel(piece->y, state->num_tiles_y, state->tile_size);
-      uint32 c = (piece_idx == 0) ? head_color : color;
-      DrawBlock(buffer, c, x_pixel, y_pixel, state->tile_size);
+    if (TileIsVisible(state, piece->x, piece->y)) {
+      PushTile(group, color, piece->x - 1, piece->y - 1);
     }
   }
+  RenderSnakeEnds(group, state, move_t);
 }
 
 void CreateFood(GameState *state) {
-  SnakeFood food = {};
-  food.eaten = false;
-  // TODO check for collision with player
-  if (state->num_foods < ArrayCount(state->foods)) {
-    // TODO check if food tile is already occupied
-    food.x = (int)(pcg32_boundedrand_r(&rng, state->num_tiles_x - 1) + 1);
-    food.y = (int)(pcg32_boundedrand_r(&rng, state->num_tiles_y - 1) + 1);
-    state->foods[state->num_foods++] = food;
+  if (state->num_foods < state->max_foods) {
+    int32 tile_idx = RandomFreeTile(&state->free_tiles, &state->rng);
+    // TODO a full board means you won
+    if (tile_idx >= 0) {
+      SnakeFood food = {};
+      food.x = (int16)(tile_idx % state->board_stride);
+      food.y = (int16)(tile_idx / state->board_stride);
+      OccupyTile(state, tile_idx, TILE_FOOD);
+      RewindTouch(&state->rewind, &state->foods[state->num_foods], sizeof(SnakeFood));
+      state->foods[state->num_foods++] = food;
+    }
+  }
+}
+
+void RemoveFood(GameState *state, int x, int y) {
+  VacateTile(state, BoardTileIndex(state, x, y), TILE_FOOD);
+  for (int idx = 0; idx < state->num_foods; ++idx) {
+    SnakeFood *food = &state->foods[idx];
+    if (food->x == x && food->y == y) {
+      // Order doesn't matter so swap the last one into the hole
+      RewindTouch(&state->rewind, food, sizeof(SnakeFood));
+      *food = state->foods[--state->num_foods];
+      break;
+    }
   }
 }
 
-real32 StepSpeed(SnakeState *snake) {
-   return snake->length * 0.005f;
+// The snake speeds up as it grows, bottoming out at a few ticks per move.
+int32 SnakeMoveIntervalTicks(SnakeState *snake) {
+  // TODO tune this curve. It used to be 0.25s - (0.005s * length) which hit zero at 50.
+  int32 result = 15 - ((snake->length * 3) / 10);
+  return Max(3, result);
 }
 
-void UpdateSnake(GameOffscreenBuffer *buffer, GameState *state, real32 dt) {
-  // Update is not frame rate independent at all
+/* The part of a move that happens once we know the snake survives it. Split out so the
+ * batched sim can run the death checks itself and share everything else.
+ */
+void AdvanceSnake(GameState *state, SnakePiece next, int next_tile_idx) {
   SnakeState *snake = &state->snake;
-  state->snake_update_timer -= dt;
-  if (state->snake_update_timer < 0.0f) {
-    // TODO speed slowly grows and then suddenly it's really really fast. Fix
-    state->snake_update_timer = 0.25f - StepSpeed(snake);
+  SnakePiece old_tail = *GetSnakeTail(snake);
+  state->prev_head = *GetSnakeHead(snake);
+  state->vacated_tail = old_tail;
+  state->tail_vacated = (snake->pending_growth == 0);
+
+  // Push the new head. The old tail slot falls off the end of the ring unless we're
+  // growing, in which case the length absorbs it.
+  snake->head_idx = (snake->head_idx + 1) & (snake->ring_size - 1);
+  RewindTouch(&state->rewind, &snake->pieces[snake->head_idx], sizeof(SnakePiece));
+  snake->pieces[snake->head_idx] = next;
+  OccupyTile(state, next_tile_idx, TILE_BODY);
+
+  if (snake->pending_growth > 0) {
+    snake->pending_growth--;
+    snake->length++;
+  }
+  else {
+    int tail_tile_idx = BoardTileIndex(state, old_tail.x, old_tail.y);
+    VacateTile(state, tail_tile_idx, TILE_BODY);
+
+    // Food is digested once the tail passes over it.
+    if (state->board[tail_tile_idx] & TILE_FOOD) {
+      RemoveFood(state, old_tail.x, old_tail.y);
+      ExtendSnake(snake);
+      state->score += 1;
+
+      // New food only shows up when the head finds some. If the head found all of it
+      // while we were at max_foods there'd be nothing left to find.
+      if (state->num_foods == 0) {
+        CreateFood(state);
+      }
+    }
+  }
 
-    SnakePiece *head = GetSnakeHead(snake);
-    SnakePiece *tail = &snake->pieces[snake->length - 1];
+  if (state->board[next_tile_idx] & TILE_FOOD) {
+    // TODO BUG: looks weird when you move the moment you eat a food
+    CreateFood(state);
+    CreateFood(state);
+    CreateFood(state);
+  }
+}
 
-    if (snake->new_direction != NONE) {
-      head->dir = snake->new_direction;
-      snake->new_direction = NONE;
-    }
+// Moves the snake one tile.
+void UpdateSnake(GameState *state) {
+  TIMED_BLOCK(UpdateSnake);
 
-    {
-      // Check if the next movement position results in death
-      int next_x = SnakePieceNextX(head);
-      int next_y = SnakePieceNextY(head);
-
-      // Check for collision with walls
-      if (next_x == 0 || next_x == state->num_tiles_x + 1
-          || next_y == 0 || next_y == state->num_tiles_y + 1) {
-        snake->alive = false;
-        //head->x = Max(1, Min(head->x, state->num_tiles_x));
-        //head->y = Max(1, Min(head->y, state->num_tiles_y));
-      }
-      // Check body collision
-      else if (snake->length > 1) {
-        for (int idx = 1; idx < snake->length; ++idx) {
-          SnakePiece *piece = GetSnakePiece(snake, idx);
-          if (piece && piece->x == next_x && piece->y == next_y) {
-            snake->alive = false;
-          }
-        }
-      }
-    }
+  SnakeState *snake = &state->snake;
+  if (snake->new_direction != NONE) {
+    snake->dir = snake->new_direction;
+    snake->new_direction = NONE;
+  }
 
-    if (snake->alive) {
-      // Move the head
-      MoveSnakePiece(head, head->dir);
-
-      // NOTE: two alternative approaches to solving the movement stuff. Have each piece
-      // prepare their next movement to be the direction of the previous piece's last move.
-      // NOTE: another way is to do the same as above but instead of mantaining a num_dir_recordings,
-      // just use the snake length for indexing. No need to delete recordings either.
-
-      // Move the body pieces
-      for (int piece_idx = 1; piece_idx < snake->length; ++piece_idx) {
-        SnakePiece *piece = GetSnakePiece(snake, piece_idx);
-        MoveSnakePiece(piece, piece->dir);
-        // TODO use the index to determine how many direction recordings need to be checked
-        //   instead of looping over all of them every time.
-        // Look at oldest recording first.
-        bool32 last_piece = (piece_idx == snake->length - 1);
-        for (int idx = 0; idx < snake->num_dir_recordings; ++idx) {
-          DirChangeRecord *record = &snake->dir_recordings[idx];
-          if (piece->x == record->x && piece->y == record->y) {
-            piece->dir = record->dir;
-
-            if (last_piece) {
-              // Delete the recording
-              for (int i = 0; i < snake->num_dir_recordings; ++i) {
-                if (i == snake->num_dir_recordings - 1) {
-                  snake->num_dir_recordings--;
-                  snake->dir_recordings[i] = {};
-                }
-                else {
-                  // Shift
-                  snake->dir_recordings[i] = snake->dir_recordings[i + 1];
-                }
-              }
-            }
-          }
-        }
-      }
+  SnakePiece next = NextSnakePiece(GetSnakeHead(snake), snake->dir);
+  int next_tile_idx = BoardTileIndex(state, next.x, next.y);
 
-      bool32 head_is_tail = (snake->length == 1);
-
-      // Eat
-      for (int idx = 0; idx < state->num_foods; ++idx) {
-        SnakeFood *food = &state->foods[idx];
-        // TODO BUG: looks weird when you move the moment you eat a food
-        if (food) {
-          if (!food->eaten) {
-            if ((head->x == food->x) && (head->y == food->y)) {
-              CreateFood(state);
-              CreateFood(state);
-              CreateFood(state);
-              if (head_is_tail) {
-                food->eaten = true;
-              }
-            }
-            else if (!head_is_tail && (tail->x == food->x) && (tail->y == food->y)) {
-              // We'll remove the piece on the next pass
-              food->eaten = true;
-              state->score += 1;
-            }
-          }
-          else {
-            for (int i = idx; i < state->num_foods; ++i) {
-              if (i == state->num_foods - 1) {
-                // Delete food
-                state->num_foods--;
-                state->foods[i] = {};
-              }
-              else {
-                // Shift food
-                state->foods[i] = state->foods[i + 1];
-              }
-            }
-            ExtendSnake(snake);
-          }
-        }
-      }
+  // NOTE: the tail hasn't moved yet so running into it is still fatal.
+  if (state->board[next_tile_idx] & (TILE_WALL|TILE_BODY)) {
+    snake->alive = false;
+  }
+
+  if (snake->alive) {
+    AdvanceSnake(state, next, next_tile_idx);
+  }
+}
+
+// Advances the sim by exactly SIM_SECONDS_PER_TICK. Must not depend on frame timing.
+void SimulateTick(GameState *state) {
+  TIMED_BLOCK(SimulateTick);
+
+  SnakeState *snake = &state->snake;
+  if (snake->alive) {
+    if (--state->snake_move_ticks_left <= 0) {
+      UpdateSnake(state);
+      state->snake_move_interval = SnakeMoveIntervalTicks(snake);
+      state->snake_move_ticks_left = state->snake_move_interval;
     }
   }
+  ++state->sim_tick;
 }
 
+#include "snake_swarm.cpp"
+#include "snake_autopilot.cpp"
+#include "snake_rewind.cpp"
+#include "snake_hash.cpp"
+
 void ResetGame(ThreadContext *thread, GameMemory *memory, GameState *state) {
   // TODO implement no walls mode
-  SnakeState snake = {};
-  snake.new_direction = NONE;
-  snake.num_dir_recordings = 0;
-  SnakePiece head = {};
-
-  head.dir = (Direction)(pcg32_boundedrand_r(&rng, 4) + 1);
-  head.x = (int)(state->num_tiles_x / 2);
-  head.y = (int)(state->num_tiles_y / 2);
+  ClearBoard(state);
+  state->num_foods = 0;
 
-  snake.pieces[0] = head;
-  snake.length = 1;
-  snake.alive = true;
+  int starting_foods = 5;
+  if (state->swarm.snake_count > 0) {
+    ResetSwarm(state);
+    starting_foods = state->max_foods / 2;
+  }
+  else {
+    SnakeState *snake = &state->snake;
+    snake->new_direction = NONE;
+    snake->dir = (Direction)(pcg32_boundedrand_r(&state->rng, 4) + 1);
+    snake->head_idx = 0;
+    snake->pending_growth = 0;
+
+    SnakePiece *head = &snake->pieces[snake->head_idx];
+    head->x = (int16)(state->num_tiles_x / 2);
+    head->y = (int16)(state->num_tiles_y / 2);
+    OccupyTile(state, BoardTileIndex(state, head->x, head->y), TILE_BODY);
+
+    snake->length = 1;
+    snake->alive = true;
+
+    state->snake_move_interval = SnakeMoveIntervalTicks(snake);
+    state->snake_move_ticks_left = state->snake_move_interval;
+    state->prev_head = *head;
+    state->tail_vacated = false;
+  }
 
-  state->snake = snake;
-  state->snake_update_timer = 0.0f;
+  state->sim_accumulator = 0.0f;
   state->do_game_reset = false;
   state->score = 0;
 
-  CreateFood(state);
-  CreateFood(state);
-  CreateFood(state);
-  CreateFood(state);
-  CreateFood(state);
+  for (int food_idx = 0; food_idx < starting_foods; ++food_idx) {
+    CreateFood(state);
+  }
+}
+
+/* Sizes the board from the config and carves all of the per-tile storage out of permanent
+ * storage. Nothing is allocated after this so the game never touches the heap.
+ */
+void InitializeGame(GameMemory *memory, GameState *state, GameOffscreenBuffer *screen_buffer) {
+  Assert(sizeof(GameState) <= memory->permanent_storage_size);
+
+  // NOTE: the platform can ask for a fresh game (e.g. to record a replay) by clearing
+  // is_initialized. Nothing from the old game may leak into the new one or replays of it
+  // would diverge.
+  *state = {};
+  InitializeArena(&state->world_arena,
+                  (size_t)(memory->permanent_storage_size - sizeof(GameState)),
+                  (uint8 *)memory->permanent_storage + sizeof(GameState));
+
+  // Setup the rng
+  pcg32_srandom_r(&state->rng, memory->rand_seed, memory->rand_rounds);
+
+  GameConfig *config = &memory->config;
+  state->game_width = screen_buffer->width;
+  state->game_height = screen_buffer->height;
+
+  // TODO investigate bug when the tile size is < 10 ish
+  if (config->tiles_x > 0 && config->tiles_y > 0) {
+    state->num_tiles_x = config->tiles_x;
+    state->num_tiles_y = config->tiles_y;
+    if (config->tile_size > 0) {
+      state->tile_size = config->tile_size;
+    }
+    else {
+      // Shrink the tiles to fit the board on screen, down to one pixel
+      int fit_size = Min(state->game_width / state->num_tiles_x,
+                         state->game_height / state->num_tiles_y);
+      state->tile_size = Max(1, Min(25, fit_size));
+    }
+  }
+  else {
+    state->tile_size = (config->tile_size > 0) ? config->tile_size : 25;
+    state->num_tiles_x = (int)(state->game_width / state->tile_size);
+    state->num_tiles_y = (int)(state->game_height / state->tile_size);
+  }
+  Assert(state->num_tiles_x + 2 <= BOARD_MAX_TILES_PER_SIDE);
+  Assert(state->num_tiles_y + 2 <= BOARD_MAX_TILES_PER_SIDE);
+
+  state->visible_tiles_x = Min(state->num_tiles_x, state->game_width / state->tile_size);
+  state->visible_tiles_y = Min(state->num_tiles_y, state->game_height / state->tile_size);
+
+  // TODO do we really need 1-indexed tiles?
+  state->board_stride = state->num_tiles_x + 2;
+  state->board_tile_count = state->board_stride * (state->num_tiles_y + 2);
+  state->free_tiles.tiles = PushArray(&state->world_arena, state->board_tile_count, int32);
+  state->free_tiles.positions = PushArray(&state->world_arena, state->board_tile_count, int32);
+
+  if (config->swarm_snake_count > 0) {
+    InitializeSwarm(state, config);
+  }
+  else {
+    SnakeState *snake = &state->snake;
+    snake->max_length = state->num_tiles_x * state->num_tiles_y;
+    snake->ring_size = 1;
+    while (snake->ring_size < snake->max_length) {
+      snake->ring_size <<= 1;
+    }
+    snake->pieces = PushArray(&state->world_arena, snake->ring_size, SnakePiece);
+  }
+
+  int default_max_foods = (state->swarm.snake_count > 0) ? (2 * state->swarm.snake_count) : 10;
+  state->max_foods = (config->max_foods > 0) ? config->max_foods : default_max_foods;
+  state->foods = PushArray(&state->world_arena, state->max_foods, SnakeFood);
+
+  state->board_bit_words = (state->board_tile_count + 63) / 64;
+  state->blocked_bits = PushArray(&state->world_arena, state->board_bit_words, uint64);
+  state->food_bits = PushArray(&state->world_arena, state->board_bit_words, uint64);
+
+  if (state->swarm.snake_count == 0) {
+    InitializeAutopilot(state);
+  }
+
+  // NOTE: padded so that wide loads of the last tile stay inside the arena
+  state->board = PushArray(&state->world_arena, state->board_tile_count + 4, uint8);
+
+  InitializeArena(&state->transient_arena, (size_t)memory->temp_storage_size, memory->temp_storage);
+  InitializeRewind(state);
+  InitializeDirtyTiles(state);
+  SubArena(&state->frame_arena, &state->transient_arena,
+           Min(GetArenaSizeRemaining(&state->transient_arena, 16), (size_t)Megabytes(64)));
 }
 
 void ProcessInput(GameInput *input, GameState *state) {
+  TIMED_BLOCK(ProcessInput);
+
+  state->rewind.step_request = 0;
+  state->rewind.resume_requested = false;
+
   for (int controller_idx = 0;
       controller_idx < ArrayCount(input->controllers);
       ++controller_idx) {
     GameControllerInput *controller = GetController(input, controller_idx);
     SnakeState *snake = &state->snake;
+    bool32 is_swarm = (state->swarm.snake_count > 0);
+    if (is_swarm) {
+      // Controllers past the human snakes don't drive anything
+      snake = (controller_idx < state->swarm.human_count) ? &state->swarm.snakes[controller_idx].body : 0;
+    }
 
     if (controller->is_analog) {
       /* NOTE:  Use analog movement tuning */
     }
     else {
       /* NOTE: Use digital movement tuning */
-      if (controller->move_left.ended_down) {
-        ChangeSnakeDirection(snake, WEST);
-      }
+      if (snake) {
+        if (controller->move_left.ended_down) {
+          ChangeSnakeDirection(snake, WEST);
+        }
+
+        if (controller->move_right.ended_down) {
+          ChangeSnakeDirection(snake, EAST);
+        }
+
+        if (controller->move_up.ended_down) {
+          ChangeSnakeDirection(snake, NORTH);
+        }
 
-      if (controller->move_right.ended_down) {
-        ChangeSnakeDirection(snake, EAST);
+        if (controller->move_down.ended_down) {
+          ChangeSnakeDirection(snake, SOUTH);
+        }
       }
 
-      if (controller->move_up.ended_down) {
-        ChangeSnakeDirection(snake, NORTH);
+      // NOTE: swarm snakes don't keep the single snake bookkeeping that ShrinkSnake expects
+      if (!is_swarm) {
+        if (controller->right_shoulder.ended_down && snake->alive) {
+          ExtendSnake(snake);
+        }
+        else if (controller->left_shoulder.ended_down && snake->alive) {
+          ShrinkSnake(state, snake);
+        }
       }
 
-      if (controller->move_down.ended_down) {
-        ChangeSnakeDirection(snake, SOUTH);
+      // Actions
+      if (!is_swarm && controller->back.ended_down && controller->back.half_transition_count > 0) {
+        state->autopilot.enabled = !state->autopilot.enabled;
       }
 
-      if (controller->right_shoulder.ended_down &&
-          snake->alive &&
-          snake->length < ArrayCount(snake->pieces)) {
-        ExtendSnake(snake);
+      // Rewind: hold left/right to step a tick per frame, start plays on from there
+      if (controller->action_left.ended_down) {
+        state->rewind.step_request = -1;
       }
-      else if (controller->left_shoulder.ended_down && snake->alive && snake->length > 1) {
-        snake->length--;
+      else if (controller->action_right.ended_down) {
+        state->rewind.step_request = 1;
       }
 
-      // Actions
       if (controller->start.ended_down) {
         if (!state->game_running) {
           state->game_running = true;
         }
-        else if (snake->alive == false) {
+        else if (state->rewind.undo_count > 0) {
+          state->rewind.resume_requested = true;
+        }
+        else if (!is_swarm && snake->alive == false) {
+          // Swarm snakes respawn on their own
           state->do_game_reset = true;
         }
       }
@@ -442,58 +789,243 @@ void ProcessInput(GameInput *input, GameState *state) {
   }
 }
 
-// ---------------------------------------------------------------------------------------
-// Game services for the platform layer
-// ---------------------------------------------------------------------------------------
-
-extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender) {
-  Assert((&input->controllers[0].terminator - &input->controllers[0].buttons[0]) ==
-         ArrayCount(input->controllers[0].buttons));
-  Assert(sizeof(GameState) <= memory->permanent_storage_size);
+/* Everything a frame does apart from drawing: input, resets and the fixed rate sim. Replays
+ * call this directly so they can run headless and as fast as the machine allows. Returns
+ * whether there's anything to draw this frame.
+ */
+bool32 UpdateGame(ThreadContext *thread, GameMemory *memory, GameInput *input, GameOffscreenBuffer *screen_buffer) {
+  TIMED_BLOCK(UpdateGame);
 
   GameState *state = (GameState *)memory->permanent_storage;
 
   if (!memory->is_initialized) {
-    char *filename = __FILE__;
-
-    // Setup the rng
-    pcg32_srandom_r(&rng, memory->rand_seed, memory->rand_rounds);
-
-    state->game_width = screen_buffer->width;
-    state->game_height = screen_buffer->height;
-    state->tile_size = 25; // TODO investigate bug when this is < 10 ish
-    state->num_tiles_x = (int)(state->game_width / state->tile_size);
-    state->num_tiles_y = (int)(state->game_height / state->tile_size);
-
+    InitializeGame(memory, state, screen_buffer);
     ResetGame(thread, memory, state);
 
-    // TODO do we really need 1-indexed tiles?
     // TODO this may be more appropriate to do in the platform layer
     memory->is_initialized = true;
   }
 
+  // Scratch memory only lives for one frame
+  ResetArena(&state->frame_arena);
+  CheckArena(&state->world_arena);
+
   ProcessInput(input, state);
+  state->tick_hash_count = 0;
 
+  if (state->rewind.resume_requested) {
+    RewindDropUndone(&state->rewind);
+  }
+
+  bool32 result = false;
   if (state->do_game_reset) {
     ResetGame(thread, memory, state);
   }
+  else if (state->game_running && RewindIsScrubbing(&state->rewind)) {
+    if (state->rewind.step_request < 0) {
+      RewindStepBack(state);
+    }
+    else if (state->rewind.step_request > 0) {
+      RewindStepForward(state);
+    }
+    result = true;
+  }
   else if (state->game_running) {
-    RenderGrid(screen_buffer, state);
-    SnakeState *snake = &state->snake;
-    if (snake->alive) {
-      UpdateSnake(screen_buffer, state, input->dt_for_frame);
+    state->sim_accumulator += input->dt_for_frame;
+    int32 tick_count = 0;
+    while (state->sim_accumulator >= SIM_SECONDS_PER_TICK) {
+      if (tick_count == SIM_MAX_TICKS_PER_FRAME) {
+        // Too far behind to catch up. Drop the time instead of trying.
+        state->sim_accumulator = 0.0f;
+        break;
+      }
+      if (state->swarm.snake_count > 0) {
+        SimulateSwarmTick(state);
+      }
+      else {
+        AutopilotTick(state);
+        SimulateTick(state);
+      }
+      state->sim_accumulator -= SIM_SECONDS_PER_TICK;
+      ++tick_count;
+      RewindRecordTick(state);
+
+#if SNAKE_SLOW
+      Assert(ComputeBoardHash(state) == state->board_hash);
+#endif
+      state->tick_hashes[state->tick_hash_count++] = GameStateHash(state);
+    }
+    result = true;
+  }
+  return result;
+}
+
+/* Repaints one tile the way a full render would leave it, apart from the single snake's
+ * head and sliding tail, which RenderSnakeEnds draws on top.
+ */
+internal void
+RenderTile(RenderGroup *group, GameState *state, int32 tile_idx) {
+  TIMED_BLOCK(RenderTile);
+
+  int32 x = tile_idx % state->board_stride;
+  int32 y = tile_idx / state->board_stride;
+  if (x >= 1 && y >= 1 && TileIsVisible(state, x, y)) {
+    uint8 tile = state->board[tile_idx];
+    uint32 color = (tile & TILE_FOOD) ? FoodColor() : GridColor();
+    if (tile & TILE_BODY) {
+      SwarmState *swarm = &state->swarm;
+      if (swarm->snake_count > 0) {
+        int32 owner = swarm->owners[tile_idx] & ~SWARM_OWNER_CLAIM;
+        if (owner != SWARM_NO_OWNER) {
+          color = swarm->snakes[owner - 1].color;
+        }
+      }
+      else {
+        SnakePiece *head = GetSnakeHead(&state->snake);
+        if (tile_idx != BoardTileIndex(state, head->x, head->y)) {
+          color = SnakeBodyColor(&state->snake);
+        }
+      }
+    }
+    PushTile(group, color, x - 1, y - 1);
+  }
+}
+
+/* Draws over the last frame. Only the tiles the sim changed and the ones the snake's ends
+ * are moving through get repainted, unless something means the whole board has to be
+ * (see snake_render.h). Everything goes through a render group on the frame arena that's
+ * drawn out at the end.
+ */
+void RenderGame(GameMemory *memory, GameOffscreenBuffer *screen_buffer) {
+  TIMED_BLOCK(RenderGame);
+
+  GameState *state = (GameState *)memory->permanent_storage;
+
+  // How far between the last move and the next one we are, counting the leftover
+  // partial tick so that motion is smooth at any render rate.
+  real32 move_t = 1.0f;
+  SnakeState *snake = &state->snake;
+  if (snake->alive) {
+    real32 ticks_into_move = (real32)(state->snake_move_interval - state->snake_move_ticks_left) +
+                             (state->sim_accumulator / SIM_SECONDS_PER_TICK);
+    move_t = Min(1.0f, ticks_into_move / (real32)state->snake_move_interval);
+  }
+
+  DirtyTiles *dirty = &state->dirty_tiles;
+  bool32 is_swarm = (state->swarm.snake_count > 0);
+  bool32 buffer_changed = (screen_buffer->needs_full_repaint ||
+                           screen_buffer->memory != dirty->painted_memory ||
+                           screen_buffer->width != dirty->painted_width ||
+                           screen_buffer->height != dirty->painted_height ||
+                           screen_buffer->pitch != dirty->painted_pitch);
+  if (buffer_changed || (!is_swarm && snake->alive != dirty->painted_alive)) {
+    dirty->full_repaint = true;
+  }
+
+  TemporaryMemory render_memory = BeginTemporaryMemory(&state->frame_arena);
+  RenderGroup *group = AllocateRenderGroup(&state->frame_arena, screen_buffer, state->tile_size,
+                                           state->visible_tiles_x, state->visible_tiles_y);
+  if (buffer_changed) {
+    // NOTE: nothing else draws the margin the board doesn't reach
+    PushClear(group, RGBColor(0, 0, 0));
+  }
+
+  // The tiles the single snake's ends are in this frame
+  int32 moving_count = 0;
+  int32 moving_tiles[DIRTY_MAX_MOVING_TILES];
+  if (!is_swarm && snake->length > 0) {
+    SnakePiece *head = GetSnakeHead(snake);
+    moving_tiles[moving_count++] = BoardTileIndex(state, head->x, head->y);
+    moving_tiles[moving_count++] = BoardTileIndex(state, state->prev_head.x, state->prev_head.y);
+    if (state->tail_vacated) {
+      moving_tiles[moving_count++] = BoardTileIndex(state, state->vacated_tail.x, state->vacated_tail.y);
+    }
+  }
+
+  if (dirty->full_repaint) {
+    RenderGrid(group, state);
+    RenderFood(group, state);
+    if (is_swarm) {
+      // TODO interpolate the swarm too. Not worth it while the tiles are a pixel or two.
+      RenderSwarm(group, state);
+    }
+    else {
+      RenderSnake(group, state, move_t);
+    }
+  }
+  else {
+    for (int32 dirty_idx = 0; dirty_idx < dirty->count; ++dirty_idx) {
+      RenderTile(group, state, dirty->tiles[dirty_idx]);
     }
-    RenderFood(screen_buffer, state);
-    RenderSnake(screen_buffer, state);
+    // NOTE: last frame's moving tiles too, so nothing is left half drawn once a move ends
+    for (int32 moving_idx = 0; moving_idx < dirty->moving_count; ++moving_idx) {
+      RenderTile(group, state, dirty->moving_tiles[moving_idx]);
+    }
+    for (int32 moving_idx = 0; moving_idx < moving_count; ++moving_idx) {
+      RenderTile(group, state, moving_tiles[moving_idx]);
+    }
+    if (!is_swarm) {
+      RenderSnakeEnds(group, state, move_t);
+    }
+  }
+
+  // NOTE: a frame of dirty tiles is too little work to be worth waking the workers for
+  if (memory->render_queue && dirty->full_repaint) {
+    TiledRenderGroupToOutput(memory->render_queue, memory->PlatformAddEntry,
+                             memory->PlatformCompleteAllWork, group);
+  }
+  else {
+    RenderGroupToOutput(group);
+  }
+  state->render_stats = group->stats;
+  EndTemporaryMemory(render_memory);
+
+  dirty->count = 0;
+  dirty->full_repaint = false;
+  dirty->moving_count = moving_count;
+  for (int32 moving_idx = 0; moving_idx < moving_count; ++moving_idx) {
+    dirty->moving_tiles[moving_idx] = moving_tiles[moving_idx];
+  }
+  dirty->painted_memory = screen_buffer->memory;
+  dirty->painted_width = screen_buffer->width;
+  dirty->painted_height = screen_buffer->height;
+  dirty->painted_pitch = screen_buffer->pitch;
+  dirty->painted_alive = snake->alive;
+}
+
+// ---------------------------------------------------------------------------------------
+// Game services for the platform layer
+// ---------------------------------------------------------------------------------------
+
+extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender) {
 #if SNAKE_INTERNAL
-    RenderRecordingSpot(screen_buffer, state);
+  // NOTE: a reload starts the game code over with a null one
+  global_debug_table = &memory->debug_table;
 #endif
+  TIMED_BLOCK(GameUpdateAndRender);
+
+  Assert((&input->controllers[0].terminator - &input->controllers[0].buttons[0]) ==
+         ArrayCount(input->controllers[0].buttons));
+
+  // NOTE: nothing to blit unless we draw something
+  screen_buffer->dirty_min_x = screen_buffer->dirty_max_x = 0;
+  screen_buffer->dirty_min_y = screen_buffer->dirty_max_y = 0;
+  if (UpdateGame(thread, memory, input, screen_buffer)) {
+    RenderGame(memory, screen_buffer);
+  }
+#if SNAKE_INTERNAL
+  if (memory->debug_table.overlay_enabled) {
+    DrawDebugOverlay(memory, screen_buffer);
   }
+#endif
 }
 
 // extern "C" tells the compiler to use the old C naming process which will preserve the
 // function name. This is needed in order for us to call the function from a DLL.
 extern "C" GAME_GET_SOUND_SAMPLES(GameGetSoundSamples) {
+#if SNAKE_INTERNAL
+  global_debug_table = &memory->debug_table;
+#endif
   GameState *state = (GameState *)memory->permanent_storage;
   // GameOutputSound(state, sound_buffer, state->tone_hz);
 }
@@ -14,6 +14,10 @@
 
 #include <stdint.h>
 #include <math.h> // TODO implement sine ourselves
+#include "pcg_basic.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #define internal static
 #define local_persist static
@@ -59,6 +63,81 @@ typedef double real64;
 #define Min(a, b) ((a) < (b) ? (a) : (b))
 #define Max(a, b) ((a) > (b) ? (a) : (b))
 
+inline uint32
+FindLeastSignificantSetBit(uint32 value) {
+  Assert(value != 0);
+#if defined(_MSC_VER)
+  unsigned long result;
+  _BitScanForward(&result, value);
+  return (uint32)result;
+#else
+  return (uint32)__builtin_ctz(value);
+#endif
+}
+
+inline uint32
+CountSetBits64(uint64 value) {
+#if defined(_MSC_VER)
+  return (uint32)__popcnt64(value);
+#else
+  return (uint32)__builtin_popcountll(value);
+#endif
+}
+
+/* SIMD kernels are compiled for their instruction set one function at a time with
+ * SIMD_TARGET and picked at runtime with GetSimdLevel. So the build doesn't need -mavx2 or
+ * -msse4.1 and the same binary still runs on machines without them. MSVC lets any function
+ * use any intrinsic, so there it's a no-op.
+ */
+#if defined(_MSC_VER)
+#define SIMD_TARGET(isa)
+#else
+#include <immintrin.h>
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+enum SimdLevel {
+  SimdLevel_Scalar,
+  SimdLevel_SSE41,
+  SimdLevel_AVX2,
+};
+
+// The widest kernels this machine can run. Only asks the CPU the first time.
+inline SimdLevel
+GetSimdLevel() {
+  local_persist int32 simd_level = -1;
+  if (simd_level < 0) {
+    int32 level = SimdLevel_Scalar;
+#if defined(_MSC_VER)
+    int32 cpu_info[4];
+    __cpuid(cpu_info, 0);
+    int32 max_leaf = cpu_info[0];
+    __cpuid(cpu_info, 1);
+    bool32 has_sse41 = (cpu_info[2] >> 19) & 1;
+    // NOTE: AVX also needs the OS to save the ymm registers
+    bool32 has_avx = (((cpu_info[2] >> 27) & 1) && ((cpu_info[2] >> 28) & 1) &&
+                      ((_xgetbv(0) & 6) == 6));
+    bool32 has_avx2 = false;
+    if (has_avx && max_leaf >= 7) {
+      __cpuidex(cpu_info, 7, 0);
+      has_avx2 = (cpu_info[1] >> 5) & 1;
+    }
+#else
+    __builtin_cpu_init();
+    bool32 has_sse41 = __builtin_cpu_supports("sse4.1");
+    bool32 has_avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (has_avx2) {
+      level = SimdLevel_AVX2;
+    }
+    else if (has_sse41) {
+      level = SimdLevel_SSE41;
+    }
+    simd_level = level;
+  }
+  return (SimdLevel)simd_level;
+}
+
 inline uint32
 SafeTruncateUInt64(uint64 value) {
   // TODO add defines for max values
@@ -107,6 +186,112 @@ struct ThreadContext {
 
 // TODO: swap as a macro??
 
+// ---------------------------------------------------------------------------------------
+// Memory
+// ---------------------------------------------------------------------------------------
+
+struct MemoryArena {
+  size_t size;
+  uint8 *base;
+  size_t used;
+
+  // Number of open temporary memory scopes. Must be zero whenever the arena is reset.
+  int32 temp_count;
+#if SNAKE_INTERNAL
+  size_t high_water_mark;
+#endif
+};
+
+struct TemporaryMemory {
+  MemoryArena *arena;
+  size_t used;
+};
+
+inline void
+InitializeArena(MemoryArena *arena, size_t size, void *base) {
+  arena->size = size;
+  arena->base = (uint8 *)base;
+  arena->used = 0;
+  arena->temp_count = 0;
+#if SNAKE_INTERNAL
+  arena->high_water_mark = 0;
+#endif
+}
+
+inline size_t
+GetAlignmentOffset(MemoryArena *arena, size_t alignment) {
+  // NOTE: alignment must be a power of two
+  size_t result = 0;
+  size_t result_pointer = (size_t)arena->base + arena->used;
+  size_t alignment_mask = alignment - 1;
+  if (result_pointer & alignment_mask) {
+    result = alignment - (result_pointer & alignment_mask);
+  }
+  return result;
+}
+
+inline size_t
+GetArenaSizeRemaining(MemoryArena *arena, size_t alignment = 8) {
+  size_t result = arena->size - (arena->used + GetAlignmentOffset(arena, alignment));
+  return result;
+}
+
+#define PushStruct(arena, type, ...) (type *)PushSize_(arena, sizeof(type), ## __VA_ARGS__)
+#define PushArray(arena, count, type, ...) (type *)PushSize_(arena, (count) * sizeof(type), ## __VA_ARGS__)
+#define PushSize(arena, size, ...) PushSize_(arena, size, ## __VA_ARGS__)
+inline void *
+PushSize_(MemoryArena *arena, size_t size, size_t alignment = 8) {
+  size_t alignment_offset = GetAlignmentOffset(arena, alignment);
+  Assert((arena->used + alignment_offset + size) <= arena->size);
+  void *result = arena->base + arena->used + alignment_offset;
+  arena->used += alignment_offset + size;
+#if SNAKE_INTERNAL
+  if (arena->used > arena->high_water_mark) {
+    arena->high_water_mark = arena->used;
+  }
+#endif
+  return result;
+}
+
+// Hands out a chunk of `arena` as its own arena. The chunk is never given back.
+inline void
+SubArena(MemoryArena *result, MemoryArena *arena, size_t size, size_t alignment = 16) {
+  InitializeArena(result, size, PushSize_(arena, size, alignment));
+}
+
+// Throws away everything that was pushed. Only valid with no temporary memory open.
+inline void
+ResetArena(MemoryArena *arena) {
+  Assert(arena->temp_count == 0);
+  arena->used = 0;
+}
+
+/* Scoped scratch memory. Everything pushed between Begin and End is released at End, so
+ * a subsystem can use the arena for per-call work without leaking into the next call.
+ */
+inline TemporaryMemory
+BeginTemporaryMemory(MemoryArena *arena) {
+  TemporaryMemory result;
+  result.arena = arena;
+  result.used = arena->used;
+  ++arena->temp_count;
+  return result;
+}
+
+inline void
+EndTemporaryMemory(TemporaryMemory temp_mem) {
+  MemoryArena *arena = temp_mem.arena;
+  Assert(arena->used >= temp_mem.used);
+  Assert(arena->temp_count > 0);
+  arena->used = temp_mem.used;
+  --arena->temp_count;
+}
+
+inline void
+CheckArena(MemoryArena *arena) {
+  Assert(arena->temp_count == 0);
+}
+
 // ---------------------------------------------------------------------------------------
 // Services that the platform layer provides to the game
 // ---------------------------------------------------------------------------------------
@@ -138,6 +323,25 @@ typedef DEBUG_PLATFORM_FREE_FILE_MEMORY(debug_platform_free_file_memory);
 
 #endif
 
+/* A queue of jobs for the platform's worker threads. The game adds entries from one
+ * thread and then waits with PlatformCompleteAllWork, which also works on the queue from
+ * the calling thread so a queue with no workers still gets everything done. Callbacks
+ * run on any thread in any order, so they must not write anything another entry reads or
+ * writes.
+ */
+struct PlatformWorkQueue;
+
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(PlatformWorkQueue *queue, void *data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(platform_work_queue_callback);
+
+#define PLATFORM_ADD_ENTRY(name) void name(PlatformWorkQueue *queue, platform_work_queue_callback *callback, void *data)
+typedef PLATFORM_ADD_ENTRY(platform_add_entry);
+
+#define PLATFORM_COMPLETE_ALL_WORK(name) void name(PlatformWorkQueue *queue)
+typedef PLATFORM_COMPLETE_ALL_WORK(platform_complete_all_work);
+
+#include "snake_debug.h"
+
 // ---------------------------------------------------------------------------------------
 // Services that the game provides to the platform layer.
 // (this may expand in the future - sound on separate thread, etc.)
@@ -152,6 +356,16 @@ struct GameOffscreenBuffer {
   int32 height;
   int32 pitch;
   int bytes_per_pixel;
+
+  // NOTE: set by the platform when the pixels might not be what the game drew last frame,
+  // e.g. after it restored a memory snapshot. The game repaints everything.
+  bool32 needs_full_repaint;
+
+  // Set by the game: the pixels it changed, [min, max). Empty when nothing was drawn.
+  int32 dirty_min_x;
+  int32 dirty_min_y;
+  int32 dirty_max_x;
+  int32 dirty_max_y;
 };
 
 struct GameSoundOutputBuffer {
@@ -219,9 +433,27 @@ inline GameControllerInput *GetController(GameInput *input, int controller_idx)
   return result;
 }
 
+/* Board and storage sizing handed to the game at startup. Any field left at zero gets a
+ * default, with the board sized to fill the backbuffer.
+ */
+struct GameConfig {
+  int32 tiles_x;
+  int32 tiles_y;
+  int32 tile_size; // in pixels
+  int32 max_foods;
+
+  // Many snake mode. Zero snakes plays the regular single snake game.
+  int32 swarm_snake_count;
+  int32 swarm_human_count;  // the first N snakes are driven by controllers 0..N-1
+  int32 swarm_max_length;   // rounded up to a power of two
+  int32 swarm_start_length; // grown into over the first moves after every spawn
+};
+
 struct GameMemory {
   bool32 is_initialized;
 
+  GameConfig config;
+
   uint64 rand_seed;
   uint64 rand_rounds;
 
@@ -231,10 +463,21 @@ struct GameMemory {
   uint64 temp_storage_size;
   void *temp_storage; /* NOTE: REQUIRED to be cleared to zero at startup */
 
+  // Null when the platform has no worker threads, in which case everything is drawn on
+  // the calling thread.
+  PlatformWorkQueue *render_queue;
+  platform_add_entry *PlatformAddEntry;
+  platform_complete_all_work *PlatformCompleteAllWork;
+
+#if SNAKE_INTERNAL
   // Almost like our own little vtable.
   debug_platform_read_entire_file *DEBUGPlatformReadEntireFile;
   debug_platform_write_entire_file *DEBUGPlatformWriteEntireFile;
   debug_platform_free_file_memory *DEBUGPlatformFreeFileMemory;
+
+  // Timed block counters. Kept here so they outlive the game code. See snake_debug.h.
+  DebugTable debug_table;
+#endif
 };
 
 // TODO: needs four things: controller/keyboard input, bitmap buffer to use, sound buffer and timing
@@ -252,39 +495,87 @@ typedef GAME_GET_SOUND_SAMPLES(game_get_sound_samples);
 
 enum Direction {NONE, NORTH, EAST, SOUTH, WEST};
 
+// NOTE: 16-bit coordinates keep the ring small enough for boards with millions of tiles.
 struct SnakePiece {
-  Direction dir;
-  Direction prev_dir;
-  int x;
-  int y;
-};
-
-struct DirChangeRecord {
-  Direction dir;
-  int x;
-  int y;
+  int16 x;
+  int16 y;
 };
 
+/* The body is a ring buffer of tile positions. The head lives at `head_idx` and the tail
+ * is `length - 1` slots behind it. A move pushes a new head slot and lets the tail slot
+ * fall off the end, so a step costs the same no matter how long the snake is. Growing is
+ * done by skipping the tail pop for `pending_growth` moves.
+ */
 struct SnakeState {
   int length;
+  int max_length; // the snake can cover every tile of the board
+  int head_idx;
+  int pending_growth;
   bool32 alive;
+  Direction dir;
   Direction new_direction;
-  DirChangeRecord dir_recordings[2000];
-  int num_dir_recordings;
-  SnakePiece pieces[200];
+
+  // NOTE: ring_size is a power of two so that ring indices can be wrapped with a mask.
+  int ring_size;
+  SnakePiece *pieces;
 };
 
 struct SnakeFood {
-  int x;
-  int y;
-  bool32 eaten;
+  int16 x;
+  int16 y;
 };
 
+/* Each board tile carries a set of flags. A tile can be both BODY and FOOD while the snake
+ * is digesting something, so these are bits rather than a single tag.
+ */
+enum TileFlag {
+  TILE_EMPTY = 0,
+  TILE_BODY = (1 << 0),
+  TILE_FOOD = (1 << 1),
+  TILE_WALL = (1 << 2),
+};
+
+/* The sim runs at a fixed rate no matter how fast we render. Each frame feeds its measured
+ * wall time into an accumulator and we run as many ticks as fit. The catch-up cap keeps a
+ * long stall (debugger, window drag) from turning into a spiral of ever longer frames.
+ */
+#define SIM_TICKS_PER_SECOND 60
+#define SIM_SECONDS_PER_TICK (1.0f / (real32)SIM_TICKS_PER_SECOND)
+#define SIM_MAX_TICKS_PER_FRAME 8
+
+// NOTE: tile coordinates are stored in 16 bits and include the wall border.
+#define BOARD_MAX_TILES_PER_SIDE 32000
+
+/* Dense list of the empty tiles plus a map from board tile to its slot in that list.
+ * Occupying a tile swap-removes it and freeing one appends it, so picking a uniformly
+ * random empty tile is one draw no matter how full the board is.
+ */
+struct FreeTileIndex {
+  int32 count;
+  int32 capacity;
+  int32 *tiles;     // board tile indices
+  int32 *positions; // board tile index -> slot in `tiles`, -1 when the tile isn't free
+};
+
+#include "snake_swarm.h"
+#include "snake_autopilot.h"
+#include "snake_rewind.h"
+#include "snake_hash.h"
+#include "snake_render.h"
+
 /* NOTE: might relocate this later since the platform layer doesn't need to know about it at all */
  struct GameState {
+  MemoryArena world_arena;      // permanent_storage, lives as long as the game
+  MemoryArena transient_arena;  // temp_storage, anything that can be rebuilt
+  MemoryArena frame_arena;      // carved from transient_arena, reset every frame
+
+  // Every game owns its generator so that independent games never share a sequence.
+  pcg32_random_t rng;
+
   SnakeState snake;
-  SnakeFood foods[10];
   int num_foods;
+  int max_foods;
+  SnakeFood *foods;
   bool32 game_running;
   bool32 do_game_reset;
 
@@ -293,10 +584,50 @@ struct SnakeFood {
   int tile_size; // treated as a square
   int num_tiles_x;
   int num_tiles_y;
-  real32 snake_update_timer;
+  // Boards can be bigger than the backbuffer. We only draw the tiles that fit.
+  int visible_tiles_x;
+  int visible_tiles_y;
+
+  uint64 sim_tick;
+  real32 sim_accumulator;
+  int32 snake_move_interval; // in ticks
+  int32 snake_move_ticks_left;
+
+  // Where the last move came from so that rendering can slide between moves.
+  SnakePiece prev_head;
+  SnakePiece vacated_tail;
+  bool32 tail_vacated;
+
+  // Occupancy for every tile plus the wall border. Tiles are 1-indexed so the border sits
+  // at 0 and num_tiles + 1, which lets us index with x + (y * board_stride) directly.
+  int board_stride;
+  int board_tile_count;
+  uint8 *board;
+
+  // The same tiles one bit each, kept in sync by OccupyTile/VacateTile so that searches
+  // can work on 64 tiles at a time. Bit n of the array is board tile n.
+  int32 board_bit_words;
+  uint64 *blocked_bits; // TILE_WALL or TILE_BODY
+  uint64 *food_bits;
+
+  // Zobrist hash of the body and food flags, kept up to date by OccupyTile/VacateTile.
+  uint64 board_hash;
+  // GameStateHash after each tick of the current frame, for replays to check against
+  int32 tick_hash_count;
+  uint64 tick_hashes[SIM_MAX_TICKS_PER_FRAME];
+
+  FreeTileIndex free_tiles;
+
+  SwarmState swarm;
+  Autopilot autopilot;
+  RewindHistory rewind;
+  DirtyTiles dirty_tiles;
+  RenderStats render_stats; // the last frame's
 
   int score;
 };
 
+#include "snake_replay.h"
+
 #define SNAKE_GAME_H
 #endif
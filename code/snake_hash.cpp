@@ -0,0 +1,197 @@
+/* State hashing. See snake_hash.h.
+ *
+ * Included by snake_game.cpp after the sim.
+ */
+
+// The reference version of ComputeBoardHash, one tile at a time
+internal uint64
+ComputeBoardHashScalar(GameState *state) {
+  uint64 result = 0;
+  for (int32 tile_idx = 0; tile_idx < state->board_tile_count; ++tile_idx) {
+    result ^= ZobristTileChange(tile_idx, TILE_EMPTY, state->board[tile_idx]);
+  }
+  return result;
+}
+
+SIMD_TARGET("avx2") inline __m256i
+HashMix32x8(__m256i h) {
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int32)0x85EBCA6B));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int32)0xC2B2AE35));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+  return h;
+}
+
+SIMD_TARGET("avx2") inline uint32
+XorLanes32x8(__m256i value) {
+  __m128i folded = _mm_xor_si128(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+  folded = _mm_xor_si128(folded, _mm_shuffle_epi32(folded, _MM_SHUFFLE(1, 0, 3, 2)));
+  folded = _mm_xor_si128(folded, _mm_shuffle_epi32(folded, _MM_SHUFFLE(2, 3, 0, 1)));
+  return (uint32)_mm_cvtsi128_si32(folded);
+}
+
+SIMD_TARGET("sse4.1") inline __m128i
+HashMix32x4(__m128i h) {
+  h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+  h = _mm_mullo_epi32(h, _mm_set1_epi32((int32)0x85EBCA6B));
+  h = _mm_xor_si128(h, _mm_srli_epi32(h, 13));
+  h = _mm_mullo_epi32(h, _mm_set1_epi32((int32)0xC2B2AE35));
+  h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+  return h;
+}
+
+SIMD_TARGET("sse4.1") inline uint32
+XorLanes32x4(__m128i value) {
+  value = _mm_xor_si128(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+  value = _mm_xor_si128(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 3, 0, 1)));
+  return (uint32)_mm_cvtsi128_si32(value);
+}
+
+/* The wide kernels of ComputeBoardHash. They hash whole groups of tiles from *tile_idx on
+ * and leave it at the first tile they didn't get to.
+ */
+SIMD_TARGET("avx2") internal uint64
+ComputeBoardHash8(GameState *state, int32 *first_tile_idx) {
+  int32 tile_idx = *first_tile_idx;
+  __m256i flag_mask = _mm256_set1_epi32(TILE_BODY|TILE_FOOD);
+  __m256i body = _mm256_set1_epi32(TILE_BODY);
+  __m256i food = _mm256_set1_epi32(TILE_FOOD);
+  __m256i seed_lo = _mm256_set1_epi32((int32)ZOBRIST_SEED_LO);
+  __m256i seed_hi = _mm256_set1_epi32((int32)ZOBRIST_SEED_HI);
+  __m256i lane_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i sum_lo = _mm256_setzero_si256();
+  __m256i sum_hi = _mm256_setzero_si256();
+  for (; tile_idx + 8 <= state->board_tile_count; tile_idx += 8) {
+    __m256i tiles = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i *)(state->board + tile_idx)));
+    tiles = _mm256_and_si256(tiles, flag_mask);
+    if (!_mm256_testz_si256(tiles, tiles)) {
+      __m256i body_mask = _mm256_cmpeq_epi32(_mm256_and_si256(tiles, body), body);
+      __m256i food_mask = _mm256_cmpeq_epi32(_mm256_and_si256(tiles, food), food);
+      __m256i key_idx = _mm256_slli_epi32(_mm256_add_epi32(_mm256_set1_epi32(tile_idx), lane_offsets), 2);
+      __m256i body_idx = _mm256_or_si256(key_idx, body);
+      __m256i food_idx = _mm256_or_si256(key_idx, food);
+
+      sum_lo = _mm256_xor_si256(sum_lo, _mm256_and_si256(body_mask, HashMix32x8(_mm256_xor_si256(body_idx, seed_lo))));
+      sum_hi = _mm256_xor_si256(sum_hi, _mm256_and_si256(body_mask, HashMix32x8(_mm256_xor_si256(body_idx, seed_hi))));
+      sum_lo = _mm256_xor_si256(sum_lo, _mm256_and_si256(food_mask, HashMix32x8(_mm256_xor_si256(food_idx, seed_lo))));
+      sum_hi = _mm256_xor_si256(sum_hi, _mm256_and_si256(food_mask, HashMix32x8(_mm256_xor_si256(food_idx, seed_hi))));
+    }
+  }
+  *first_tile_idx = tile_idx;
+  uint64 result = ((uint64)XorLanes32x8(sum_hi) << 32) | XorLanes32x8(sum_lo);
+  return result;
+}
+
+SIMD_TARGET("sse4.1") internal uint64
+ComputeBoardHash4(GameState *state, int32 *first_tile_idx) {
+  int32 tile_idx = *first_tile_idx;
+  __m128i flag_mask = _mm_set1_epi32(TILE_BODY|TILE_FOOD);
+  __m128i body = _mm_set1_epi32(TILE_BODY);
+  __m128i food = _mm_set1_epi32(TILE_FOOD);
+  __m128i seed_lo = _mm_set1_epi32((int32)ZOBRIST_SEED_LO);
+  __m128i seed_hi = _mm_set1_epi32((int32)ZOBRIST_SEED_HI);
+  __m128i lane_offsets = _mm_setr_epi32(0, 1, 2, 3);
+  __m128i sum_lo = _mm_setzero_si128();
+  __m128i sum_hi = _mm_setzero_si128();
+  for (; tile_idx + 4 <= state->board_tile_count; tile_idx += 4) {
+    __m128i tiles = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(int32 *)(state->board + tile_idx)));
+    tiles = _mm_and_si128(tiles, flag_mask);
+    if (!_mm_testz_si128(tiles, tiles)) {
+      __m128i body_mask = _mm_cmpeq_epi32(_mm_and_si128(tiles, body), body);
+      __m128i food_mask = _mm_cmpeq_epi32(_mm_and_si128(tiles, food), food);
+      __m128i key_idx = _mm_slli_epi32(_mm_add_epi32(_mm_set1_epi32(tile_idx), lane_offsets), 2);
+      __m128i body_idx = _mm_or_si128(key_idx, body);
+      __m128i food_idx = _mm_or_si128(key_idx, food);
+
+      sum_lo = _mm_xor_si128(sum_lo, _mm_and_si128(body_mask, HashMix32x4(_mm_xor_si128(body_idx, seed_lo))));
+      sum_hi = _mm_xor_si128(sum_hi, _mm_and_si128(body_mask, HashMix32x4(_mm_xor_si128(body_idx, seed_hi))));
+      sum_lo = _mm_xor_si128(sum_lo, _mm_and_si128(food_mask, HashMix32x4(_mm_xor_si128(food_idx, seed_lo))));
+      sum_hi = _mm_xor_si128(sum_hi, _mm_and_si128(food_mask, HashMix32x4(_mm_xor_si128(food_idx, seed_hi))));
+    }
+  }
+  *first_tile_idx = tile_idx;
+  uint64 result = ((uint64)XorLanes32x4(sum_hi) << 32) | XorLanes32x4(sum_lo);
+  return result;
+}
+
+// How many tiles at a time ComputeBoardHash works on this machine
+inline int32
+BoardHashWidth() {
+  SimdLevel level = GetSimdLevel();
+  int32 result = (level == SimdLevel_AVX2) ? 8 : ((level == SimdLevel_SSE41) ? 4 : 1);
+  return result;
+}
+
+/* Recomputes the Zobrist hash of the whole board from scratch. Should always equal
+ * state->board_hash. Works BoardHashWidth tiles at a time: both halves of both keys are
+ * mixed in every lane, masked by the tile's flags and XORed into per lane sums that get
+ * folded together at the end. Groups with nothing but empty and wall tiles are skipped,
+ * which is most of them.
+ */
+internal uint64
+ComputeBoardHash(GameState *state) {
+  int32 tile_idx = 0;
+  uint64 result = 0;
+  int32 width = BoardHashWidth();
+  if (width == 8) {
+    result = ComputeBoardHash8(state, &tile_idx);
+  }
+  else if (width == 4) {
+    result = ComputeBoardHash4(state, &tile_idx);
+  }
+
+  for (; tile_idx < state->board_tile_count; ++tile_idx) {
+    result ^= ZobristTileChange(tile_idx, TILE_EMPTY, state->board[tile_idx]);
+  }
+  return result;
+}
+
+// splitmix64's finalizer over the running hash and the next value
+inline uint64
+HashCombine(uint64 hash, uint64 value) {
+  uint64 result = hash ^ (value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2));
+  result = (result ^ (result >> 30)) * 0xBF58476D1CE4E5B9ull;
+  result = (result ^ (result >> 27)) * 0x94D049BB133111EBull;
+  result ^= result >> 31;
+  return result;
+}
+
+/* A fingerprint of everything the sim's future depends on, given the board's hash. Two
+ * games with the same hash are (barring collisions) in the same state. Swarm snakes'
+ * own fields aren't folded in; their bodies are on the board and their choices come out
+ * of the rng.
+ */
+internal uint64
+GameStateHashWithBoard(GameState *state, uint64 board_hash) {
+  SnakeState *snake = &state->snake;
+  uint64 result = board_hash;
+  result = HashCombine(result, state->sim_tick);
+  result = HashCombine(result, state->rng.state);
+  result = HashCombine(result, state->rng.inc);
+  result = HashCombine(result, ((uint64)(uint32)state->score << 32) | (uint32)state->num_foods);
+  result = HashCombine(result, ((uint64)(uint32)state->snake_move_ticks_left << 32) |
+                               (uint32)state->snake_move_interval);
+  result = HashCombine(result, ((uint64)(uint32)snake->length << 32) | (uint32)snake->pending_growth);
+  result = HashCombine(result, ((uint64)snake->dir << 8) | ((uint64)snake->new_direction << 4) |
+                               (uint64)(snake->alive != 0));
+  if (snake->length > 0 && snake->pieces) {
+    SnakePiece *head = GetSnakeHead(snake);
+    result = HashCombine(result, ((uint64)(uint16)head->x << 16) | (uint16)head->y);
+  }
+  return result;
+}
+
+// O(1): uses the incrementally maintained board hash
+inline uint64
+GameStateHash(GameState *state) {
+  uint64 result = GameStateHashWithBoard(state, state->board_hash);
+  return result;
+}
+
+// Recomputes everything. Use it to check that GameStateHash hasn't drifted.
+inline uint64
+FullGameStateHash(GameState *state) {
+  uint64 result = GameStateHashWithBoard(state, ComputeBoardHash(state));
+  return result;
+}
@@ -0,0 +1,56 @@
+#if !defined(SNAKE_HASH_H)
+
+/* State hashing for determinism checks.
+ *
+ * The board part is a Zobrist hash: every (tile, flag) pair for the body and food flags has
+ * its own 64-bit key and the hash is the XOR of the keys of every flag that is set.
+ * OccupyTile and VacateTile XOR keys in and out as flags change, so head in, tail out and
+ * food spawning or being eaten each cost a couple of key computations and the hash is
+ * always current. Walls never change so they're left out.
+ *
+ * Keys aren't stored in a table. They're computed from the tile index with a 32-bit
+ * integer mixer, one for each half, which keeps huge boards free and lets the full
+ * recompute (ComputeBoardHash) run eight tiles at a time with AVX2.
+ *
+ * The handful of scalars (tick, snake direction, length, score, rng, ...) are cheap to read
+ * so GameStateHash folds them in when asked instead of tracking them.
+ */
+
+#define ZOBRIST_SEED_LO 0x9E3779B9
+#define ZOBRIST_SEED_HI 0x7F4A7C15
+
+// Murmur3's finalizer
+inline uint32
+HashMix32(uint32 h) {
+  h ^= h >> 16;
+  h *= 0x85EBCA6B;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35;
+  h ^= h >> 16;
+  return h;
+}
+
+// flag is TILE_BODY or TILE_FOOD
+inline uint64
+ZobristTileKey(int32 tile_idx, uint32 flag) {
+  uint32 key_idx = ((uint32)tile_idx << 2) | flag;
+  uint64 result = ((uint64)HashMix32(key_idx ^ ZOBRIST_SEED_HI) << 32) | HashMix32(key_idx ^ ZOBRIST_SEED_LO);
+  return result;
+}
+
+// Keys for whichever hashed flags differ between two values of a tile
+inline uint64
+ZobristTileChange(int32 tile_idx, uint8 before, uint8 after) {
+  uint8 changed = before ^ after;
+  uint64 result = 0;
+  if (changed & TILE_BODY) {
+    result ^= ZobristTileKey(tile_idx, TILE_BODY);
+  }
+  if (changed & TILE_FOOD) {
+    result ^= ZobristTileKey(tile_idx, TILE_FOOD);
+  }
+  return result;
+}
+
+#define SNAKE_HASH_H
+#endif
@@ -0,0 +1,145 @@
+#if !defined(SNAKE_PACER_H)
+
+/* Frame pacing shared by the platform layers. The platform specific half, the actual
+ * sleeping, lives in linux_frame_pacer.cpp and win32_frame_pacer.cpp.
+ *
+ * Sleeping straight to the deadline overshoots by however late the OS wakes us up, which
+ * is easily a millisecond. Spinning the whole way is exact but burns a core. So we sleep
+ * until spin_margin_ns before the deadline and spin (with pause) for the rest.
+ *
+ * The margin follows the oversleep we actually see: a wake up later than the margin
+ * allows raises it right away (plus some slack), since that costs us the frame, and it
+ * creeps back down while wake ups are punctual so we don't spin more than needed.
+ *
+ * Every frame's error, how far past the deadline it ended, goes into a histogram with
+ * power of two microsecond buckets, along with counts of missed frames (the work itself
+ * ran past the deadline) and late ones (we were in time but woke up too late).
+ */
+
+#include <stdio.h>
+
+#define PACER_HISTOGRAM_BUCKET_COUNT 24 // the last one is 2^22 us (4 s) and up
+
+struct FramePacer {
+  uint64 target_ns;
+  uint64 spin_margin_ns;
+  uint64 min_margin_ns;
+  uint64 max_margin_ns;
+
+  // Stats
+  uint64 frame_count;
+  uint64 missed_count; // the frame's work ran past the deadline
+  uint64 late_count; // there was time to wait but we woke up after the deadline
+  uint64 sleep_count;
+  uint64 max_oversleep_ns;
+  uint64 total_spin_ns;
+  uint64 max_error_ns;
+  uint32 error_histogram[PACER_HISTOGRAM_BUCKET_COUNT];
+};
+
+inline void
+InitFramePacer(FramePacer *pacer, uint64 target_ns) {
+  *pacer = {};
+  pacer->target_ns = target_ns;
+  pacer->min_margin_ns = 50000; // 50 us
+  pacer->max_margin_ns = target_ns / 2;
+  pacer->spin_margin_ns = 2000000; // 2 ms until we know better
+  if (pacer->spin_margin_ns > pacer->max_margin_ns) {
+    pacer->spin_margin_ns = pacer->max_margin_ns;
+  }
+}
+
+// When to wake up from the sleep part of the wait for deadline_ns
+inline uint64
+PacerWakeTime(FramePacer *pacer, uint64 deadline_ns) {
+  uint64 result = deadline_ns - pacer->spin_margin_ns;
+  return result;
+}
+
+// Adapts the margin to how late we woke up from a sleep that was meant to end at wake_ns
+inline void
+PacerRecordSleep(FramePacer *pacer, uint64 wake_ns, uint64 woke_ns) {
+  uint64 oversleep_ns = (woke_ns > wake_ns) ? (woke_ns - wake_ns) : 0;
+  ++pacer->sleep_count;
+  pacer->max_oversleep_ns = Max(pacer->max_oversleep_ns, oversleep_ns);
+
+  if (oversleep_ns + (oversleep_ns >> 2) > pacer->spin_margin_ns) {
+    pacer->spin_margin_ns = oversleep_ns + (oversleep_ns >> 2);
+  }
+  else {
+    // NOTE: about a second at 60 Hz to fall halfway back
+    pacer->spin_margin_ns -= (pacer->spin_margin_ns - oversleep_ns) >> 6;
+  }
+  pacer->spin_margin_ns = Min(Max(pacer->spin_margin_ns, pacer->min_margin_ns), pacer->max_margin_ns);
+}
+
+inline int32
+PacerHistogramBucket(uint64 error_ns) {
+  uint64 error_us = error_ns / 1000;
+  int32 result = 0;
+  while (error_us && result < PACER_HISTOGRAM_BUCKET_COUNT - 1) {
+    error_us >>= 1;
+    ++result;
+  }
+  return result;
+}
+
+/* Call once the wait is over. end_ns is when it ended and missed says whether the work
+ * was already past the deadline when the wait started.
+ */
+inline void
+PacerRecordFrame(FramePacer *pacer, uint64 deadline_ns, uint64 end_ns, bool32 missed) {
+  uint64 error_ns = (end_ns > deadline_ns) ? (end_ns - deadline_ns) : 0;
+  ++pacer->frame_count;
+  if (missed) {
+    ++pacer->missed_count;
+  }
+  else if (error_ns > pacer->min_margin_ns) {
+    ++pacer->late_count;
+  }
+  pacer->max_error_ns = Max(pacer->max_error_ns, error_ns);
+  ++pacer->error_histogram[PacerHistogramBucket(error_ns)];
+}
+
+/* Writes the stats as text for the platform to print or log. Returns the length, which is
+ * cut short if the buffer is too small.
+ */
+internal int32
+FormatFramePacerStats(FramePacer *pacer, char *buffer, int32 buffer_size) {
+  int32 length = 0;
+  length += snprintf(buffer + length, buffer_size - length,
+                     "Frame pacing: %llu frames at %.3fms, %llu missed, %llu late, "
+                     "worst %.3fms past the deadline\n"
+                     "  %llu sleeps, worst oversleep %.3fms, spin margin now %.3fms, "
+                     "%.3fms spent spinning per frame\n",
+                     (unsigned long long)pacer->frame_count, (real64)pacer->target_ns / 1e6,
+                     (unsigned long long)pacer->missed_count, (unsigned long long)pacer->late_count,
+                     (real64)pacer->max_error_ns / 1e6,
+                     (unsigned long long)pacer->sleep_count, (real64)pacer->max_oversleep_ns / 1e6,
+                     (real64)pacer->spin_margin_ns / 1e6,
+                     pacer->frame_count ? (real64)pacer->total_spin_ns / 1e6 / pacer->frame_count : 0.0);
+  for (int32 bucket_idx = 0;
+       bucket_idx < PACER_HISTOGRAM_BUCKET_COUNT && length < buffer_size;
+       ++bucket_idx) {
+    uint32 count = pacer->error_histogram[bucket_idx];
+    if (count) {
+      uint64 min_us = bucket_idx ? (1ull << (bucket_idx - 1)) : 0;
+      uint64 max_us = 1ull << bucket_idx;
+      if (bucket_idx == PACER_HISTOGRAM_BUCKET_COUNT - 1) {
+        length += snprintf(buffer + length, buffer_size - length, "  %7llu us and up   %u\n",
+                           (unsigned long long)min_us, count);
+      }
+      else {
+        length += snprintf(buffer + length, buffer_size - length, "  %7llu - %7llu us  %u\n",
+                           (unsigned long long)min_us, (unsigned long long)max_us, count);
+      }
+    }
+  }
+  if (length > buffer_size - 1) {
+    length = buffer_size - 1;
+  }
+  return length;
+}
+
+#define SNAKE_PACER_H
+#endif
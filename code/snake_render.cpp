@@ -0,0 +1,584 @@
+/* Software rasterizing. See snake_render.h.
+ *
+ * Included by snake_game.cpp ahead of everything that draws.
+ */
+
+// Pixels per store FillRectClipped uses on this machine. SSE2 is always there on x64.
+inline int32
+RenderFillWidth() {
+  int32 result = (GetSimdLevel() == SimdLevel_AVX2) ? 8 : 4;
+  return result;
+}
+
+/* Fills row_count rows of count pixels, pitch bytes apart, starting at row. Spans at
+ * least one store wide are written with unaligned stores, the last one backed up to
+ * end exactly on the span's end so there's no scalar tail. It overlaps the store
+ * before it, which is fine since both write the same color.
+ * NOTE: aligning first cost more than it saved on the 16px tiles, up to 7 scalar
+ * stores ahead of a single wide one
+ */
+SIMD_TARGET("avx2") internal void
+FillRows8(uint8 *row, int32 pitch, int32 count, int32 row_count, uint32 color) {
+  __m256i wide_color = _mm256_set1_epi32((int32)color);
+  for (int32 row_idx = 0; row_idx < row_count; ++row_idx) {
+    uint32 *at = (uint32 *)row;
+    uint32 *end = at + count;
+    if (count >= 8) {
+      for (; at + 8 < end; at += 8) {
+        _mm256_storeu_si256((__m256i *)at, wide_color);
+      }
+      _mm256_storeu_si256((__m256i *)(end - 8), wide_color);
+    }
+    else {
+      while (at < end) {
+        *at++ = color;
+      }
+    }
+    row += pitch;
+  }
+}
+
+SIMD_TARGET("sse2") internal void
+FillRows4(uint8 *row, int32 pitch, int32 count, int32 row_count, uint32 color) {
+  __m128i wide_color = _mm_set1_epi32((int32)color);
+  for (int32 row_idx = 0; row_idx < row_count; ++row_idx) {
+    uint32 *at = (uint32 *)row;
+    uint32 *end = at + count;
+    if (count >= 4) {
+      for (; at + 4 < end; at += 4) {
+        _mm_storeu_si128((__m128i *)at, wide_color);
+      }
+      _mm_storeu_si128((__m128i *)(end - 4), wide_color);
+    }
+    else {
+      while (at < end) {
+        *at++ = color;
+      }
+    }
+    row += pitch;
+  }
+}
+
+// Grows the buffer's dirty rect to cover [x_min, x_max) x [y_min, y_max)
+inline void
+MarkBufferDirty(GameOffscreenBuffer *buffer, int32 x_min, int32 y_min, int32 x_max, int32 y_max) {
+  if (buffer->dirty_max_x <= buffer->dirty_min_x || buffer->dirty_max_y <= buffer->dirty_min_y) {
+    buffer->dirty_min_x = x_min;
+    buffer->dirty_min_y = y_min;
+    buffer->dirty_max_x = x_max;
+    buffer->dirty_max_y = y_max;
+  }
+  else {
+    buffer->dirty_min_x = Min(buffer->dirty_min_x, x_min);
+    buffer->dirty_min_y = Min(buffer->dirty_min_y, y_min);
+    buffer->dirty_max_x = Max(buffer->dirty_max_x, x_max);
+    buffer->dirty_max_y = Max(buffer->dirty_max_y, y_max);
+  }
+}
+
+inline RenderClip
+WholeBufferClip(GameOffscreenBuffer *buffer) {
+  RenderClip result = {0, 0, buffer->width, buffer->height};
+  return result;
+}
+
+/* Fills the rectangle at (x, y), clipped to clip, which has to be inside the buffer.
+ * Anything partly or entirely outside it is fine. Returns how many pixels were written.
+ */
+inline uint64
+FillRectClipped(GameOffscreenBuffer *buffer, RenderClip clip, uint32 color,
+                int32 x, int32 y, int32 width, int32 height) {
+  Assert(buffer->bytes_per_pixel == sizeof(uint32));
+  int32 x_min = Max(x, clip.min_x);
+  int32 y_min = Max(y, clip.min_y);
+  int32 x_max = Min(x + width, clip.max_x);
+  int32 y_max = Min(y + height, clip.max_y);
+
+  uint64 result = 0;
+  if (x_min < x_max && y_min < y_max) {
+    int32 count = x_max - x_min;
+    uint8 *row = (uint8 *)buffer->memory + (y_min * buffer->pitch) + (x_min * sizeof(uint32));
+    if (RenderFillWidth() == 8) {
+      FillRows8(row, buffer->pitch, count, y_max - y_min, color);
+    }
+    else {
+      FillRows4(row, buffer->pitch, count, y_max - y_min, color);
+    }
+    MarkBufferDirty(buffer, x_min, y_min, x_max, y_max);
+    result = (uint64)count * (uint64)(y_max - y_min);
+  }
+  return result;
+}
+
+// FillRectClipped to the whole buffer
+inline uint64
+FillRect(GameOffscreenBuffer *buffer, uint32 color, int32 x, int32 y, int32 width, int32 height) {
+  uint64 result = FillRectClipped(buffer, WholeBufferClip(buffer), color, x, y, width, height);
+  return result;
+}
+
+// Copies a width x height block of pixels to (x, y), clipped to clip
+internal uint64
+BlitBitmap(GameOffscreenBuffer *buffer, RenderClip clip, uint32 *pixels, int32 pitch,
+           int32 x, int32 y, int32 width, int32 height) {
+  Assert(buffer->bytes_per_pixel == sizeof(uint32));
+  int32 x_min = Max(x, clip.min_x);
+  int32 y_min = Max(y, clip.min_y);
+  int32 x_max = Min(x + width, clip.max_x);
+  int32 y_max = Min(y + height, clip.max_y);
+
+  uint64 result = 0;
+  if (x_min < x_max && y_min < y_max) {
+    int32 count = x_max - x_min;
+    uint8 *source_row = (uint8 *)pixels + ((y_min - y) * pitch) + ((x_min - x) * sizeof(uint32));
+    uint8 *dest_row = (uint8 *)buffer->memory + (y_min * buffer->pitch) + (x_min * sizeof(uint32));
+    for (int32 row_y = y_min; row_y < y_max; ++row_y) {
+      uint32 *source = (uint32 *)source_row;
+      uint32 *dest = (uint32 *)dest_row;
+      for (int32 pixel_idx = 0; pixel_idx < count; ++pixel_idx) {
+        *dest++ = *source++;
+      }
+      source_row += pitch;
+      dest_row += buffer->pitch;
+    }
+    MarkBufferDirty(buffer, x_min, y_min, x_max, y_max);
+    result = (uint64)count * (uint64)(y_max - y_min);
+  }
+  return result;
+}
+
+// ' ' through 'Z'. Five rows of three bits, the top row in the high bits and the left
+// pixel in each row's high bit.
+global_variable uint16 render_font_glyphs[] = {
+  0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x52A5, 0x0000, 0x0000,
+  0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x01C0, 0x0002, 0x12A4,
+  0x7B6F, 0x2C97, 0x73E7, 0x73CF, 0x5BC9, 0x79CF, 0x79EF, 0x7249,
+  0x7BEF, 0x7BCF, 0x0410, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  0x0000, 0x2BED, 0x6BAE, 0x3923, 0x6B6E, 0x79A7, 0x79A4, 0x396B,
+  0x5BED, 0x7497, 0x126A, 0x5BAD, 0x4927, 0x5FED, 0x6B6D, 0x2B6A,
+  0x6BA4, 0x2B73, 0x6BAD, 0x388E, 0x7492, 0x5B6F, 0x5B6A, 0x5BFD,
+  0x5AAD, 0x5A92, 0x72A7,
+};
+
+inline uint32
+GetFontGlyph(char c) {
+  if (c >= 'a' && c <= 'z') {
+    c -= 'a' - 'A';
+  }
+  uint32 result = 0;
+  if (c >= ' ' && c <= 'Z') {
+    result = render_font_glyphs[c - ' '];
+  }
+  return result;
+}
+
+/* Draws text with its top left at (x, y), clipped to clip. Goes a pixel row at a time,
+ * storing the lit font pixels of every glyph on it straight into the buffer, since runs
+ * are only a few pixels long. The dirty rect only grows once for the whole line. Returns
+ * how many pixels were written.
+ */
+internal uint64
+DrawRenderText(GameOffscreenBuffer *buffer, RenderClip clip, uint32 color,
+               int32 x, int32 y, int32 scale, char *text) {
+  Assert(buffer->bytes_per_pixel == sizeof(uint32));
+  int32 advance = RENDER_FONT_ADVANCE * scale;
+  int32 length = 0;
+  while (text[length]) {
+    ++length;
+  }
+  int32 x_min = Max(x, clip.min_x);
+  int32 y_min = Max(y, clip.min_y);
+  int32 x_max = Min(x + length * advance, clip.max_x);
+  int32 y_max = Min(y + RENDER_FONT_HEIGHT * scale, clip.max_y);
+
+  uint64 result = 0;
+  if (x_min < x_max && y_min < y_max) {
+    // NOTE: only the glyphs that reach into the clip
+    int32 first_char = (x_min - x) / advance;
+    int32 end_char = Min(length, (x_max - x + advance - 1) / advance);
+    uint32 glyphs[RENDER_TEXT_CAPACITY];
+    for (int32 char_idx = first_char; char_idx < end_char; ++char_idx) {
+      glyphs[char_idx - first_char] = GetFontGlyph(text[char_idx]);
+    }
+
+    uint8 *row = (uint8 *)buffer->memory + (y_min * buffer->pitch);
+    for (int32 row_y = y_min; row_y < y_max; ++row_y) {
+      int32 glyph_row = (row_y - y) / scale;
+      int32 row_shift = RENDER_FONT_WIDTH * (RENDER_FONT_HEIGHT - 1 - glyph_row);
+      uint32 *pixels = (uint32 *)row;
+      for (int32 char_idx = first_char; char_idx < end_char; ++char_idx) {
+        uint32 row_bits = (glyphs[char_idx - first_char] >> row_shift) & 7;
+        int32 pixel_x = x + char_idx * advance;
+        for (int32 column = 0; row_bits; ++column, row_bits = (row_bits << 1) & 7, pixel_x += scale) {
+          if (row_bits & 4) {
+            int32 run_x_min = Max(pixel_x, x_min);
+            int32 run_x_max = Min(pixel_x + scale, x_max);
+            for (int32 run_x = run_x_min; run_x < run_x_max; ++run_x) {
+              pixels[run_x] = color;
+            }
+            result += (uint64)Max(0, run_x_max - run_x_min);
+          }
+        }
+      }
+      row += buffer->pitch;
+    }
+    if (result) {
+      MarkBufferDirty(buffer, x_min, y_min, x_max, y_max);
+    }
+  }
+  return result;
+}
+
+// ---------------------------------------------------------------------------------------
+// Render groups
+// ---------------------------------------------------------------------------------------
+
+/* Sets up a group that draws into output with tiles_x * tiles_y tiles of tile_size pixels
+ * showing. Takes everything left in arena, so put it in a TemporaryMemory. The coverage map
+ * gets up to half of it and the commands get the rest.
+ */
+internal RenderGroup *
+AllocateRenderGroup(MemoryArena *arena, GameOffscreenBuffer *output,
+                    int32 tile_size, int32 tiles_x, int32 tiles_y) {
+  Assert(tiles_x <= 0x7FFF && tiles_y <= 0x7FFF);
+  RenderGroup *result = PushStruct(arena, RenderGroup);
+  *result = {};
+  result->output = output;
+  result->tile_size = tile_size;
+  result->tiles_x = tiles_x;
+  result->tiles_y = tiles_y;
+
+  size_t coverage_size = (size_t)tiles_x * (size_t)tiles_y * sizeof(uint32);
+  if (coverage_size <= GetArenaSizeRemaining(arena) / 2) {
+    result->coverage = (uint32 *)PushSize(arena, coverage_size);
+  }
+
+  size_t push_size = Min(GetArenaSizeRemaining(arena), (size_t)0xFFFFFFF0) & ~7ull;
+  Assert(push_size >= 256);
+  result->push_base = (uint8 *)PushSize(arena, push_size);
+  result->max_push_size = (uint32)push_size;
+  return result;
+}
+
+// A run of same colored tiles along a row waiting to be filled
+struct RenderSpan {
+  bool32 active;
+  uint32 color;
+  int32 tile_y;
+  int32 tile_x_min;
+  int32 tile_x_max; // one past the end
+};
+
+inline void
+FlushRenderSpan(RenderGroup *group, GameOffscreenBuffer *output, RenderClip clip,
+                RenderStats *stats, RenderSpan *span) {
+  if (span->active) {
+    int32 tile_size = group->tile_size;
+    stats->pixels += FillRectClipped(output, clip, span->color,
+                                     span->tile_x_min * tile_size, span->tile_y * tile_size,
+                                     (span->tile_x_max - span->tile_x_min) * tile_size, tile_size);
+    ++stats->fills;
+    span->active = false;
+  }
+}
+
+/* Draws the part of everything pushed so far that falls inside clip, in order. Tiles that
+ * a later tile entry covers are skipped, and tiles that continue the current run (same
+ * row, next column, same color) are merged into it, also across entries. Anything else
+ * ends the run first so draws still land in the order they were pushed.
+ *
+ * Only reads the group, so several of these can run at once on clips that don't overlap.
+ * Each tile that gets culled is counted by the clip holding its top left pixel.
+ */
+internal void
+RenderGroupToClip(RenderGroup *group, GameOffscreenBuffer *output, RenderClip clip, RenderStats *stats) {
+  int32 tile_size = group->tile_size;
+  RenderSpan span = {};
+  if (clip.min_x >= clip.max_x || clip.min_y >= clip.max_y) {
+    return;
+  }
+
+  // The columns of tiles that reach into the clip
+  int32 clip_tile_x_min = clip.min_x / tile_size;
+  int32 clip_tile_x_max = (clip.max_x - 1) / tile_size + 1;
+
+  uint8 *at = group->push_base;
+  uint8 *end = group->push_base + group->push_size;
+  while (at < end) {
+    RenderEntryHeader *header = (RenderEntryHeader *)at;
+    void *data = header + 1;
+    switch (header->type) {
+      case RenderEntryType_RenderEntryTile: {
+        RenderEntryTile *entry = (RenderEntryTile *)data;
+        int32 y_pixel = entry->tile_y * tile_size;
+        if (y_pixel + tile_size <= clip.min_y || y_pixel >= clip.max_y) {
+          break;
+        }
+        bool32 owns_row = (y_pixel >= clip.min_y);
+
+        uint32 offset = (uint32)(at - group->push_base);
+        uint32 *coverage = 0;
+        if (group->coverage) {
+          coverage = group->coverage + (entry->tile_y * group->tiles_x + entry->tile_x);
+        }
+        int32 first_tile = Max(0, clip_tile_x_min - entry->tile_x);
+        int32 end_tile = Min(entry->tile_count, clip_tile_x_max - entry->tile_x);
+        for (int32 tile_idx = first_tile; tile_idx < end_tile; ++tile_idx) {
+          int32 tile_x = entry->tile_x + tile_idx;
+          if (coverage && coverage[tile_idx] != offset) {
+            if (owns_row && tile_x * tile_size >= clip.min_x) {
+              ++stats->culled;
+            }
+          }
+          else if (span.active && span.color == entry->color &&
+                   span.tile_y == entry->tile_y && span.tile_x_max == tile_x) {
+            ++span.tile_x_max;
+          }
+          else {
+            FlushRenderSpan(group, output, clip, stats, &span);
+            span.active = true;
+            span.color = entry->color;
+            span.tile_y = entry->tile_y;
+            span.tile_x_min = tile_x;
+            span.tile_x_max = tile_x + 1;
+          }
+        }
+      } break;
+
+      case RenderEntryType_RenderEntryRect: {
+        RenderEntryRect *entry = (RenderEntryRect *)data;
+        FlushRenderSpan(group, output, clip, stats, &span);
+        stats->pixels += FillRectClipped(output, clip, entry->color, entry->x, entry->y, entry->width, entry->height);
+        ++stats->fills;
+      } break;
+
+      case RenderEntryType_RenderEntryClear: {
+        RenderEntryClear *entry = (RenderEntryClear *)data;
+        FlushRenderSpan(group, output, clip, stats, &span);
+        stats->pixels += FillRectClipped(output, clip, entry->color, 0, 0, output->width, output->height);
+        ++stats->fills;
+      } break;
+
+      case RenderEntryType_RenderEntryBitmap: {
+        RenderEntryBitmap *entry = (RenderEntryBitmap *)data;
+        FlushRenderSpan(group, output, clip, stats, &span);
+        stats->pixels += BlitBitmap(output, clip, entry->pixels, entry->pitch,
+                                    entry->x, entry->y, entry->width, entry->height);
+        ++stats->fills;
+      } break;
+
+      case RenderEntryType_RenderEntryText: {
+        RenderEntryText *entry = (RenderEntryText *)data;
+        FlushRenderSpan(group, output, clip, stats, &span);
+        stats->pixels += DrawRenderText(output, clip, entry->color, entry->x, entry->y, entry->scale, entry->text);
+        ++stats->fills;
+      } break;
+
+      default: {
+        Assert(!"unknown render entry type");
+      } break;
+    }
+    at += header->size;
+  }
+  FlushRenderSpan(group, output, clip, stats, &span);
+}
+
+inline void
+EmptyRenderGroup(RenderGroup *group) {
+  group->push_size = 0;
+  group->last_tile = 0;
+}
+
+// Draws everything pushed so far on this thread and empties the group
+internal void
+RenderGroupToOutput(RenderGroup *group) {
+  TIMED_BLOCK(RenderGroupToOutput);
+  uint64 start_cycles = __rdtsc();
+  RenderGroupToClip(group, group->output, WholeBufferClip(group->output), &group->stats);
+  EmptyRenderGroup(group);
+  group->stats.cycles += __rdtsc() - start_cycles;
+}
+
+/* Makes room for an entry of the given type and returns it. When the group is full it's
+ * drawn out and emptied first, so pushing never fails.
+ */
+internal void *
+PushRenderEntry_(RenderGroup *group, uint32 type, uint32 size) {
+  uint32 entry_size = (uint32)((sizeof(RenderEntryHeader) + size + 7) & ~7ull);
+  if (group->push_size + entry_size > group->max_push_size) {
+    RenderGroupToOutput(group);
+  }
+  Assert(group->push_size + entry_size <= group->max_push_size);
+
+  RenderEntryHeader *header = (RenderEntryHeader *)(group->push_base + group->push_size);
+  header->type = type;
+  header->size = entry_size;
+  group->push_size += entry_size;
+  group->last_tile = 0;
+  ++group->stats.commands;
+  return header + 1;
+}
+
+#define PushRenderEntry(group, type) (type *)PushRenderEntry_(group, RenderEntryType_##type, sizeof(type))
+
+inline void
+PushClear(RenderGroup *group, uint32 color) {
+  RenderEntryClear *entry = PushRenderEntry(group, RenderEntryClear);
+  entry->color = color;
+}
+
+inline void
+PushRect(RenderGroup *group, uint32 color, int32 x, int32 y, int32 width, int32 height) {
+  RenderEntryRect *entry = PushRenderEntry(group, RenderEntryRect);
+  entry->color = color;
+  entry->x = x;
+  entry->y = y;
+  entry->width = width;
+  entry->height = height;
+}
+
+/* Tiles outside the visible ones are dropped here. A tile that carries on from the last
+ * one pushed (same row, next column, same color) just makes that entry longer, which is
+ * how a row of the grid ends up as one entry.
+ */
+inline void
+PushTile(RenderGroup *group, uint32 color, int32 tile_x, int32 tile_y) {
+  if (tile_x >= 0 && tile_y >= 0 && tile_x < group->tiles_x && tile_y < group->tiles_y) {
+    RenderEntryTile *last = group->last_tile;
+    if (last && last->color == color && last->tile_y == tile_y &&
+        last->tile_x + last->tile_count == tile_x) {
+      ++last->tile_count;
+      ++group->stats.commands;
+    }
+    else {
+      last = PushRenderEntry(group, RenderEntryTile);
+      last->color = color;
+      last->tile_x = (int16)tile_x;
+      last->tile_y = (int16)tile_y;
+      last->tile_count = 1;
+      group->last_tile = last;
+      // NOTE: taken after the push since it may have flushed the group
+      group->last_tile_offset = (uint32)(((uint8 *)last - sizeof(RenderEntryHeader)) - group->push_base);
+    }
+    if (group->coverage) {
+      group->coverage[tile_y * group->tiles_x + tile_x] = group->last_tile_offset;
+    }
+  }
+}
+
+inline void
+PushBitmap(RenderGroup *group, uint32 *pixels, int32 pitch, int32 x, int32 y, int32 width, int32 height) {
+  RenderEntryBitmap *entry = PushRenderEntry(group, RenderEntryBitmap);
+  entry->pixels = pixels;
+  entry->pitch = pitch;
+  entry->x = x;
+  entry->y = y;
+  entry->width = width;
+  entry->height = height;
+}
+
+// Text longer than RENDER_TEXT_CAPACITY - 1 is cut off
+inline void
+PushText(RenderGroup *group, uint32 color, int32 x, int32 y, int32 scale, char *text) {
+  RenderEntryText *entry = PushRenderEntry(group, RenderEntryText);
+  entry->color = color;
+  entry->x = x;
+  entry->y = y;
+  entry->scale = scale;
+  int32 length = 0;
+  for (; text[length] && length < RENDER_TEXT_CAPACITY - 1; ++length) {
+    entry->text[length] = text[length];
+  }
+  entry->text[length] = 0;
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(DoRenderJob) {
+  TIMED_BLOCK_THREADED(RenderJob);
+  RenderJob *job = (RenderJob *)data;
+  RenderGroupToClip(job->group, &job->output, job->clip, &job->stats);
+}
+
+/* RenderGroupToOutput spread over the queue's threads. The buffer is cut into
+ * RENDER_JOB_COUNT_X * RENDER_JOB_COUNT_Y rectangles and each one draws the whole group
+ * clipped to its own. Jobs draw into copies of the buffer's header so their dirty rects
+ * don't collide, and the rects and stats are folded back in once they're all done. Every
+ * pixel still ends up written by the same commands in the same order, so the frame is
+ * identical to a single threaded one.
+ */
+internal void
+TiledRenderGroupToOutput(PlatformWorkQueue *queue, platform_add_entry *PlatformAddEntry,
+                         platform_complete_all_work *PlatformCompleteAllWork, RenderGroup *group) {
+  uint64 start_cycles = __rdtsc();
+  GameOffscreenBuffer *output = group->output;
+
+  // NOTE: columns are a multiple of 16 pixels wide so that, with rows starting on a cache
+  // line, neighbouring jobs never write to the same line
+  int32 column_width = (output->width + RENDER_JOB_COUNT_X - 1) / RENDER_JOB_COUNT_X;
+  column_width = (column_width + 15) & ~15;
+  int32 row_height = (output->height + RENDER_JOB_COUNT_Y - 1) / RENDER_JOB_COUNT_Y;
+
+  RenderJob jobs[RENDER_JOB_COUNT_X * RENDER_JOB_COUNT_Y];
+  int32 job_count = 0;
+  for (int32 row = 0; row < RENDER_JOB_COUNT_Y; ++row) {
+    for (int32 column = 0; column < RENDER_JOB_COUNT_X; ++column) {
+      RenderJob *job = &jobs[job_count++];
+      job->group = group;
+      job->output = *output;
+      job->output.dirty_min_x = job->output.dirty_max_x = 0;
+      job->output.dirty_min_y = job->output.dirty_max_y = 0;
+      job->clip.min_x = Min(column * column_width, output->width);
+      job->clip.min_y = Min(row * row_height, output->height);
+      job->clip.max_x = Min(job->clip.min_x + column_width, output->width);
+      job->clip.max_y = Min(job->clip.min_y + row_height, output->height);
+      job->stats = {};
+      PlatformAddEntry(queue, DoRenderJob, job);
+    }
+  }
+  PlatformCompleteAllWork(queue);
+
+  for (int32 job_idx = 0; job_idx < job_count; ++job_idx) {
+    RenderJob *job = &jobs[job_idx];
+    if (job->output.dirty_min_x < job->output.dirty_max_x &&
+        job->output.dirty_min_y < job->output.dirty_max_y) {
+      MarkBufferDirty(output, job->output.dirty_min_x, job->output.dirty_min_y,
+                      job->output.dirty_max_x, job->output.dirty_max_y);
+    }
+    group->stats.culled += job->stats.culled;
+    group->stats.fills += job->stats.fills;
+    group->stats.pixels += job->stats.pixels;
+  }
+
+  EmptyRenderGroup(group);
+  group->stats.cycles += __rdtsc() - start_cycles;
+}
+
+// ---------------------------------------------------------------------------------------
+// Dirty tiles
+// ---------------------------------------------------------------------------------------
+
+/* Gives the dirty tile list room for a quarter of the board, past which repainting
+ * everything is about as cheap. Called from InitializeGame once the rewind ring has its
+ * share of temp storage. Takes at most an eighth of what's left so the frame arena keeps
+ * the rest.
+ */
+internal void
+InitializeDirtyTiles(GameState *state) {
+  DirtyTiles *dirty = &state->dirty_tiles;
+  size_t room = GetArenaSizeRemaining(&state->transient_arena, 16) / (8 * sizeof(int32));
+  dirty->capacity = (int32)Min((size_t)(state->board_tile_count / 4 + 64), room);
+  dirty->tiles = PushArray(&state->transient_arena, dirty->capacity, int32);
+  dirty->count = 0;
+  dirty->full_repaint = true;
+}
+
+inline void
+MarkTileDirty(DirtyTiles *dirty, int32 tile_idx) {
+  if (!dirty->full_repaint) {
+    if (dirty->count < dirty->capacity) {
+      dirty->tiles[dirty->count++] = tile_idx;
+    }
+    else {
+      dirty->full_repaint = true;
+    }
+  }
+}
@@ -0,0 +1,173 @@
+#if !defined(SNAKE_RENDER_H)
+
+/* Software rasterizing into the GameOffscreenBuffer.
+ *
+ * The game doesn't draw directly. It pushes commands (clear, rect, tile, bitmap, text) into a
+ * RenderGroup on the frame arena and RenderGroupToOutput carries them out at the end of
+ * the frame. Each screen tile remembers the last tile command that covered it, so tiles
+ * drawn over later are skipped, and runs of same colored tiles along a row are merged
+ * into a single fill. So RenderGrid can push every tile and the snake can be pushed on
+ * top without paying for the pixels twice. RenderStats counts what a frame took.
+ *
+ * When the platform gives us a work queue, full repaints are drawn by its threads. The
+ * buffer is cut into rectangles and each thread draws the whole group clipped to its own,
+ * so nothing is shared but the pixels' memory and the result is the same as drawing it on
+ * one thread.
+ *
+ * Apart from bitmaps and text everything ends up as a solid rectangle, so FillRect is the
+ * main primitive. It clips the rectangle to the buffer once and then fills it a row at a
+ * time, which keeps the stores walking through memory in order. Each row is written 8
+ * pixels per store with AVX2 or 4 with SSE2 (see RenderFillWidth) once the pointer is
+ * aligned, with single pixel stores on either end. FillRect also grows the buffer's dirty rect so the platform only
+ * has to blit what was drawn.
+ *
+ * Frames are drawn over the last one rather than from scratch. OccupyTile and VacateTile
+ * add every tile they change to a DirtyTiles list, and RenderGame repaints just those plus
+ * the tiles the snake's moving ends are sliding through. A tick only changes a handful of
+ * tiles, so a frame costs about the same on any size of board. The whole board is
+ * repainted when the list overflows, after anything that rewrites the board wholesale
+ * (a reset, a rewind step, loading a keyframe) or when the buffer might not hold the last
+ * frame anymore.
+ */
+
+#if !defined(_MSC_VER)
+#include <x86intrin.h> // __rdtsc
+#endif
+
+enum RenderEntryType {
+  RenderEntryType_RenderEntryClear,
+  RenderEntryType_RenderEntryRect,
+  RenderEntryType_RenderEntryTile,
+  RenderEntryType_RenderEntryBitmap,
+  RenderEntryType_RenderEntryText,
+};
+
+// Every entry starts with this, followed by the entry for its type. Sizes are rounded up
+// to 8 bytes so the bitmap's pointer stays aligned.
+struct RenderEntryHeader {
+  uint32 type;
+  uint32 size; // including the header
+};
+
+struct RenderEntryClear {
+  uint32 color;
+};
+
+struct RenderEntryRect {
+  uint32 color;
+  int32 x;
+  int32 y;
+  int32 width;
+  int32 height;
+};
+
+// A row of whole tiles, in screen tiles from the top left. Most of a frame is these.
+// PushTile grows the last one instead of adding another when it can.
+struct RenderEntryTile {
+  uint32 color;
+  int16 tile_x;
+  int16 tile_y;
+  int32 tile_count;
+};
+
+// An opaque copy. The pixels have to live until the group is drawn.
+struct RenderEntryBitmap {
+  uint32 *pixels;
+  int32 pitch; // in bytes
+  int32 x;
+  int32 y;
+  int32 width;
+  int32 height;
+};
+
+// The built in font's glyphs are 3x5 font pixels, a font pixel apart
+#define RENDER_FONT_WIDTH 3
+#define RENDER_FONT_HEIGHT 5
+#define RENDER_FONT_ADVANCE (RENDER_FONT_WIDTH + 1)
+#define RENDER_TEXT_CAPACITY 64 // including the terminator
+
+// A line of text in the built in font, scale pixels to a font pixel. Lower case letters
+// come out in upper case and anything the font doesn't have comes out blank.
+struct RenderEntryText {
+  uint32 color;
+  int32 x;
+  int32 y;
+  int32 scale;
+  char text[RENDER_TEXT_CAPACITY];
+};
+
+struct RenderStats {
+  uint32 commands; // pushed, counting every tile
+  uint32 culled; // tiles skipped since a later tile covers them
+  uint32 fills; // what the rest came down to once tile runs were merged
+  uint32 dropped; // pushes that didn't fit
+  uint64 pixels;
+  uint64 cycles; // on the thread that drew the group, waiting for the others included
+};
+
+struct RenderGroup {
+  GameOffscreenBuffer *output; // where the commands end up, also when the group fills up
+
+  uint8 *push_base;
+  uint32 push_size;
+  uint32 max_push_size;
+
+  // How tile entries land on screen
+  int32 tile_size;
+  int32 tiles_x;
+  int32 tiles_y;
+
+  // The offset of the last tile entry pushed for each screen tile. Null when there wasn't
+  // room for it, which just means nothing gets culled. Entries only ever look at their own
+  // tiles' slots, which they wrote, so it never needs clearing.
+  uint32 *coverage;
+
+  // The newest entry when it's a tile entry, so the next tile can extend it
+  RenderEntryTile *last_tile;
+  uint32 last_tile_offset;
+
+  RenderStats stats;
+};
+
+// [min, max) in pixels
+struct RenderClip {
+  int32 min_x;
+  int32 min_y;
+  int32 max_x;
+  int32 max_y;
+};
+
+// How many pieces TiledRenderGroupToOutput cuts the buffer into
+#define RENDER_JOB_COUNT_X 4
+#define RENDER_JOB_COUNT_Y 4
+
+struct RenderJob {
+  RenderGroup *group;
+  GameOffscreenBuffer output; // a copy of the real one, for its own dirty rect
+  RenderClip clip;
+  RenderStats stats;
+};
+
+// The head, the tile it came from and the tile the tail left
+#define DIRTY_MAX_MOVING_TILES 3
+
+struct DirtyTiles {
+  int32 *tiles; // board tile indices, in temp storage
+  int32 count;
+  int32 capacity;
+  bool32 full_repaint;
+
+  // Tiles that were drawn part way through a move last frame
+  int32 moving_count;
+  int32 moving_tiles[DIRTY_MAX_MOVING_TILES];
+
+  // What the last frame was drawn into and with. Anything different needs a full repaint.
+  void *painted_memory;
+  int32 painted_width;
+  int32 painted_height;
+  int32 painted_pitch;
+  bool32 painted_alive;
+};
+
+#define SNAKE_RENDER_H
+#endif
@@ -0,0 +1,564 @@
+#if !defined(SNAKE_REPLAY_H)
+
+/* Replay files
+ *
+ * A replay always starts from a freshly initialized game. The header carries everything
+ * InitializeGame looks at: the rng seed and stream, the config, and the backbuffer size
+ * the board was fitted to. After the header comes one record per frame holding the
+ * GameInput the game saw that frame, dt included.
+ *
+ * The sim only advances in whole ticks worked out from those dts, and all of its state
+ * (rng included) lives in GameState. So feeding the same frames to UpdateGame reproduces
+ * the game bit for bit, with or without a window and at any speed.
+ *
+ * Each frame also carries the low 32 bits of GameStateHash after every tick the frame ran,
+ * so a player can tell the first tick where its game stops matching the recorded one
+ * instead of only noticing at the end that the score is off.
+ *
+ * Inputs barely change between frames, so each frame is stored as a delta against the one
+ * before it (see ReplayEncodeDelta). An unchanged frame costs a single byte instead of a
+ * whole GameInput.
+ *
+ * Every REPLAY_KEYFRAME_INTERVAL frames a keyframe of the game's permanent storage is
+ * written just before the frame (the recorder appends it after the frame before, which is
+ * the same place in the file). Keyframes are deltas against the previous keyframe, with
+ * a full one every REPLAY_FULL_KEYFRAME_EVERY. An index of them follows the last frame so
+ * a player can seek to any tick by loading the keyframe before it and playing at most one
+ * interval of frames. Keyframes hold pointers into game memory, so they can only be
+ * loaded when the storage sits at the same address it was recorded at. Otherwise the
+ * player falls back to playing from the start.
+ *
+ * File layout:
+ *   ReplayHeader
+ *   per frame: [keyframe: uint32 encoded size, delta] input delta,
+ *              varint tick count, uint32 hash per tick
+ *   ReplayKeyframe index, keyframe_count entries
+ */
+
+#include <string.h> // memcpy
+
+#define REPLAY_MAGIC 0x524B4E53 // "SNKR"
+#define REPLAY_VERSION 3
+
+#define REPLAY_KEYFRAME_INTERVAL 600
+#define REPLAY_FULL_KEYFRAME_EVERY 16
+
+// Equal bytes it takes to end a delta run. Shorter gaps are cheaper to store as literals.
+#define REPLAY_DELTA_MIN_GAP 4
+
+struct ReplayHeader {
+  uint32 magic;
+  uint32 version;
+  uint32 input_size; // sizeof(GameInput) when recorded
+  uint32 frame_count;
+
+  uint64 rand_seed;
+  uint64 rand_rounds;
+  GameConfig config;
+  int32 screen_width;
+  int32 screen_height;
+  int32 sim_ticks_per_second;
+
+  // Keyframes only load at the addresses they were taken at
+  uint64 permanent_storage_base;
+  uint64 temp_storage_base;
+  uint32 keyframe_interval; // in frames
+  uint32 keyframe_count;
+  uint64 keyframe_index_offset;
+
+  uint64 start_sim_tick;
+  uint64 end_sim_tick;
+  int32 end_score;
+  int32 end_length;
+  int32 board_width; // in tiles, not counting the wall
+  int32 board_height;
+};
+
+struct ReplayKeyframe {
+  uint32 frame_idx; // the state just before this frame's input
+  uint32 state_size;
+  uint64 sim_tick;
+  uint64 file_offset; // of the uint32 encoded size
+  bool32 is_full;
+  uint32 pad;
+};
+
+struct ReplayWriter {
+  ReplayHeader header;
+  GameInput last_input;
+  uint64 file_offset; // where the next chunk goes
+
+  // Provided by the platform. The chunk needs ReplayChunkSize(max_keyframe_size) bytes.
+  uint8 *last_keyframe;
+  uint32 last_keyframe_size;
+  uint32 max_keyframe_size;
+  uint8 *chunk;
+  ReplayKeyframe *keyframes;
+  uint32 max_keyframes;
+};
+
+struct ReplayReader {
+  ReplayHeader header;
+  uint8 *data;
+  uint64 size;
+  ReplayKeyframe *keyframes;
+
+  uint8 *at;
+  uint32 frame_idx;
+  uint32 next_keyframe_idx;
+  GameInput last_input;
+
+  // The recorded hashes of the ticks the last frame ran
+  int32 tick_hash_count;
+  uint32 tick_hashes[SIM_MAX_TICKS_PER_FRAME];
+};
+
+// ---------------------------------------------------------------------------------------
+// Deltas
+// ---------------------------------------------------------------------------------------
+
+inline uint8 *
+ReplayPutVarint(uint8 *out, uint64 value) {
+  while (value >= 0x80) {
+    *out++ = (uint8)(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = (uint8)value;
+  return out;
+}
+
+// Returns 0 when the varint runs past end
+inline uint8 *
+ReplayGetVarint(uint8 *in, uint8 *end, uint64 *value) {
+  uint64 result = 0;
+  for (int32 shift = 0; in < end && shift < 64; shift += 7) {
+    uint8 byte = *in++;
+    result |= (uint64)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return in;
+    }
+  }
+  return 0;
+}
+
+// NOTE: keyframe bytes and the stream around them have no alignment, so words are read
+// and written through memcpy, which compiles down to a plain load or store
+inline uint64
+ReplayLoadU64(uint8 *source) {
+  uint64 result;
+  memcpy(&result, source, sizeof(result));
+  return result;
+}
+
+inline uint32
+ReplayLoadU32(uint8 *source) {
+  uint32 result;
+  memcpy(&result, source, sizeof(result));
+  return result;
+}
+
+inline void
+ReplayStoreU32(uint8 *dest, uint32 value) {
+  memcpy(dest, &value, sizeof(value));
+}
+
+// Worst case output of ReplayEncodeDelta for size bytes of input
+inline uint64
+ReplayMaxDeltaSize(uint64 size) {
+  uint64 result = size + (size / 1024) + 32;
+  return result;
+}
+
+/* Writes the runs of a delta (see ReplayEncodeDelta) for bytes [begin, end) of cur to out
+ * and returns where they end. written_to is where the last run ended. It can't be past
+ * begin, so ranges have to come in order. Callers that know which bytes changed use this
+ * to skip the rest, and end the delta with ReplayPutVarint(out, 0).
+ */
+internal uint8 *
+ReplayEncodeDeltaRange(uint8 *out, uint8 *prev, uint8 *cur, uint64 begin, uint64 end,
+                       uint64 *written_to) {
+  Assert(*written_to <= begin);
+  uint64 idx = begin;
+  while (idx < end) {
+    // NOTE: most of a keyframe doesn't change so skip equal words first
+    if (prev) {
+      while (idx + 8 <= end && ReplayLoadU64(prev + idx) == ReplayLoadU64(cur + idx)) {
+        idx += 8;
+      }
+      while (idx < end && prev[idx] == cur[idx]) {
+        ++idx;
+      }
+    }
+    else {
+      while (idx + 8 <= end && ReplayLoadU64(cur + idx) == 0) {
+        idx += 8;
+      }
+      while (idx < end && cur[idx] == 0) {
+        ++idx;
+      }
+    }
+    if (idx == end) {
+      break;
+    }
+
+    uint64 run_start = idx;
+    uint64 run_end = idx;
+    for (; idx < end; ++idx) {
+      uint8 prev_byte = prev ? prev[idx] : 0;
+      if (cur[idx] != prev_byte) {
+        run_end = idx + 1;
+      }
+      else if (idx + 1 - run_end >= REPLAY_DELTA_MIN_GAP) {
+        break;
+      }
+    }
+
+    out = ReplayPutVarint(out, run_start - *written_to + 1);
+    out = ReplayPutVarint(out, run_end - run_start);
+    for (uint64 byte_idx = run_start; byte_idx < run_end; ++byte_idx) {
+      *out++ = cur[byte_idx] ^ (prev ? prev[byte_idx] : 0);
+    }
+    *written_to = run_end;
+    idx = run_end;
+  }
+  return out;
+}
+
+/* Writes cur as an XOR delta against prev (or against zeros when prev is 0). The delta is
+ * a list of runs, each a varint count of unchanged bytes to skip plus one, a varint
+ * literal count and that many XORed bytes. A zero skip ends the list, so an unchanged
+ * block is a single byte. Returns the number of bytes written to dest.
+ */
+internal uint64
+ReplayEncodeDelta(uint8 *dest, uint8 *prev, uint8 *cur, uint64 size) {
+  uint64 written_to = 0; // everything before this has been skipped or written
+  uint8 *out = ReplayEncodeDeltaRange(dest, prev, cur, 0, size, &written_to);
+  out = ReplayPutVarint(out, 0);
+
+  uint64 result = (uint64)(out - dest);
+  Assert(result <= ReplayMaxDeltaSize(size));
+  return result;
+}
+
+/* XORs a delta from ReplayEncodeDelta into dest. Returns the first byte after the delta,
+ * or 0 if it's corrupt.
+ */
+internal uint8 *
+ReplayApplyDelta(uint8 *dest, uint64 size, uint8 *in, uint8 *end) {
+  uint64 idx = 0;
+  for (;;) {
+    uint64 skip, count;
+    in = ReplayGetVarint(in, end, &skip);
+    if (!in) {
+      return 0;
+    }
+    if (skip == 0) {
+      return in;
+    }
+    idx += skip - 1;
+    in = ReplayGetVarint(in, end, &count);
+    if (!in || idx + count > size || count > (uint64)(end - in)) {
+      return 0;
+    }
+    for (uint64 byte_idx = 0; byte_idx < count; ++byte_idx) {
+      dest[idx++] ^= *in++;
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Recording
+// ---------------------------------------------------------------------------------------
+
+// Bytes of permanent storage a keyframe has to hold: GameState and the used world arena
+inline uint64
+ReplayGameStateSize(GameMemory *memory) {
+  GameState *state = (GameState *)memory->permanent_storage;
+  uint64 result = (uint64)((state->world_arena.base + state->world_arena.used) -
+                           (uint8 *)memory->permanent_storage);
+  return result;
+}
+
+inline uint64
+ReplayChunkSize(uint32 max_keyframe_size) {
+  uint64 result = sizeof(uint32) + ReplayMaxDeltaSize(max_keyframe_size) +
+                  ReplayMaxDeltaSize(sizeof(GameInput)) +
+                  sizeof(uint32) + SIM_MAX_TICKS_PER_FRAME * sizeof(uint32);
+  return result;
+}
+
+/* Starts a replay of a game that starts now. The caller then clears
+ * memory->is_initialized so the next update starts a fresh game from this seed, and
+ * writes the header at the start of the file. The buffers aren't touched.
+ */
+inline void
+BeginReplay(ReplayWriter *writer, GameMemory *memory, int32 screen_width, int32 screen_height) {
+  ReplayHeader *header = &writer->header;
+  *header = {};
+  header->magic = REPLAY_MAGIC;
+  header->version = REPLAY_VERSION;
+  header->input_size = sizeof(GameInput);
+  header->rand_seed = memory->rand_seed;
+  header->rand_rounds = memory->rand_rounds;
+  header->config = memory->config;
+  header->screen_width = screen_width;
+  header->screen_height = screen_height;
+  header->sim_ticks_per_second = SIM_TICKS_PER_SECOND;
+  header->permanent_storage_base = (uint64)(uintptr_t)memory->permanent_storage;
+  header->temp_storage_base = (uint64)(uintptr_t)memory->temp_storage;
+  header->keyframe_interval = REPLAY_KEYFRAME_INTERVAL;
+  header->start_sim_tick = 0; // InitializeGame starts every game at tick 0
+
+  writer->last_input = {};
+  writer->last_keyframe_size = 0;
+  writer->file_offset = sizeof(*header);
+}
+
+/* Encodes the frame that just ran, the tick hashes it produced, and the keyframe for the
+ * next frame when one is due, into writer->chunk. Call it after handing the input to the
+ * game. Returns the number of bytes to append to the file.
+ */
+internal uint64
+ReplayRecordFrame(ReplayWriter *writer, GameMemory *memory, GameInput *input) {
+  ReplayHeader *header = &writer->header;
+  GameState *state = (GameState *)memory->permanent_storage;
+  uint8 *out = writer->chunk;
+
+  out += ReplayEncodeDelta(out, (uint8 *)&writer->last_input, (uint8 *)input, sizeof(*input));
+  writer->last_input = *input;
+
+  Assert(state->tick_hash_count >= 0 && state->tick_hash_count <= SIM_MAX_TICKS_PER_FRAME);
+  out = ReplayPutVarint(out, (uint64)state->tick_hash_count);
+  for (int32 tick_idx = 0; tick_idx < state->tick_hash_count; ++tick_idx) {
+    ReplayStoreU32(out, (uint32)state->tick_hashes[tick_idx]);
+    out += sizeof(uint32);
+  }
+  ++header->frame_count;
+
+  uint32 frame_idx = header->frame_count;
+  if ((frame_idx % header->keyframe_interval) == 0 &&
+      memory->is_initialized && header->keyframe_count < writer->max_keyframes) {
+    uint64 state_size = ReplayGameStateSize(memory);
+    if (state_size <= writer->max_keyframe_size) {
+      ReplayKeyframe *keyframe = writer->keyframes + header->keyframe_count++;
+      keyframe->frame_idx = frame_idx;
+      keyframe->state_size = (uint32)state_size;
+      keyframe->sim_tick = state->sim_tick;
+      keyframe->file_offset = writer->file_offset + (uint64)(out - writer->chunk);
+      keyframe->is_full = ((header->keyframe_count - 1) % REPLAY_FULL_KEYFRAME_EVERY) == 0 ||
+                          (state_size != writer->last_keyframe_size);
+
+      uint8 *state_bytes = (uint8 *)memory->permanent_storage;
+      uint64 encoded_size = ReplayEncodeDelta(out + sizeof(uint32),
+                                              keyframe->is_full ? 0 : writer->last_keyframe,
+                                              state_bytes, state_size);
+      ReplayStoreU32(out, (uint32)encoded_size);
+      out += sizeof(uint32) + encoded_size;
+
+      for (uint64 byte_idx = 0; byte_idx < state_size; ++byte_idx) {
+        writer->last_keyframe[byte_idx] = state_bytes[byte_idx];
+      }
+      writer->last_keyframe_size = (uint32)state_size;
+
+      // NOTE: the first input after a keyframe is against zeros so playback can start there
+      writer->last_input = {};
+    }
+  }
+
+  uint64 result = (uint64)(out - writer->chunk);
+  writer->file_offset += result;
+  return result;
+}
+
+/* Fills in the end of the header. The caller appends writer->keyframes
+ * (header.keyframe_count of them) and then rewrites the header at the start of the file.
+ */
+inline void
+EndReplay(ReplayWriter *writer, GameMemory *memory) {
+  ReplayHeader *header = &writer->header;
+  GameState *state = (GameState *)memory->permanent_storage;
+  header->end_sim_tick = state->sim_tick;
+  header->end_score = state->score;
+  header->end_length = state->snake.length;
+  header->board_width = state->board_stride - 2;
+  header->board_height = state->board_stride ? (state->board_tile_count / state->board_stride) - 2 : 0;
+  header->keyframe_index_offset = writer->file_offset;
+}
+
+// ---------------------------------------------------------------------------------------
+// Playback
+// ---------------------------------------------------------------------------------------
+
+/* Sets up playback of a whole replay file that's already in memory. Returns false when it
+ * isn't one this build can play.
+ */
+inline bool32
+OpenReplay(ReplayReader *reader, uint8 *data, uint64 size) {
+  *reader = {};
+  if (size < sizeof(ReplayHeader)) {
+    return false;
+  }
+  reader->header = *(ReplayHeader *)data;
+  ReplayHeader *header = &reader->header;
+  bool32 result = (header->magic == REPLAY_MAGIC &&
+                   header->version == REPLAY_VERSION &&
+                   header->input_size == sizeof(GameInput) &&
+                   header->keyframe_index_offset <= size &&
+                   header->keyframe_count <= (size - header->keyframe_index_offset) / sizeof(ReplayKeyframe));
+  if (result) {
+    reader->data = data;
+    reader->size = size;
+    reader->keyframes = (ReplayKeyframe *)(data + header->keyframe_index_offset);
+    reader->at = data + sizeof(ReplayHeader);
+  }
+  return result;
+}
+
+/* Decodes the next frame's input. Returns false at the end of the replay or when the
+ * file is corrupt.
+ */
+internal bool32
+ReplayNextFrame(ReplayReader *reader, GameInput *input) {
+  uint8 *end = reader->data + reader->header.keyframe_index_offset;
+  if (reader->frame_idx >= reader->header.frame_count) {
+    return false;
+  }
+
+  // Sequential playback doesn't need keyframes so hop over them
+  if (reader->next_keyframe_idx < reader->header.keyframe_count &&
+      reader->keyframes[reader->next_keyframe_idx].frame_idx == reader->frame_idx) {
+    if ((uint64)(end - reader->at) < sizeof(uint32)) {
+      return false;
+    }
+    uint32 encoded_size = ReplayLoadU32(reader->at);
+    if (encoded_size > (uint64)(end - reader->at) - sizeof(uint32)) {
+      return false;
+    }
+    reader->at += sizeof(uint32) + encoded_size;
+    reader->last_input = {};
+    ++reader->next_keyframe_idx;
+  }
+
+  reader->at = ReplayApplyDelta((uint8 *)&reader->last_input, sizeof(GameInput), reader->at, end);
+  if (!reader->at) {
+    return false;
+  }
+
+  uint64 tick_hash_count;
+  reader->at = ReplayGetVarint(reader->at, end, &tick_hash_count);
+  if (!reader->at || tick_hash_count > SIM_MAX_TICKS_PER_FRAME ||
+      tick_hash_count * sizeof(uint32) > (uint64)(end - reader->at)) {
+    return false;
+  }
+  reader->tick_hash_count = (int32)tick_hash_count;
+  for (int32 tick_idx = 0; tick_idx < reader->tick_hash_count; ++tick_idx) {
+    reader->tick_hashes[tick_idx] = ReplayLoadU32(reader->at);
+    reader->at += sizeof(uint32);
+  }
+
+  *input = reader->last_input;
+  ++reader->frame_idx;
+  return true;
+}
+
+/* Compares the ticks the game just ran with the ones recorded for the frame ReplayNextFrame
+ * last returned. Returns false at the first tick that doesn't match and puts its sim_tick
+ * in divergent_tick.
+ */
+internal bool32
+ReplayCheckTickHashes(ReplayReader *reader, GameState *state, uint64 *divergent_tick) {
+  uint64 first_tick = state->sim_tick - (uint64)state->tick_hash_count + 1;
+  int32 tick_count = Min(reader->tick_hash_count, state->tick_hash_count);
+  for (int32 tick_idx = 0; tick_idx < tick_count; ++tick_idx) {
+    if (reader->tick_hashes[tick_idx] != (uint32)state->tick_hashes[tick_idx]) {
+      *divergent_tick = first_tick + tick_idx;
+      return false;
+    }
+  }
+  if (reader->tick_hash_count != state->tick_hash_count) {
+    // One side ran a tick the other didn't
+    *divergent_tick = first_tick + tick_count;
+    return false;
+  }
+  return true;
+}
+
+/* Gets the game ready to play towards sim_tick. Loads the last keyframe at or before it
+ * into memory, starting from the full keyframe before that, and points the reader just
+ * past it. When there's no such keyframe, or the storage isn't where the keyframes expect
+ * it, it rewinds to the first frame with a fresh game instead. Either way the caller then
+ * plays frames until the game reaches sim_tick. Returns whether a keyframe was used.
+ */
+internal bool32
+ReplaySeek(ReplayReader *reader, GameMemory *memory, uint64 sim_tick) {
+  ReplayHeader *header = &reader->header;
+  uint8 *end = reader->data + header->keyframe_index_offset;
+
+  int32 keyframe_idx = -1;
+  if (header->permanent_storage_base == (uint64)(uintptr_t)memory->permanent_storage &&
+      header->temp_storage_base == (uint64)(uintptr_t)memory->temp_storage) {
+    for (uint32 idx = 0; idx < header->keyframe_count; ++idx) {
+      if (reader->keyframes[idx].sim_tick <= sim_tick &&
+          reader->keyframes[idx].state_size <= memory->permanent_storage_size) {
+        keyframe_idx = (int32)idx;
+      }
+    }
+  }
+
+  bool32 result = false;
+  if (keyframe_idx >= 0) {
+    int32 full_idx = keyframe_idx;
+    while (full_idx > 0 && !reader->keyframes[full_idx].is_full) {
+      --full_idx;
+    }
+
+    uint8 *state_bytes = (uint8 *)memory->permanent_storage;
+    for (uint64 byte_idx = 0; byte_idx < reader->keyframes[full_idx].state_size; ++byte_idx) {
+      state_bytes[byte_idx] = 0;
+    }
+    result = reader->keyframes[full_idx].is_full;
+    uint8 *after_keyframe = 0;
+    for (int32 idx = full_idx; result && idx <= keyframe_idx; ++idx) {
+      ReplayKeyframe *keyframe = reader->keyframes + idx;
+      uint8 *in = reader->data + keyframe->file_offset;
+      uint8 *keyframe_end = in + sizeof(uint32);
+      if (keyframe->file_offset + sizeof(uint32) > header->keyframe_index_offset) {
+        result = false;
+      }
+      else {
+        keyframe_end += ReplayLoadU32(in);
+        after_keyframe = (keyframe_end <= end) ?
+          ReplayApplyDelta(state_bytes, keyframe->state_size, in + sizeof(uint32), keyframe_end) : 0;
+        result = (after_keyframe != 0);
+      }
+    }
+
+    if (result) {
+      // NOTE: the rewind ring in temp storage doesn't match the loaded state, and neither
+      // does the screen
+      GameState *state = (GameState *)memory->permanent_storage;
+      ClearRewindHistory(&state->rewind);
+      state->dirty_tiles.full_repaint = true;
+      memory->is_initialized = true;
+      reader->at = after_keyframe;
+      reader->frame_idx = reader->keyframes[keyframe_idx].frame_idx;
+      reader->next_keyframe_idx = (uint32)keyframe_idx + 1;
+      reader->last_input = {};
+      reader->tick_hash_count = 0;
+    }
+  }
+
+  if (!result) {
+    memory->is_initialized = false;
+    reader->at = reader->data + sizeof(ReplayHeader);
+    reader->frame_idx = 0;
+    reader->next_keyframe_idx = 0;
+    reader->last_input = {};
+    reader->tick_hash_count = 0;
+  }
+  return result;
+}
+
+#define SNAKE_REPLAY_H
+#endif
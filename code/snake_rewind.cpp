@@ -0,0 +1,302 @@
+/* Rewind history. See snake_rewind.h.
+ *
+ * Included by snake_game.cpp after the sim.
+ */
+
+// GameState plus everything pushed on the world arena
+inline uint64
+RewindStateSize(GameState *state) {
+  uint64 result = (uint64)((state->world_arena.base + state->world_arena.used) - (uint8 *)state);
+  return result;
+}
+
+inline uint64
+RewindEntrySize(uint64 delta_size) {
+  // NOTE: padded so that the size fields stay 4 byte aligned
+  uint64 result = 2 * sizeof(uint32) + ((delta_size + 3) & ~3ull);
+  return result;
+}
+
+/* Gives the history an eighth of temp storage. Called from InitializeGame once the world
+ * arena is complete and before the frame arena takes the rest. Boards too big for that to
+ * hold a few worst case entries go without.
+ */
+void InitializeRewind(GameState *state) {
+  RewindHistory *rewind = &state->rewind;
+  *rewind = {};
+  rewind->state_size = RewindStateSize(state);
+
+  uint64 ring_size = (state->transient_arena.size / 8) & ~7ull;
+  uint64 max_entry_size = RewindEntrySize(ReplayMaxDeltaSize(rewind->state_size));
+  rewind->max_touched = REWIND_MAX_TOUCHED +
+                        (uint32)state->swarm.snake_count * REWIND_TOUCHES_PER_SWARM_SNAKE;
+  // NOTE: the touched list doubles as scratch for sorting, so it gets one extra too
+  uint64 touched_size = 2 * (rewind->max_touched + 1) * sizeof(RewindRange);
+  rewind->enabled = (ring_size >= 4 * max_entry_size &&
+                     ring_size + rewind->state_size + touched_size + 32 <=
+                     GetArenaSizeRemaining(&state->transient_arena));
+  if (rewind->enabled) {
+    rewind->last_state = PushArray(&state->transient_arena, rewind->state_size, uint8);
+    rewind->ring = PushArray(&state->transient_arena, ring_size, uint8);
+    rewind->ring_size = ring_size;
+    rewind->state_base = (uint8 *)state;
+    rewind->touched = PushArray(&state->transient_arena, rewind->max_touched + 1, RewindRange);
+    rewind->ranges = PushArray(&state->transient_arena, rewind->max_touched + 1, RewindRange);
+  }
+}
+
+internal void
+RewindDropOldest(RewindHistory *rewind) {
+  Assert(rewind->entry_count > rewind->undo_count);
+  uint32 delta_size = *(uint32 *)(rewind->ring + rewind->tail);
+  rewind->tail += RewindEntrySize(delta_size);
+  --rewind->entry_count;
+  if (rewind->wrapped && rewind->tail == rewind->wrap_end) {
+    rewind->tail = 0;
+    rewind->wrapped = false;
+  }
+}
+
+/* Forgets everything we stepped back past. Called when the sim runs on from an earlier
+ * tick, since that makes a different future.
+ */
+internal void
+RewindDropUndone(RewindHistory *rewind) {
+  if (rewind->undo_count > 0) {
+    rewind->entry_count -= rewind->undo_count;
+    rewind->undo_count = 0;
+    if (rewind->entry_count == 0) {
+      ClearRewindHistory(rewind);
+      rewind->has_last_state = true; // NOTE: it still matches the current state
+    }
+    else if (rewind->wrapped && (rewind->cursor == 0 || rewind->cursor >= rewind->tail)) {
+      // Everything written after wrapping was undone
+      rewind->head = (rewind->cursor == 0) ? rewind->wrap_end : rewind->cursor;
+      rewind->wrapped = false;
+    }
+    else {
+      rewind->head = rewind->cursor;
+    }
+    rewind->cursor = rewind->head;
+  }
+}
+
+/* Finds size contiguous bytes at the head of the ring, dropping the oldest entries until
+ * they fit. Wraps to the start of the ring when the end is too short.
+ */
+internal uint8 *
+RewindMakeRoom(RewindHistory *rewind, uint64 size) {
+  Assert(size <= rewind->ring_size);
+  for (;;) {
+    if (rewind->entry_count == 0) {
+      rewind->head = 0;
+      rewind->tail = 0;
+      rewind->wrapped = false;
+    }
+    if (!rewind->wrapped) {
+      if (rewind->head + size <= rewind->ring_size) {
+        break;
+      }
+      rewind->wrap_end = rewind->head;
+      rewind->head = 0;
+      rewind->wrapped = true;
+    }
+    if (rewind->head + size <= rewind->tail) {
+      break;
+    }
+    RewindDropOldest(rewind);
+  }
+  return rewind->ring + rewind->head;
+}
+
+/* Bottom up merge sort by begin, ping-ponging between ranges and scratch. Returns
+ * whichever of the two ends up sorted.
+ * NOTE: a swarm tick reports thousands of ranges, too many for an insertion sort
+ */
+internal RewindRange *
+RewindSortRanges(RewindRange *ranges, RewindRange *scratch, uint32 count) {
+  RewindRange *source = ranges;
+  RewindRange *dest = scratch;
+  for (uint32 width = 1; width < count; width *= 2) {
+    for (uint32 begin = 0; begin < count; begin += 2 * width) {
+      uint32 mid = Min(begin + width, count);
+      uint32 end = Min(begin + 2 * width, count);
+      uint32 left = begin;
+      uint32 right = mid;
+      for (uint32 out_idx = begin; out_idx < end; ++out_idx) {
+        if (left < mid && (right >= end || source[left].begin <= source[right].begin)) {
+          dest[out_idx] = source[left++];
+        }
+        else {
+          dest[out_idx] = source[right++];
+        }
+      }
+    }
+    RewindRange *swap = source;
+    source = dest;
+    dest = swap;
+  }
+  return source;
+}
+
+/* Sorts the touched ranges plus GameState itself into rewind->ranges, merging any that
+ * overlap or sit closer than a delta run would break over. Returns the range count, or 0
+ * when everything has to be compared. Leaves the touched list scrambled.
+ */
+internal uint32
+RewindGatherRanges(RewindHistory *rewind) {
+  uint32 result = 0;
+  if (!rewind->touched_all) {
+    RewindRange *ranges = rewind->ranges;
+    ranges[result++] = {0, sizeof(GameState)};
+    for (uint32 touched_idx = 0; touched_idx < rewind->touched_count; ++touched_idx) {
+      Assert(rewind->touched[touched_idx].end <= rewind->state_size);
+      ranges[result++] = rewind->touched[touched_idx];
+    }
+    RewindRange *sorted = RewindSortRanges(ranges, rewind->touched, result);
+
+    // NOTE: writes never get ahead of reads, so this is fine when sorted is ranges
+    ranges[0] = sorted[0];
+    uint32 merged_count = 1;
+    for (uint32 range_idx = 1; range_idx < result; ++range_idx) {
+      RewindRange *last = &ranges[merged_count - 1];
+      if (sorted[range_idx].begin <= last->end + REPLAY_DELTA_MIN_GAP) {
+        last->end = Max(last->end, sorted[range_idx].end);
+      }
+      else {
+        ranges[merged_count++] = sorted[range_idx];
+      }
+    }
+    result = merged_count;
+  }
+  return result;
+}
+
+/* Stores the difference between the last tick and this one. Call after every sim tick.
+ */
+internal void
+RewindRecordTick(GameState *state) {
+  RewindHistory *rewind = &state->rewind;
+  if (rewind->enabled) {
+    Assert(RewindStateSize(state) == rewind->state_size);
+    RewindDropUndone(rewind);
+
+    uint8 *state_bytes = (uint8 *)state;
+    if (rewind->has_last_state) {
+      RewindRange *ranges = rewind->ranges;
+      uint32 range_count = RewindGatherRanges(rewind);
+      uint64 max_delta_size = 0;
+      if (range_count > 0) {
+        for (uint32 range_idx = 0; range_idx < range_count; ++range_idx) {
+          max_delta_size += ReplayMaxDeltaSize(ranges[range_idx].end - ranges[range_idx].begin);
+        }
+      }
+      else {
+        max_delta_size = ReplayMaxDeltaSize(rewind->state_size);
+      }
+      uint8 *entry = RewindMakeRoom(rewind, RewindEntrySize(max_delta_size));
+
+      // NOTE: copy our own bookkeeping over so that it never shows up in a delta
+      uint64 rewind_offset = (uint64)((uint8 *)rewind - state_bytes);
+      uint8 *rewind_bytes = (uint8 *)rewind;
+      for (uint64 byte_idx = 0; byte_idx < sizeof(*rewind); ++byte_idx) {
+        rewind->last_state[rewind_offset + byte_idx] = rewind_bytes[byte_idx];
+      }
+
+      uint8 *delta = entry + sizeof(uint32);
+      uint64 delta_size;
+      if (range_count > 0) {
+        uint8 *out = delta;
+        uint64 written_to = 0;
+        for (uint32 range_idx = 0; range_idx < range_count; ++range_idx) {
+          out = ReplayEncodeDeltaRange(out, rewind->last_state, state_bytes,
+                                       ranges[range_idx].begin, ranges[range_idx].end, &written_to);
+        }
+        out = ReplayPutVarint(out, 0);
+        delta_size = (uint64)(out - delta);
+        Assert(delta_size <= max_delta_size);
+      }
+      else {
+        delta_size = ReplayEncodeDelta(delta, rewind->last_state, state_bytes, rewind->state_size);
+      }
+      uint64 entry_size = RewindEntrySize(delta_size);
+      *(uint32 *)entry = (uint32)delta_size;
+      *(uint32 *)(entry + entry_size - sizeof(uint32)) = (uint32)delta_size;
+
+      // Bring the copy up to date by only touching what changed
+      ReplayApplyDelta(rewind->last_state, rewind->state_size, delta, delta + delta_size);
+
+#if SNAKE_SLOW
+      // NOTE: catches writes the sim didn't report with RewindTouch
+      for (uint64 byte_idx = 0; byte_idx < rewind->state_size; ++byte_idx) {
+        Assert(rewind->last_state[byte_idx] == state_bytes[byte_idx]);
+      }
+#endif
+
+      rewind->head += entry_size;
+      rewind->cursor = rewind->head;
+      ++rewind->entry_count;
+      rewind->bytes_recorded += entry_size;
+      ++rewind->ticks_recorded;
+    }
+    else {
+      for (uint64 byte_idx = 0; byte_idx < rewind->state_size; ++byte_idx) {
+        rewind->last_state[byte_idx] = state_bytes[byte_idx];
+      }
+      rewind->has_last_state = true;
+    }
+    rewind->touched_count = 0;
+    rewind->touched_all = false;
+  }
+}
+
+// Undoes (or redoes) the entry at entry. XOR deltas work both ways.
+internal void
+RewindApplyEntry(GameState *state, uint8 *entry) {
+  RewindHistory *rewind = &state->rewind;
+  uint32 delta_size = *(uint32 *)entry;
+  uint8 *delta = entry + sizeof(uint32);
+  ReplayApplyDelta((uint8 *)state, rewind->state_size, delta, delta + delta_size);
+  ReplayApplyDelta(rewind->last_state, rewind->state_size, delta, delta + delta_size);
+
+  // NOTE: the delta can put back any tile without going through OccupyTile/VacateTile
+  state->dirty_tiles.full_repaint = true;
+}
+
+internal void
+RewindStepBack(GameState *state) {
+  RewindHistory *rewind = &state->rewind;
+  if (rewind->enabled && rewind->undo_count < rewind->entry_count) {
+    uint64 entry_end = rewind->cursor;
+    if (rewind->wrapped && entry_end == 0) {
+      entry_end = rewind->wrap_end;
+    }
+    uint32 delta_size = *(uint32 *)(rewind->ring + entry_end - sizeof(uint32));
+    uint64 entry_start = entry_end - RewindEntrySize(delta_size);
+    RewindApplyEntry(state, rewind->ring + entry_start);
+    rewind->cursor = entry_start;
+    ++rewind->undo_count;
+  }
+}
+
+internal void
+RewindStepForward(GameState *state) {
+  RewindHistory *rewind = &state->rewind;
+  if (rewind->enabled && rewind->undo_count > 0) {
+    uint64 entry_start = rewind->cursor;
+    if (rewind->wrapped && entry_start == rewind->wrap_end) {
+      entry_start = 0;
+    }
+    uint32 delta_size = *(uint32 *)(rewind->ring + entry_start);
+    RewindApplyEntry(state, rewind->ring + entry_start);
+    rewind->cursor = entry_start + RewindEntrySize(delta_size);
+    --rewind->undo_count;
+  }
+}
+
+// While scrubbing the sim holds still and frames step through the history instead
+inline bool32
+RewindIsScrubbing(RewindHistory *rewind) {
+  bool32 result = rewind->enabled && (rewind->step_request != 0 || rewind->undo_count > 0);
+  return result;
+}
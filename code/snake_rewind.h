@@ -0,0 +1,106 @@
+#if !defined(SNAKE_REWIND_H)
+
+/* Rewind history for stepping back through the last few minutes of a game.
+ *
+ * After every sim tick the game state (GameState plus the used world arena, the same
+ * bytes a replay keyframe holds) is compared with a copy from the tick before, and the
+ * changed bytes are stored as an XOR delta (ReplayEncodeDelta) in a ring carved out of
+ * temp storage. A tick only touches a few tiles, so an entry is tens of bytes.
+ *
+ * Comparing the whole world arena every tick costs more than the tick itself on big
+ * boards. So the sim reports what it writes there (OccupyTile and VacateTile do most of
+ * it) with RewindTouch, and only GameState plus those bytes get compared. Anything that
+ * rewrites a lot at once, like clearing the board, calls RewindTouchAll instead.
+ *
+ * XOR deltas undo themselves: applying the newest one to the current state gives the
+ * state a tick earlier, and applying it again steps forward. So every step is a single
+ * delta no matter how far back we are.
+ *
+ * Entries are [uint32 size][delta][uint32 size] so the ring can be walked either way.
+ * When the ring is full the oldest entries are dropped. The bookkeeping below lives in
+ * GameState but never shows up in a delta, so rewinding doesn't rewind the rewinder.
+ */
+
+// Bytes [begin, end) of the state, counted from the start of GameState
+struct RewindRange {
+  uint64 begin;
+  uint64 end;
+};
+
+// More writes than this in one tick and we compare everything. Swarm games get room for
+// every snake to move and eat on top.
+#define REWIND_MAX_TOUCHED 64
+#define REWIND_TOUCHES_PER_SWARM_SNAKE 32
+
+struct RewindHistory {
+  bool32 enabled; // false when temp storage is too small for this board
+
+  uint8 *last_state; // the state as of the newest tick we've seen
+  uint64 state_size;
+  bool32 has_last_state;
+
+  // What the sim wrote outside of GameState since the newest entry
+  uint8 *state_base; // the GameState that offsets count from
+  RewindRange *touched; // max_touched of them, in temp storage
+  uint32 touched_count;
+  uint32 max_touched;
+  RewindRange *ranges; // max_touched + 1, where RewindRecordTick sorts them
+  bool32 touched_all;
+
+  uint8 *ring;
+  uint64 ring_size;
+  uint64 head; // where the next entry goes
+  uint64 tail; // the oldest entry
+  uint64 wrap_end; // where entries stop before starting over at 0, when wrapped
+  bool32 wrapped;
+  uint32 entry_count;
+
+  // Stepping back undoes entries without dropping them until the sim runs again.
+  uint32 undo_count;
+  uint64 cursor; // end of the newest entry that hasn't been undone
+
+  // Set by ProcessInput for this frame: -1 back, 1 forward
+  int32 step_request;
+  bool32 resume_requested;
+
+  // Stats
+  uint64 bytes_recorded;
+  uint64 ticks_recorded;
+};
+
+// Call before writing size bytes at memory in the world arena during a tick
+inline void
+RewindTouch(RewindHistory *rewind, void *memory, uint64 size) {
+  if (rewind->enabled && !rewind->touched_all) {
+    if (rewind->touched_count < rewind->max_touched) {
+      RewindRange *range = &rewind->touched[rewind->touched_count++];
+      range->begin = (uint64)((uint8 *)memory - rewind->state_base);
+      range->end = range->begin + size;
+    }
+    else {
+      rewind->touched_all = true;
+    }
+  }
+}
+
+inline void
+RewindTouchAll(RewindHistory *rewind) {
+  rewind->touched_all = true;
+}
+
+// Throws away all history, e.g. when the game state was replaced from outside
+inline void
+ClearRewindHistory(RewindHistory *rewind) {
+  rewind->has_last_state = false;
+  rewind->touched_count = 0;
+  rewind->touched_all = false;
+  rewind->head = 0;
+  rewind->tail = 0;
+  rewind->wrapped = false;
+  rewind->entry_count = 0;
+  rewind->undo_count = 0;
+  rewind->cursor = 0;
+}
+
+#define SNAKE_REWIND_H
+#endif
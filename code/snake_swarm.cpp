@@ -0,0 +1,312 @@
+/* Many snakes on one board. See snake_swarm.h.
+ *
+ * Included by snake_game.cpp after the single snake sim.
+ */
+
+inline uint16
+SwarmOwnerId(int32 snake_idx) {
+  Assert(snake_idx >= 0 && snake_idx < SWARM_MAX_SNAKES);
+  return (uint16)(snake_idx + 1);
+}
+
+inline bool32
+SwarmTileIsSafe(GameState *state, int tile_idx) {
+  bool32 result = (!(state->board[tile_idx] & TILE_WALL) &&
+                   state->swarm.owners[tile_idx] == SWARM_NO_OWNER);
+  return result;
+}
+
+/* Carves the snakes, their rings and the owner grid out of the world arena. Called once
+ * from InitializeGame after the board has been sized.
+ */
+void InitializeSwarm(GameState *state, GameConfig *config) {
+  SwarmState *swarm = &state->swarm;
+  swarm->snake_count = Min(config->swarm_snake_count, SWARM_MAX_SNAKES);
+  swarm->human_count = Min(config->swarm_human_count, swarm->snake_count);
+
+  int32 max_length = (config->swarm_max_length > 0) ? config->swarm_max_length : 1024;
+  max_length = Min(max_length, state->num_tiles_x * state->num_tiles_y);
+  swarm->start_length = Max(1, Min(config->swarm_start_length, max_length));
+  int32 ring_size = 1;
+  while (ring_size < max_length) {
+    ring_size <<= 1;
+  }
+
+  swarm->snakes = PushArray(&state->world_arena, swarm->snake_count, SwarmSnake);
+  swarm->moves = PushArray(&state->world_arena, swarm->snake_count, SwarmMove);
+  for (int32 snake_idx = 0; snake_idx < swarm->snake_count; ++snake_idx) {
+    SwarmSnake *swarm_snake = &swarm->snakes[snake_idx];
+    *swarm_snake = {};
+    swarm_snake->body.max_length = max_length;
+    swarm_snake->body.ring_size = ring_size;
+    swarm_snake->body.pieces = PushArray(&state->world_arena, ring_size, SnakePiece);
+    swarm_snake->controller_idx = (snake_idx < swarm->human_count) ? snake_idx : -1;
+
+    if (swarm_snake->controller_idx >= 0) {
+      swarm_snake->color = RGBColor(20, 90, 255);
+    }
+    else {
+      // Spread the AI colors around without letting any of them get close to white
+      uint32 hash = (uint32)snake_idx * 2654435761u;
+      swarm_snake->color = RGBColor(60 + ((hash >> 8) & 127),
+                                    60 + ((hash >> 16) & 127),
+                                    60 + ((hash >> 24) & 127));
+    }
+  }
+
+  swarm->owners = PushArray(&state->world_arena, state->board_tile_count, uint16);
+}
+
+// Returns false when there's no room left on the board. The caller tries again next tick.
+bool32 SpawnSwarmSnake(GameState *state, int32 snake_idx) {
+  bool32 result = false;
+  int32 tile_idx = RandomFreeTile(&state->free_tiles, &state->rng);
+  if (tile_idx >= 0) {
+    SwarmSnake *swarm_snake = &state->swarm.snakes[snake_idx];
+    SnakeState *snake = &swarm_snake->body;
+    snake->head_idx = 0;
+    snake->length = 1;
+    snake->pending_growth = state->swarm.start_length - 1;
+    snake->dir = (Direction)(pcg32_boundedrand_r(&state->rng, 4) + 1);
+    snake->new_direction = NONE;
+    snake->alive = true;
+
+    SnakePiece *head = &snake->pieces[snake->head_idx];
+    RewindTouch(&state->rewind, head, sizeof(SnakePiece));
+    head->x = (int16)(tile_idx % state->board_stride);
+    head->y = (int16)(tile_idx / state->board_stride);
+    OccupyTile(state, tile_idx, TILE_BODY);
+    RewindTouch(&state->rewind, &state->swarm.owners[tile_idx], sizeof(uint16));
+    state->swarm.owners[tile_idx] = SwarmOwnerId(snake_idx);
+
+    swarm_snake->move_interval = SnakeMoveIntervalTicks(snake);
+    swarm_snake->move_ticks_left = swarm_snake->move_interval;
+    swarm_snake->score = 0;
+    result = true;
+  }
+  return result;
+}
+
+// Clears the body off the board. Whatever it was digesting stays behind as food.
+void KillSwarmSnake(GameState *state, int32 snake_idx) {
+  SwarmState *swarm = &state->swarm;
+  SwarmSnake *swarm_snake = &swarm->snakes[snake_idx];
+  SnakeState *snake = &swarm_snake->body;
+  for (int piece_idx = 0; piece_idx < snake->length; ++piece_idx) {
+    SnakePiece *piece = GetSnakePiece(snake, piece_idx);
+    int tile_idx = BoardTileIndex(state, piece->x, piece->y);
+    VacateTile(state, tile_idx, TILE_BODY);
+    RewindTouch(&state->rewind, &swarm->owners[tile_idx], sizeof(uint16));
+    swarm->owners[tile_idx] = SWARM_NO_OWNER;
+  }
+  snake->alive = false;
+  swarm_snake->respawn_ticks_left = SWARM_RESPAWN_TICKS;
+  ++swarm->deaths;
+}
+
+// Expects the board to have just been cleared.
+void ResetSwarm(GameState *state) {
+  SwarmState *swarm = &state->swarm;
+  for (int32 tile_idx = 0; tile_idx < state->board_tile_count; ++tile_idx) {
+    swarm->owners[tile_idx] = SWARM_NO_OWNER;
+  }
+  swarm->move_count = 0;
+  swarm->deaths = 0;
+  swarm->head_on_collisions = 0;
+
+  for (int32 snake_idx = 0; snake_idx < swarm->snake_count; ++snake_idx) {
+    SwarmSnake *swarm_snake = &swarm->snakes[snake_idx];
+    swarm_snake->kills = 0;
+    swarm_snake->body.alive = false;
+    if (!SpawnSwarmSnake(state, snake_idx)) {
+      swarm_snake->respawn_ticks_left = 1;
+    }
+  }
+}
+
+/* Grabs food next to the head when there is some, otherwise mostly keeps going straight.
+ * Only looks one tile ahead so it boxes itself in plenty. Draws from the game rng so that
+ * a swarm game is still reproducible from its seed.
+ */
+void SwarmAIMove(GameState *state, SwarmSnake *swarm_snake) {
+  SnakeState *snake = &swarm_snake->body;
+  SnakePiece *head = GetSnakeHead(snake);
+  uint32 r = pcg32_random_r(&state->rng);
+  int32 first = (int32)(r & 3);
+  bool32 keep_going = ((r >> 2) & 7) != 0;
+
+  Direction best = NONE;
+  Direction fallback = NONE;
+  for (int32 option_idx = 0; option_idx < 4; ++option_idx) {
+    Direction dir = (Direction)(((first + option_idx) & 3) + 1);
+    if (dir == OppositeDirection(snake->dir) && snake->length > 1) {
+      continue;
+    }
+    SnakePiece next = NextSnakePiece(head, dir);
+    int tile_idx = BoardTileIndex(state, next.x, next.y);
+    if (SwarmTileIsSafe(state, tile_idx)) {
+      if (state->board[tile_idx] & TILE_FOOD) {
+        best = dir;
+        break;
+      }
+      if (fallback == NONE || (keep_going && dir == snake->dir)) {
+        fallback = dir;
+      }
+    }
+  }
+  if (best == NONE) {
+    best = fallback;
+  }
+  if (best != NONE) {
+    ChangeSnakeDirection(snake, best);
+  }
+}
+
+// Same as AdvanceSnake but for a swarm snake, keeping the owner grid up to date.
+void AdvanceSwarmSnake(GameState *state, int32 snake_idx, SnakePiece next, int next_tile_idx) {
+  SwarmState *swarm = &state->swarm;
+  SwarmSnake *swarm_snake = &swarm->snakes[snake_idx];
+  SnakeState *snake = &swarm_snake->body;
+  SnakePiece old_tail = *GetSnakeTail(snake);
+
+  snake->head_idx = (snake->head_idx + 1) & (snake->ring_size - 1);
+  RewindTouch(&state->rewind, &snake->pieces[snake->head_idx], sizeof(SnakePiece));
+  snake->pieces[snake->head_idx] = next;
+  OccupyTile(state, next_tile_idx, TILE_BODY);
+  // NOTE: the claim on this tile already reported the owner write
+  swarm->owners[next_tile_idx] = SwarmOwnerId(snake_idx);
+
+  if (snake->pending_growth > 0) {
+    snake->pending_growth--;
+    snake->length++;
+  }
+  else {
+    int tail_tile_idx = BoardTileIndex(state, old_tail.x, old_tail.y);
+    VacateTile(state, tail_tile_idx, TILE_BODY);
+    RewindTouch(&state->rewind, &swarm->owners[tail_tile_idx], sizeof(uint16));
+    swarm->owners[tail_tile_idx] = SWARM_NO_OWNER;
+
+    if (state->board[tail_tile_idx] & TILE_FOOD) {
+      RemoveFood(state, old_tail.x, old_tail.y);
+      ExtendSnake(snake);
+      swarm_snake->score += 1;
+    }
+  }
+
+  if (state->board[next_tile_idx] & TILE_FOOD) {
+    CreateFood(state);
+    CreateFood(state);
+    CreateFood(state);
+  }
+}
+
+/* Every snake that moves this tick picks its next tile against the board as it was at the
+ * start of the tick, then the survivors all move at once. That keeps the result independent
+ * of the order the snakes are stored in, apart from the rng draws.
+ *
+ * Heads claim their next tile in the owner grid. A second head landing on a claimed tile
+ * means a head-on collision and both die, as does anyone running into a body.
+ */
+void SimulateSwarmTick(GameState *state) {
+  TIMED_BLOCK(SimulateTick);
+
+  SwarmState *swarm = &state->swarm;
+  swarm->move_count = 0;
+
+  // NOTE: every snake counts down its timers each tick, so report the snakes and the
+  // moves as one range each. The rest gets reported where it's written.
+  RewindTouch(&state->rewind, swarm->snakes, swarm->snake_count * sizeof(SwarmSnake));
+  RewindTouch(&state->rewind, swarm->moves, swarm->snake_count * sizeof(SwarmMove));
+
+  for (int32 snake_idx = 0; snake_idx < swarm->snake_count; ++snake_idx) {
+    SwarmSnake *swarm_snake = &swarm->snakes[snake_idx];
+    SnakeState *snake = &swarm_snake->body;
+    if (!snake->alive) {
+      --swarm_snake->respawn_ticks_left;
+      continue;
+    }
+    if (--swarm_snake->move_ticks_left > 0) {
+      continue;
+    }
+
+    if (swarm_snake->controller_idx < 0) {
+      SwarmAIMove(state, swarm_snake);
+    }
+    if (snake->new_direction != NONE) {
+      snake->dir = snake->new_direction;
+      snake->new_direction = NONE;
+    }
+
+    SwarmMove *move = &swarm->moves[swarm->move_count];
+    move->snake_idx = snake_idx;
+    move->next = NextSnakePiece(GetSnakeHead(snake), snake->dir);
+    move->tile_idx = BoardTileIndex(state, move->next.x, move->next.y);
+    move->dead = false;
+
+    uint16 owner = swarm->owners[move->tile_idx];
+    if (state->board[move->tile_idx] & TILE_WALL) {
+      move->dead = true;
+    }
+    else if (owner & SWARM_OWNER_CLAIM) {
+      // Someone else is moving into the same tile. Neither of them gets it.
+      swarm->moves[owner & ~SWARM_OWNER_CLAIM].dead = true;
+      move->dead = true;
+      ++swarm->head_on_collisions;
+    }
+    else if (owner != SWARM_NO_OWNER) {
+      // NOTE: tails haven't moved yet so running into one is still fatal.
+      move->dead = true;
+      if (owner - 1 != snake_idx) {
+        swarm->snakes[owner - 1].kills++;
+      }
+    }
+    else {
+      RewindTouch(&state->rewind, &swarm->owners[move->tile_idx], sizeof(uint16));
+      swarm->owners[move->tile_idx] = (uint16)(SWARM_OWNER_CLAIM | swarm->move_count);
+    }
+    ++swarm->move_count;
+  }
+
+  for (int32 move_idx = 0; move_idx < swarm->move_count; ++move_idx) {
+    SwarmMove *move = &swarm->moves[move_idx];
+    if (swarm->owners[move->tile_idx] & SWARM_OWNER_CLAIM) {
+      swarm->owners[move->tile_idx] = SWARM_NO_OWNER;
+    }
+
+    if (move->dead) {
+      KillSwarmSnake(state, move->snake_idx);
+    }
+    else {
+      SwarmSnake *swarm_snake = &swarm->snakes[move->snake_idx];
+      AdvanceSwarmSnake(state, move->snake_idx, move->next, move->tile_idx);
+      swarm_snake->move_interval = SnakeMoveIntervalTicks(&swarm_snake->body);
+      swarm_snake->move_ticks_left = swarm_snake->move_interval;
+    }
+  }
+
+  // NOTE: respawn after everyone has moved so a new snake can't land on a claimed tile
+  for (int32 snake_idx = 0; snake_idx < swarm->snake_count; ++snake_idx) {
+    SwarmSnake *swarm_snake = &swarm->snakes[snake_idx];
+    if (!swarm_snake->body.alive && swarm_snake->respawn_ticks_left <= 0) {
+      SpawnSwarmSnake(state, snake_idx);
+    }
+  }
+
+  ++state->sim_tick;
+}
+
+void RenderSwarm(RenderGroup *group, GameState *state) {
+  SwarmState *swarm = &state->swarm;
+  for (int32 snake_idx = 0; snake_idx < swarm->snake_count; ++snake_idx) {
+    SwarmSnake *swarm_snake = &swarm->snakes[snake_idx];
+    SnakeState *snake = &swarm_snake->body;
+    if (snake->alive) {
+      for (int piece_idx = 0; piece_idx < snake->length; ++piece_idx) {
+        SnakePiece *piece = GetSnakePiece(snake, piece_idx);
+        if (TileIsVisible(state, piece->x, piece->y)) {
+          PushTile(group, swarm_snake->color, piece->x - 1, piece->y - 1);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#if !defined(SNAKE_SWARM_H)
+
+/* Many snakes sharing one board.
+ *
+ * Every snake in the swarm has its own body ring, move timer and score. Some are bound to
+ * controllers and the rest are driven by a simple AI. The board flags and the free tile
+ * index are shared with the single snake mode. On top of them sits an owner grid that
+ * holds, per tile, the id of the snake whose body covers it. A collision check is then a
+ * single lookup at the new head, so a tick costs O(snakes) no matter how long they get.
+ */
+
+// NOTE: owner ids are 15 bits. The top bit marks a tile a head has claimed this tick.
+#define SWARM_MAX_SNAKES 0x7FFF
+#define SWARM_OWNER_CLAIM 0x8000
+#define SWARM_NO_OWNER 0
+
+#define SWARM_RESPAWN_TICKS (2 * SIM_TICKS_PER_SECOND)
+
+struct SwarmSnake {
+  SnakeState body;
+  int32 move_interval; // in ticks
+  int32 move_ticks_left;
+  int32 respawn_ticks_left;
+  int32 controller_idx; // -1 when the AI drives it
+  int32 score;
+  int32 kills;
+  uint32 color;
+};
+
+// A head that wants to move this tick. Filled in before anything moves so that every
+// snake sees the same board.
+struct SwarmMove {
+  int32 snake_idx;
+  int32 tile_idx;
+  SnakePiece next;
+  bool32 dead;
+};
+
+struct SwarmState {
+  int32 snake_count; // zero when we're playing the single snake game
+  int32 human_count;
+  int32 start_length;
+  SwarmSnake *snakes;
+
+  // Per board tile: 0 when no body is there, otherwise the snake index + 1.
+  uint16 *owners;
+
+  int32 move_count;
+  SwarmMove *moves;
+
+  // Stats
+  uint64 deaths;
+  uint64 head_on_collisions;
+};
+
+#define SNAKE_SWARM_H
+#endif
@@ -0,0 +1,115 @@
+#if !defined(SNAKE_TELEMETRY_H)
+
+/* Frame telemetry
+ *
+ * Formatting a line of text and handing it to OutputDebugStringA every frame is slow,
+ * slower still with a debugger attached, and it lands right in the middle of the frame
+ * it is timing. So the platform layer appends fixed size binary records to a ring instead
+ * and a background thread drains the ring to a file. Turning the file into something
+ * readable happens offline, in snake_telemetry_tool.
+ *
+ * Appending is a compare exchange on the write index to claim a slot, a copy of the
+ * record and a release store of the slot's sequence number. Any thread can append, there
+ * are no locks and nothing is formatted. When the drain falls a whole ring behind the
+ * record is dropped and counted rather than waited on.
+ *
+ * The ring itself (TelemetryRing) is shared, the atomics and the drain thread live in
+ * linux_telemetry.cpp and win32_telemetry.cpp like the work queue's do.
+ *
+ * File layout:
+ *   TelemetryFileHeader
+ *   TelemetryRecord, one after the other until the end of the file
+ */
+
+#define TELEMETRY_MAGIC 0x544B4E53 // "SNKT"
+#define TELEMETRY_VERSION 1
+
+/* How often the drain thread empties the ring, and how big the ring is.
+ *
+ * Sized for -trace, which logs up to DEBUG_EVENT_CAPACITY (1024) block events a frame on
+ * top of the frame record. 100 ms is 6 frames at 60 Hz, so about 6200 records pile up
+ * between drains, and the ring holds 32 traced frames, a good half second of the drain
+ * thread being held up before anything gets dropped. Without tracing it's 9 minutes of
+ * frames.
+ * NOTE: has to be a power of two
+ */
+#define TELEMETRY_DRAIN_MS 100
+#define TELEMETRY_RING_SIZE 32768
+
+enum TelemetryRecordType {
+  TelemetryRecord_None,
+  TelemetryRecord_Frame,
+  TelemetryRecord_Audio,
+  TelemetryRecord_Reload,
+  TelemetryRecord_BlockBegin, // a timed block's events when tracing, see snake_debug.h
+  TelemetryRecord_BlockEnd,
+};
+
+struct TelemetryFrame {
+  uint32 frame_ns; // from the end of the last frame's wait to the end of this one's
+  uint32 work_ns; // the part of that before the wait started
+  uint32 late_ns; // how far past the deadline the wait ended
+  uint32 missed; // the work alone ran past the deadline
+  uint32 unused[2];
+};
+
+struct TelemetryAudio {
+  uint32 byte_to_lock;
+  uint32 target_cursor;
+  uint32 bytes_to_write;
+  uint32 play_cursor;
+  uint32 write_cursor;
+  uint32 latency_bytes;
+};
+
+struct TelemetryReload {
+  uint32 latency_ns; // from the build finishing to the new code being loaded
+  uint32 unused[5];
+};
+
+struct TelemetryBlock {
+  uint32 block_id; // DebugBlockId
+  uint32 thread_id;
+  uint32 unused[4];
+};
+
+struct TelemetryRecord {
+  uint32 type; // TelemetryRecordType
+  uint32 frame_index;
+  uint64 tsc; // __rdtsc() when the record was made, or when the block began or ended
+  union {
+    TelemetryFrame frame;
+    TelemetryAudio audio;
+    TelemetryReload reload;
+    TelemetryBlock block;
+  };
+};
+
+struct TelemetryFileHeader {
+  uint32 magic;
+  uint32 version;
+  uint32 record_size; // sizeof(TelemetryRecord) when written
+  uint32 dropped_count;
+
+  uint64 start_tsc;
+  // Measured against the wall clock over the whole run and written when the log is
+  // closed. 0 when it never was, in which case readers have to estimate it from the frames.
+  uint64 tsc_per_second;
+};
+
+struct TelemetrySlot {
+  uint32 volatile sequence; // the record's index + 1 once it's been written
+  TelemetryRecord record;
+};
+
+struct TelemetryRing {
+  uint32 volatile next_record_to_write;
+  uint32 volatile next_record_to_read;
+  uint32 volatile dropped_count;
+  bool32 is_active;
+
+  TelemetrySlot slots[TELEMETRY_RING_SIZE];
+};
+
+#define SNAKE_TELEMETRY_H
+#endif
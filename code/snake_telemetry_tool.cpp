@@ -0,0 +1,265 @@
+/* Telemetry converter
+ *
+ * Turns the snake_telemetry.bin the platform layers write (see snake_telemetry.h) into
+ * something readable: CSV with one row per record, or Chrome trace JSON that
+ * chrome://tracing and Perfetto can open, with each frame as a slice, its work as a
+ * slice inside it, audio cursors as counters and code reloads as instant events. Timed
+ * blocks from a -trace run become slices on the thread that ran them.
+ *
+ * Frame records are made right after the frame's wait, so a frame's slice ends at its
+ * record and cycles per frame are the tsc difference to the frame before.
+ *
+ * Usage: snake_telemetry_tool [-csv | -trace] FILE [OUT]
+ *   CSV is the default. Output goes to stdout unless OUT is given.
+ */
+
+#include "snake_game.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snake_telemetry.h"
+
+struct TelemetryLog {
+  TelemetryFileHeader header;
+  TelemetryRecord *records;
+  int64 record_count;
+  real64 tsc_per_second;
+};
+
+internal bool32
+LoadTelemetryLog(TelemetryLog *log, char *filename) {
+  bool32 result = false;
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
+    fprintf(stderr, "Couldn't open %s\n", filename);
+    return result;
+  }
+
+  if (fread(&log->header, sizeof(log->header), 1, file) != 1 ||
+      log->header.magic != TELEMETRY_MAGIC) {
+    fprintf(stderr, "%s isn't a telemetry log\n", filename);
+  }
+  else if (log->header.version != TELEMETRY_VERSION ||
+           log->header.record_size != sizeof(TelemetryRecord)) {
+    fprintf(stderr, "%s is version %u with %u byte records, this tool reads version %u with %u byte records\n",
+            filename, log->header.version, log->header.record_size,
+            TELEMETRY_VERSION, (uint32)sizeof(TelemetryRecord));
+  }
+  else {
+    fseek(file, 0, SEEK_END);
+    int64 file_size = ftell(file);
+    fseek(file, sizeof(log->header), SEEK_SET);
+    // NOTE: a log that wasn't closed cleanly can end in part of a record
+    log->record_count = (file_size - (int64)sizeof(log->header)) / (int64)sizeof(TelemetryRecord);
+    log->records = (TelemetryRecord *)malloc((size_t)Max(log->record_count, 1) * sizeof(TelemetryRecord));
+    if (log->records &&
+        fread(log->records, sizeof(TelemetryRecord), (size_t)log->record_count, file) == (size_t)log->record_count) {
+      result = true;
+    }
+    else {
+      fprintf(stderr, "Couldn't read the records in %s\n", filename);
+    }
+  }
+  fclose(file);
+
+  if (result) {
+    log->tsc_per_second = (real64)log->header.tsc_per_second;
+    if (log->tsc_per_second == 0.0) {
+      // The log was never closed. Work the rate out from the frames: between the first
+      // frame record and the last, the tsc advanced over exactly the later frames' time.
+      TelemetryRecord *first_frame = 0;
+      TelemetryRecord *last_frame = 0;
+      uint64 frame_ns = 0;
+      for (int64 record_idx = 0; record_idx < log->record_count; ++record_idx) {
+        TelemetryRecord *record = log->records + record_idx;
+        if (record->type == TelemetryRecord_Frame) {
+          if (first_frame) {
+            frame_ns += record->frame.frame_ns;
+          }
+          else {
+            first_frame = record;
+          }
+          last_frame = record;
+        }
+      }
+      if (frame_ns) {
+        log->tsc_per_second = (real64)(last_frame->tsc - first_frame->tsc) * 1e9 / (real64)frame_ns;
+      }
+      else {
+        // NOTE: nothing to go on. Times come out in cycles/3e9, which is at least in the
+        // right ballpark.
+        log->tsc_per_second = 3e9;
+      }
+      fprintf(stderr, "The log wasn't closed, estimated the tsc at %.3f GHz\n", log->tsc_per_second / 1e9);
+    }
+    if (log->header.dropped_count) {
+      fprintf(stderr, "%u records were dropped while recording\n", log->header.dropped_count);
+    }
+  }
+  return result;
+}
+
+inline char *
+TelemetryBlockName(uint32 block_id) {
+  char *result = "unknown block";
+#if SNAKE_INTERNAL
+  if (block_id < DebugBlock_Count) {
+    result = debug_block_names[block_id];
+  }
+#endif
+  return result;
+}
+
+inline real64
+TelemetryMicroseconds(TelemetryLog *log, uint64 tsc) {
+  real64 result = (real64)(int64)(tsc - log->header.start_tsc) * 1e6 / log->tsc_per_second;
+  return result;
+}
+
+internal void
+WriteTelemetryCSV(TelemetryLog *log, FILE *out) {
+  fprintf(out, "type,frame,time_ms,frame_ms,work_ms,late_ms,missed,mcycles,"
+               "byte_to_lock,target_cursor,bytes_to_write,play_cursor,write_cursor,latency_bytes,"
+               "reload_ms,block,thread\n");
+  uint64 last_frame_tsc = 0;
+  for (int64 record_idx = 0; record_idx < log->record_count; ++record_idx) {
+    TelemetryRecord *record = log->records + record_idx;
+    real64 time_ms = TelemetryMicroseconds(log, record->tsc) / 1000.0;
+    switch (record->type) {
+      case TelemetryRecord_Frame: {
+        TelemetryFrame *frame = &record->frame;
+        fprintf(out, "frame,%u,%.3f,%.3f,%.3f,%.3f,%u,", record->frame_index, time_ms,
+                frame->frame_ns / 1e6, frame->work_ns / 1e6, frame->late_ns / 1e6, frame->missed);
+        if (last_frame_tsc) {
+          fprintf(out, "%.3f", (real64)(record->tsc - last_frame_tsc) / 1e6);
+        }
+        fprintf(out, ",,,,,,,,,\n");
+        last_frame_tsc = record->tsc;
+      } break;
+
+      case TelemetryRecord_Audio: {
+        TelemetryAudio *audio = &record->audio;
+        fprintf(out, "audio,%u,%.3f,,,,,,%u,%u,%u,%u,%u,%u,,,\n", record->frame_index, time_ms,
+                audio->byte_to_lock, audio->target_cursor, audio->bytes_to_write,
+                audio->play_cursor, audio->write_cursor, audio->latency_bytes);
+      } break;
+
+      case TelemetryRecord_Reload: {
+        fprintf(out, "reload,%u,%.3f,,,,,,,,,,,,%.3f,,\n", record->frame_index, time_ms,
+                record->reload.latency_ns / 1e6);
+      } break;
+
+      case TelemetryRecord_BlockBegin:
+      case TelemetryRecord_BlockEnd: {
+        fprintf(out, "%s,%u,%.6f,,,,,,,,,,,,,%s,%u\n",
+                (record->type == TelemetryRecord_BlockBegin) ? "begin" : "end",
+                record->frame_index, time_ms,
+                TelemetryBlockName(record->block.block_id), record->block.thread_id);
+      } break;
+    }
+  }
+}
+
+internal void
+WriteTelemetryTrace(TelemetryLog *log, FILE *out) {
+  fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"frame loop\"}}");
+  uint64 last_frame_tsc = 0;
+  for (int64 record_idx = 0; record_idx < log->record_count; ++record_idx) {
+    TelemetryRecord *record = log->records + record_idx;
+    real64 time_us = TelemetryMicroseconds(log, record->tsc);
+    switch (record->type) {
+      case TelemetryRecord_Frame: {
+        TelemetryFrame *frame = &record->frame;
+        real64 start_us = time_us - frame->frame_ns / 1e3;
+        real64 mega_cycles = last_frame_tsc ? (real64)(record->tsc - last_frame_tsc) / 1e6 : 0.0;
+        fprintf(out, ",\n{\"name\":\"frame %u\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                     "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"late_ms\":%.3f,\"missed\":%u,\"mcycles\":%.3f}}",
+                record->frame_index, start_us, frame->frame_ns / 1e3,
+                frame->late_ns / 1e6, frame->missed, mega_cycles);
+        fprintf(out, ",\n{\"name\":\"work\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                     "\"ts\":%.3f,\"dur\":%.3f}",
+                start_us, frame->work_ns / 1e3);
+        last_frame_tsc = record->tsc;
+      } break;
+
+      case TelemetryRecord_Audio: {
+        TelemetryAudio *audio = &record->audio;
+        fprintf(out, ",\n{\"name\":\"audio\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,"
+                     "\"args\":{\"latency_bytes\":%u,\"bytes_to_write\":%u}}",
+                time_us, audio->latency_bytes, audio->bytes_to_write);
+      } break;
+
+      case TelemetryRecord_Reload: {
+        fprintf(out, ",\n{\"name\":\"reload\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":%.3f,"
+                     "\"args\":{\"latency_ms\":%.3f}}",
+                time_us, record->reload.latency_ns / 1e6);
+      } break;
+
+      case TelemetryRecord_BlockBegin:
+      case TelemetryRecord_BlockEnd: {
+        // NOTE: thread 1 is the frame lane, so real threads are moved out of its way
+        fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"block\",\"ph\":\"%s\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f}",
+                TelemetryBlockName(record->block.block_id),
+                (record->type == TelemetryRecord_BlockBegin) ? "B" : "E",
+                (unsigned long long)record->block.thread_id + 2, time_us);
+      } break;
+    }
+  }
+  fprintf(out, "\n]}\n");
+}
+
+int
+main(int argc, char **argv) {
+  bool32 write_trace = false;
+  char *in_filename = 0;
+  char *out_filename = 0;
+  for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+    if (strcmp(argv[arg_idx], "-csv") == 0) {
+      write_trace = false;
+    }
+    else if (strcmp(argv[arg_idx], "-trace") == 0) {
+      write_trace = true;
+    }
+    else if (!in_filename) {
+      in_filename = argv[arg_idx];
+    }
+    else if (!out_filename) {
+      out_filename = argv[arg_idx];
+    }
+    else {
+      in_filename = 0;
+      break;
+    }
+  }
+  if (!in_filename) {
+    fprintf(stderr, "usage: %s [-csv | -trace] FILE [OUT]\n", argv[0]);
+    return 1;
+  }
+
+  TelemetryLog log = {};
+  if (!LoadTelemetryLog(&log, in_filename)) {
+    return 1;
+  }
+
+  FILE *out = stdout;
+  if (out_filename) {
+    out = fopen(out_filename, "wb");
+    if (!out) {
+      fprintf(stderr, "Couldn't create %s\n", out_filename);
+      return 1;
+    }
+  }
+  if (write_trace) {
+    WriteTelemetryTrace(&log, out);
+  }
+  else {
+    WriteTelemetryCSV(&log, out);
+  }
+  if (out != stdout) {
+    fclose(out);
+  }
+  free(log.records);
+  return 0;
+}
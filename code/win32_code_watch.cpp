@@ -0,0 +1,149 @@
+/* Game code watcher on ReadDirectoryChangesW. See linux_code_watch.cpp for the Linux one.
+ *
+ * Instead of the frame loop asking for snake_game.dll's write time every frame, a thread
+ * waits on change notifications for the directory it lives in and sets reload_pending
+ * once a rebuild is done. All the frame loop does is take the flag with an interlocked
+ * exchange.
+ *
+ * The notifications only say that the file changed, not that the linker is finished with
+ * it, and loading a half written dll is what crashed reloads mid-build. So after the last
+ * change we wait until debounce_ms have gone by without another one and then check that
+ * we can open the dll with no sharing, which fails for as long as the linker still has it
+ * open. Until then we keep waiting.
+ */
+
+struct Win32CodeWatch {
+  uint32 volatile reload_pending; // set by the watcher, taken by the frame loop
+
+  HANDLE directory_handle;
+  char path[MAX_PATH];
+  WCHAR filename[MAX_PATH];
+  int32 filename_length;
+  DWORD debounce_ms;
+};
+
+internal bool32
+Win32CodeWatchNamesFile(Win32CodeWatch *watch, FILE_NOTIFY_INFORMATION *info) {
+  int32 name_length = (int32)(info->FileNameLength / sizeof(WCHAR));
+  bool32 result = (name_length == watch->filename_length &&
+                   CompareStringOrdinal(info->FileName, name_length,
+                                        watch->filename, watch->filename_length, TRUE) == CSTR_EQUAL);
+  return result;
+}
+
+internal DWORD WINAPI
+Win32CodeWatchThreadProc(LPVOID parameter) {
+  Win32CodeWatch *watch = (Win32CodeWatch *)parameter;
+
+  OVERLAPPED overlapped = {};
+  overlapped.hEvent = CreateEventA(0, TRUE, FALSE, 0);
+
+  // NOTE: has to be DWORD aligned
+  DWORD buffer[16*1024];
+  DWORD notify_filter = FILE_NOTIFY_CHANGE_LAST_WRITE|FILE_NOTIFY_CHANGE_FILE_NAME|FILE_NOTIFY_CHANGE_SIZE;
+
+  bool32 read_issued = false;
+  bool32 file_changed = false;
+  for (;;) {
+    if (!read_issued) {
+      ResetEvent(overlapped.hEvent);
+      if (!ReadDirectoryChangesW(watch->directory_handle, buffer, sizeof(buffer), FALSE,
+                                 notify_filter, 0, &overlapped, 0)) {
+        // TODO diagnostic
+        break;
+      }
+      read_issued = true;
+    }
+
+    DWORD wait_result = WaitForSingleObject(overlapped.hEvent, file_changed ? watch->debounce_ms : INFINITE);
+    if (wait_result == WAIT_OBJECT_0) {
+      read_issued = false;
+      DWORD bytes_returned = 0;
+      if (GetOverlappedResult(watch->directory_handle, &overlapped, &bytes_returned, FALSE)) {
+        if (bytes_returned == 0) {
+          // NOTE: the buffer overflowed and we don't know what we missed
+          file_changed = true;
+        }
+        uint8 *at = (uint8 *)buffer;
+        while (bytes_returned) {
+          FILE_NOTIFY_INFORMATION *info = (FILE_NOTIFY_INFORMATION *)at;
+          if (Win32CodeWatchNamesFile(watch, info)) {
+            file_changed = true;
+          }
+          if (!info->NextEntryOffset) {
+            break;
+          }
+          at += info->NextEntryOffset;
+        }
+      }
+    }
+    else if (wait_result == WAIT_TIMEOUT) {
+      // Quiet for debounce_ms. See if the linker let go of the dll.
+      HANDLE file_handle = CreateFileA(watch->path, GENERIC_READ, 0, 0, OPEN_EXISTING, 0, 0);
+      if (file_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_handle);
+        file_changed = false;
+        InterlockedExchange((LONG volatile *)&watch->reload_pending, 1);
+      }
+    }
+    else {
+      break;
+    }
+  }
+  return 0;
+}
+
+/* Starts watching the file at path. Returns false if the directory can't be watched, in
+ * which case the caller has to fall back to polling.
+ */
+internal bool32
+Win32StartCodeWatch(Win32CodeWatch *watch, char *path, DWORD debounce_ms) {
+  bool32 result = false;
+
+  char *one_past_last_slash = path;
+  for (char *scan = path; *scan; ++scan) {
+    if (*scan == '\\' || *scan == '/') {
+      one_past_last_slash = scan + 1;
+    }
+  }
+
+  char directory[MAX_PATH];
+  int32 directory_length = (int32)(one_past_last_slash - path);
+  if (directory_length == 0) {
+    directory[directory_length++] = '.';
+  }
+  else {
+    CopyMemory(directory, path, directory_length);
+  }
+  directory[directory_length] = 0;
+
+  watch->filename_length = MultiByteToWideChar(CP_ACP, 0, one_past_last_slash, -1,
+                                               watch->filename, ArrayCount(watch->filename)) - 1;
+  if (watch->filename_length > 0 && (uint32)StrLen(path) < sizeof(watch->path)) {
+    CopyMemory(watch->path, path, StrLen(path) + 1);
+    watch->debounce_ms = debounce_ms;
+    watch->reload_pending = 0;
+
+    watch->directory_handle = CreateFileA(directory, FILE_LIST_DIRECTORY,
+                                          FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, 0,
+                                          OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OVERLAPPED, 0);
+    if (watch->directory_handle != INVALID_HANDLE_VALUE) {
+      HANDLE thread_handle = CreateThread(0, 0, Win32CodeWatchThreadProc, watch, 0, 0);
+      if (thread_handle) {
+        CloseHandle(thread_handle);
+        result = true;
+      }
+      else {
+        CloseHandle(watch->directory_handle);
+      }
+    }
+  }
+  return result;
+}
+
+// Returns true once per finished rebuild. This is the only part the frame loop runs.
+inline bool32
+Win32CodeWatchTakeReload(Win32CodeWatch *watch) {
+  bool32 result = (InterlockedExchange((LONG volatile *)&watch->reload_pending, 0) != 0);
+  return result;
+}
@@ -0,0 +1,83 @@
+/* Win32 half of the frame pacer. See snake_pacer.h.
+ *
+ * Sleeps on a high resolution waitable timer where there is one (Windows 10 1803 and up),
+ * which isn't tied to the 1 ms scheduler tick. Otherwise it falls back to Sleep, and the
+ * pacer's margin grows to cover however coarse that turns out to be.
+ */
+
+#if !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+#include "snake_pacer.h"
+
+struct Win32PacerTimer {
+  HANDLE timer_handle; // 0 when there's no high resolution timer
+  bool32 sleep_is_granular;
+  int64 perf_count_freq;
+};
+
+internal void
+Win32MakePacerTimer(Win32PacerTimer *timer, bool32 sleep_is_granular) {
+  LARGE_INTEGER perf_count_freq;
+  QueryPerformanceFrequency(&perf_count_freq);
+  timer->perf_count_freq = perf_count_freq.QuadPart;
+  timer->sleep_is_granular = sleep_is_granular;
+  timer->timer_handle = CreateWaitableTimerExW(0, 0, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+}
+
+// Converts a performance counter value to nanoseconds without overflowing
+inline uint64
+Win32PacerCounterToNs(Win32PacerTimer *timer, int64 counter) {
+  uint64 seconds = (uint64)(counter / timer->perf_count_freq);
+  uint64 remainder = (uint64)(counter % timer->perf_count_freq);
+  uint64 result = seconds * 1000000000ull + (remainder * 1000000000ull) / (uint64)timer->perf_count_freq;
+  return result;
+}
+
+inline uint64
+Win32PacerClock(Win32PacerTimer *timer) {
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  uint64 result = Win32PacerCounterToNs(timer, counter.QuadPart);
+  return result;
+}
+
+/* Waits for deadline_ns on the performance counter's timeline (see Win32PacerCounterToNs).
+ * Returns when the wait ended, which is the start of the next frame.
+ */
+internal uint64
+Win32WaitForFrame(FramePacer *pacer, Win32PacerTimer *timer, uint64 deadline_ns) {
+  uint64 now = Win32PacerClock(timer);
+  bool32 missed = (now >= deadline_ns);
+  if (!missed) {
+    uint64 wake_ns = PacerWakeTime(pacer, deadline_ns);
+    if (now < wake_ns) {
+      if (timer->timer_handle) {
+        // NOTE: negative means relative, in 100 ns units
+        LARGE_INTEGER due_time;
+        due_time.QuadPart = -(LONGLONG)((wake_ns - now) / 100);
+        if (SetWaitableTimer(timer->timer_handle, &due_time, 0, 0, 0, FALSE)) {
+          WaitForSingleObject(timer->timer_handle, INFINITE);
+        }
+      }
+      else if (timer->sleep_is_granular) {
+        DWORD sleep_ms = (DWORD)((wake_ns - now) / 1000000);
+        if (sleep_ms > 0) {
+          Sleep(sleep_ms);
+        }
+      }
+      now = Win32PacerClock(timer);
+      PacerRecordSleep(pacer, wake_ns, now);
+    }
+
+    uint64 spin_start = now;
+    while (now < deadline_ns) {
+      _mm_pause();
+      now = Win32PacerClock(timer);
+    }
+    pacer->total_spin_ns += now - spin_start;
+  }
+  PacerRecordFrame(pacer, deadline_ns, now, missed);
+  return now;
+}
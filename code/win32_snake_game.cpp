@@ -27,11 +27,17 @@
 
 #include <windows.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <xinput.h>
 #include <dsound.h>
 #include "pcg_basic.h"
 
 #include "win32_snake_game.h"
+#include "win32_work_queue.cpp"
+#include "win32_code_watch.cpp"
+#include "win32_frame_pacer.cpp"
+#include "win32_telemetry.cpp"
 
 
 // ---------------------------------------------------------------------------------------
@@ -88,6 +94,7 @@ Win32GetSecondsElapsed(LARGE_INTEGER start, LARGE_INTEGER end) {
 // File I/O
 // ---------------------------------------------------------------------------------------
 
+#if SNAKE_INTERNAL
 DEBUG_PLATFORM_FREE_FILE_MEMORY(DEBUGPlatformFreeFileMemory) {
   if (memory) {
     VirtualFree(memory, 0, MEM_RELEASE);
@@ -154,6 +161,7 @@ DEBUG_PLATFORM_WRITE_ENTIRE_FILE(DEBUGPlatformWriteEntireFile) {
 
   return result;
 }
+#endif
 
 inline FILETIME
 Win32GetLastFileWriteTime(char *filename) {
@@ -412,6 +420,21 @@ Win32RenderBuffer(Win32OffscreenBuffer* buffer,
     DIB_RGB_COLORS, SRCCOPY);
 }
 
+// Blits just [min, max) of the buffer, still 1-to-1, e.g. the part the game drew this frame.
+internal void
+Win32RenderBufferRect(Win32OffscreenBuffer* buffer, HDC device_context,
+                      int32 min_x, int32 min_y, int32 max_x, int32 max_y) {
+  if (min_x < max_x && min_y < max_y) {
+    StretchDIBits(
+      device_context,
+      min_x, min_y, max_x - min_x, max_y - min_y,
+      min_x, min_y, max_x - min_x, max_y - min_y,
+      buffer->memory,
+      &buffer->info,
+      DIB_RGB_COLORS, SRCCOPY);
+  }
+}
+
 internal LRESULT CALLBACK
 Win32MainWindowCallback(HWND window, UINT message, WPARAM w_param, LPARAM l_param) {
   LRESULT result = 0;
@@ -581,9 +604,149 @@ Win32GetReplyBuffer(Win32PlatformState *state, int unsigned index) {
   return replay;
 }
 
+/* The backing file and mapping are only created the first time a slot is recorded into
+ * instead of for every slot at startup. A fresh mapping reads as zeros just like the fresh
+ * game store did, so the buffer starts out in sync with every page the game hasn't
+ * written to yet, and touched_pages knows about the rest.
+ */
+internal Win32ReplayBuffer *
+Win32OpenReplayBuffer(Win32PlatformState *state, int unsigned index) {
+  Win32ReplayBuffer *replay_buffer = Win32GetReplyBuffer(state, index);
+  if (!replay_buffer->memory_block) {
+    Win32GetInputFileLocation(state, index, replay_buffer->filename, sizeof(replay_buffer->filename));
+
+    replay_buffer->file_handle =
+      CreateFileA(replay_buffer->filename,
+                  GENERIC_READ|GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
+
+    DWORD max_size_high = state->total_size >> 32;
+    DWORD max_size_low = state->total_size & 0xFFFFFFFF;
+
+    replay_buffer->memory_map = CreateFileMapping(
+        replay_buffer->file_handle, 0, PAGE_READWRITE,
+        max_size_high, max_size_low, 0);
+
+    replay_buffer->memory_block = MapViewOfFile(
+        replay_buffer->memory_map, FILE_MAP_ALL_ACCESS, 0, 0, state->total_size);
+
+    replay_buffer->dirty_pages = (uint64 *)VirtualAlloc(0, state->dirty_page_word_count * sizeof(uint64),
+                                                        MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+
+    if (!replay_buffer->memory_block || !replay_buffer->dirty_pages) {
+      // TODO diagnostic
+      replay_buffer->memory_block = 0;
+    }
+    else {
+      // NOTE: the write watch was reset by earlier collects, so it won't report those pages
+      // again
+      for (uint64 word_idx = 0; word_idx < state->dirty_page_word_count; ++word_idx) {
+        replay_buffer->dirty_pages[word_idx] = state->touched_pages[word_idx];
+      }
+    }
+  }
+  return replay_buffer;
+}
+
+inline void
+Win32MarkPageDirty(Win32ReplayBuffer *replay_buffer, uint64 page_idx) {
+  replay_buffer->dirty_pages[page_idx >> 6] |= (1ull << (page_idx & 63));
+}
+
+/* Asks the OS which pages of the game store were written since the last call and marks
+ * them dirty in every open replay buffer.
+ */
+internal void
+Win32CollectWrittenPages(Win32PlatformState *state) {
+  ULONG_PTR written_count = (ULONG_PTR)state->page_count;
+  ULONG granularity;
+  if (GetWriteWatch(WRITE_WATCH_FLAG_RESET, state->game_store_block, (SIZE_T)state->total_size,
+                    state->written_pages, &written_count, &granularity) == 0) {
+    for (ULONG_PTR written_idx = 0; written_idx < written_count; ++written_idx) {
+      uint64 page_idx = ((uint8 *)state->written_pages[written_idx] -
+                         (uint8 *)state->game_store_block) / state->page_size;
+      state->touched_pages[page_idx >> 6] |= (1ull << (page_idx & 63));
+    }
+    for (int replay_index = 0;
+         replay_index < ArrayCount(state->replay_buffers);
+         ++replay_index) {
+      Win32ReplayBuffer *replay_buffer = Win32GetReplyBuffer(state, replay_index);
+      if (replay_buffer->memory_block) {
+        for (ULONG_PTR written_idx = 0; written_idx < written_count; ++written_idx) {
+          uint64 page_idx = ((uint8 *)state->written_pages[written_idx] -
+                             (uint8 *)state->game_store_block) / state->page_size;
+          Win32MarkPageDirty(replay_buffer, page_idx);
+        }
+      }
+    }
+  }
+  else {
+    // TODO diagnostic. The store wasn't allocated with MEM_WRITE_WATCH so treat
+    // everything as dirty.
+    for (uint64 page_idx = 0; page_idx < state->page_count; ++page_idx) {
+      state->touched_pages[page_idx >> 6] |= (1ull << (page_idx & 63));
+    }
+    for (int replay_index = 0;
+         replay_index < ArrayCount(state->replay_buffers);
+         ++replay_index) {
+      Win32ReplayBuffer *replay_buffer = Win32GetReplyBuffer(state, replay_index);
+      if (replay_buffer->memory_block) {
+        for (uint64 page_idx = 0; page_idx < state->page_count; ++page_idx) {
+          Win32MarkPageDirty(replay_buffer, page_idx);
+        }
+      }
+    }
+  }
+}
+
+/* Copies the buffer's dirty pages from source to dest, merging neighboring pages into one
+ * copy, and clears them. Returns the number of pages copied.
+ */
+internal uint64
+Win32CopyDirtyPages(Win32PlatformState *state, Win32ReplayBuffer *replay_buffer, void *dest, void *source) {
+  uint64 pages_copied = 0;
+  uint64 run_start = 0;
+  uint64 run_count = 0;
+  for (uint64 word_idx = 0; word_idx < state->dirty_page_word_count; ++word_idx) {
+    uint64 word = replay_buffer->dirty_pages[word_idx];
+    for (uint64 bit_idx = 0; bit_idx < 64; ++bit_idx) {
+      uint64 page_idx = (word_idx << 6) + bit_idx;
+      bool32 is_dirty = (word >> bit_idx) & 1;
+      if (is_dirty && run_count && (run_start + run_count == page_idx)) {
+        ++run_count;
+      }
+      else {
+        if (run_count) {
+          uint64 offset = run_start * state->page_size;
+          CopyMemory((uint8 *)dest + offset, (uint8 *)source + offset, run_count * state->page_size);
+          pages_copied += run_count;
+          run_count = 0;
+        }
+        if (is_dirty) {
+          run_start = page_idx;
+          run_count = 1;
+        }
+      }
+      if (!word) {
+        break; // NOTE: nothing else in this word and any run was just flushed
+      }
+    }
+    replay_buffer->dirty_pages[word_idx] = 0;
+  }
+  if (run_count) {
+    uint64 offset = run_start * state->page_size;
+    CopyMemory((uint8 *)dest + offset, (uint8 *)source + offset, run_count * state->page_size);
+    pages_copied += run_count;
+  }
+  return pages_copied;
+}
+
+/* Starts a loop. Instead of copying the whole game store (more than half a gig, almost all
+ * of it untouched) into the slot, only the pages written since the slot last matched the
+ * store are copied.
+ */
 internal void
 Win32StartRecordingInput(Win32PlatformState *state, int input_recording_index) {
-  Win32ReplayBuffer *replay_buffer = Win32GetReplyBuffer(state, input_recording_index);
+  Win32ReplayBuffer *replay_buffer = Win32OpenReplayBuffer(state, input_recording_index);
   if (replay_buffer->memory_block) {
     state->input_recording_index = input_recording_index;
     state->recording_handle = replay_buffer->file_handle;
@@ -593,10 +756,14 @@ Win32StartRecordingInput(Win32PlatformState *state, int input_recording_index) {
     file_position.QuadPart = state->total_size;
     SetFilePointerEx(state->recording_handle, file_position, 0, FILE_BEGIN);
 
-    // Mem copy
-    // TODO the initial copy is still a little slow. Should revisit this and try to understand
-    // why this is the case
-    CopyMemory(replay_buffer->memory_block, state->game_store_block, state->total_size);
+    Win32CollectWrittenPages(state);
+    uint64 pages_copied = Win32CopyDirtyPages(state, replay_buffer,
+                                              replay_buffer->memory_block, state->game_store_block);
+
+    char text_buffer[256];
+    _snprintf_s(text_buffer, sizeof(text_buffer), "Loop snapshot: %I64u of %I64u pages\n",
+                pages_copied, state->page_count);
+    OutputDebugStringA(text_buffer);
   }
 }
 
@@ -605,6 +772,11 @@ Win32StopRecordingInput(Win32PlatformState *state) {
   state->input_recording_index = 0;
 }
 
+/* Rewinds the game store to the slot's snapshot. Only the pages the game touched since
+ * then are copied back. Those same pages now differ from every other slot, so they get
+ * marked dirty there, and the write watch is reset so our own copy doesn't show up as a
+ * game write next time.
+ */
 internal void
 Win32StartInputPlayback(Win32PlatformState *state, int input_playback_index) {
   Win32ReplayBuffer *replay_buffer = Win32GetReplyBuffer(state, input_playback_index);
@@ -617,8 +789,22 @@ Win32StartInputPlayback(Win32PlatformState *state, int input_playback_index) {
     file_position.QuadPart = state->total_size;
     SetFilePointerEx(state->playback_handle, file_position, 0, FILE_BEGIN);
 
-    // Mem copy
-    CopyMemory(state->game_store_block, replay_buffer->memory_block, state->total_size);
+    Win32CollectWrittenPages(state);
+    for (int replay_index = 0;
+         replay_index < ArrayCount(state->replay_buffers);
+         ++replay_index) {
+      Win32ReplayBuffer *other_buffer = Win32GetReplyBuffer(state, replay_index);
+      if (other_buffer != replay_buffer && other_buffer->memory_block) {
+        for (uint64 word_idx = 0; word_idx < state->dirty_page_word_count; ++word_idx) {
+          other_buffer->dirty_pages[word_idx] |= replay_buffer->dirty_pages[word_idx];
+        }
+      }
+    }
+    Win32CopyDirtyPages(state, replay_buffer, state->game_store_block, replay_buffer->memory_block);
+    ResetWriteWatch(state->game_store_block, (SIZE_T)state->total_size);
+
+    // The game's idea of what's on screen went back in time with the rest of it
+    state->screen_needs_full_repaint = true;
   }
 }
 
@@ -633,6 +819,72 @@ Win32RecordInput(Win32PlatformState *state, GameInput *input) {
   WriteFile(state->recording_handle, input, sizeof(*input), &bytes_written, 0);
 }
 
+/* Starts a replay of a brand new game. Unlike the loop above this doesn't snapshot memory:
+ * the game gets a new seed and is reinitialized, and the header records enough to do the
+ * same on playback. The file can be played back with `headless_snake -replay`.
+ */
+internal void
+Win32StartGameReplay(Win32PlatformState *state, GameMemory *memory, int32 screen_width, int32 screen_height) {
+  ReplayWriter *writer = &state->game_replay;
+  if (!writer->chunk) {
+    // NOTE: a keyframe can be as big as all of permanent storage, but only the part the
+    // game uses is ever touched.
+    writer->max_keyframe_size = (uint32)memory->permanent_storage_size;
+    writer->max_keyframes = 4096; // 11 hours of keyframes at 60 fps
+    writer->last_keyframe = (uint8 *)VirtualAlloc(0, writer->max_keyframe_size,
+                                                  MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    writer->chunk = (uint8 *)VirtualAlloc(0, (size_t)ReplayChunkSize(writer->max_keyframe_size),
+                                          MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    writer->keyframes = (ReplayKeyframe *)VirtualAlloc(0, writer->max_keyframes * sizeof(ReplayKeyframe),
+                                                       MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    if (!writer->last_keyframe || !writer->keyframes) {
+      // TODO diagnostic
+      writer->chunk = 0;
+    }
+  }
+
+  char replay_name[] = "snake_replay.snr";
+  char filename[WIN32_STATE_FILE_NAME_COUNT];
+  Win32RelativeEXEFilePath(state, replay_name, filename, sizeof(filename));
+  state->game_replay_handle = writer->chunk ?
+    CreateFileA(filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0) : INVALID_HANDLE_VALUE;
+  if (state->game_replay_handle != INVALID_HANDLE_VALUE) {
+    memory->rand_seed ^= (uint64)Win32GetWallClock().QuadPart;
+    memory->is_initialized = false;
+
+    BeginReplay(writer, memory, screen_width, screen_height);
+    DWORD bytes_written;
+    WriteFile(state->game_replay_handle, &writer->header, sizeof(writer->header), &bytes_written, 0);
+  }
+  else {
+    state->game_replay_handle = 0;
+  }
+}
+
+internal void
+Win32RecordGameReplayFrame(Win32PlatformState *state, GameMemory *memory, GameInput *input) {
+  ReplayWriter *writer = &state->game_replay;
+  uint64 chunk_size = ReplayRecordFrame(writer, memory, input);
+  DWORD bytes_written;
+  WriteFile(state->game_replay_handle, writer->chunk, (DWORD)chunk_size, &bytes_written, 0);
+}
+
+internal void
+Win32StopGameReplay(Win32PlatformState *state, GameMemory *memory) {
+  ReplayWriter *writer = &state->game_replay;
+  EndReplay(writer, memory);
+  DWORD bytes_written;
+  WriteFile(state->game_replay_handle, writer->keyframes,
+            writer->header.keyframe_count * sizeof(ReplayKeyframe), &bytes_written, 0);
+
+  // NOTE: rewrite the header now that we know where the game ended up
+  LARGE_INTEGER file_position = {};
+  SetFilePointerEx(state->game_replay_handle, file_position, 0, FILE_BEGIN);
+  WriteFile(state->game_replay_handle, &writer->header, sizeof(writer->header), &bytes_written, 0);
+  CloseHandle(state->game_replay_handle);
+  state->game_replay_handle = 0;
+}
+
 internal void
 Win32PlaybackInput(Win32PlatformState *state, GameInput *input) {
   DWORD bytes_read = 0;
@@ -703,6 +955,16 @@ Win32ProcessKeyboard(Win32PlatformState *state,
           global_pause = !global_pause;
         }
       } break;
+      case 'R': {
+        if (is_down) {
+          state->game_replay_toggle_requested = true;
+        }
+      } break;
+      case VK_F1: {
+        if (is_down) {
+          state->debug_overlay_toggle_requested = true;
+        }
+      } break;
       case 'L': {
         if (is_down) {
           if (state->input_playback_index == 0) {
@@ -908,7 +1170,9 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
       if (win32_refresh_rate > 1) {
         monitor_refresh_hz = win32_refresh_rate;
       }
-      real32 game_update_hz = monitor_refresh_hz / 2.0f;
+      // NOTE: the game runs its sim at a fixed rate internally so we're free to render at
+      // the full monitor refresh rate.
+      real32 game_update_hz = (real32)monitor_refresh_hz;
       real32 target_seconds_per_frame = 1.0f / game_update_hz;
 
       win32_sound_output sound_output = {};
@@ -961,50 +1225,73 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
       game_store.rand_seed = rand_seed;
       game_store.rand_rounds = rand_rounds;
 
+      // NOTE: `snake_game.exe -snakes N` plays the swarm mode with the keyboard on snake 0
+      char *snakes_arg = strstr(command_line, "-snakes ");
+      if (snakes_arg) {
+        game_store.config.swarm_snake_count = atoi(snakes_arg + StrLen("-snakes "));
+        game_store.config.swarm_human_count = 1;
+      }
+
+#if SNAKE_INTERNAL
       game_store.DEBUGPlatformReadEntireFile = DEBUGPlatformReadEntireFile;
       game_store.DEBUGPlatformWriteEntireFile = DEBUGPlatformWriteEntireFile;
       game_store.DEBUGPlatformFreeFileMemory = DEBUGPlatformFreeFileMemory;
 
-      game_store.permanent_storage_size = Megabytes(64);
+      // NOTE: `snake_game.exe -trace` adds every timed block to the telemetry log and
+      // -overlay starts with the debug overlay showing. The game code points its own
+      // global_debug_table at the same table every frame.
+      game_store.debug_table.trace_enabled = (strstr(command_line, "-trace") != 0);
+      game_store.debug_table.overlay_enabled = (strstr(command_line, "-overlay") != 0);
+      game_store.debug_table.target_seconds_per_frame = target_seconds_per_frame;
+      global_debug_table = &game_store.debug_table;
+#endif
+
+      // NOTE: the board, snake body and free tile index are all carved out of permanent
+      // storage. 256 MB is enough for a 4096x4096 board with a snake covering all of it.
+      game_store.permanent_storage_size = Megabytes(256);
       game_store.temp_storage_size = Megabytes(500); // NOTE: Reduced from 1 GB strictly for live loop editing performance
 
 
       // TODO: add support for MEM_LARGE_PAGES
       win32_state.total_size = game_store.permanent_storage_size + game_store.temp_storage_size;
       win32_state.game_store_block = VirtualAlloc(base_address, (size_t)win32_state.total_size,
-                                                  MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+                                                  MEM_RESERVE|MEM_COMMIT|MEM_WRITE_WATCH, PAGE_READWRITE);
 
       game_store.permanent_storage = win32_state.game_store_block;
       game_store.temp_storage = ((uint8 *)game_store.permanent_storage +
           game_store.permanent_storage_size);
 
-      for (int replay_index = 0;
-           replay_index < ArrayCount(win32_state.replay_buffers);
-           ++replay_index) {
-        Win32ReplayBuffer *replay_buffer = Win32GetReplyBuffer(&win32_state, replay_index);
-
-        Win32GetInputFileLocation(&win32_state, replay_index,
-                                  replay_buffer->filename, sizeof(replay_buffer->filename));
-
-        replay_buffer->file_handle =
-          CreateFileA(replay_buffer->filename,
-                      GENERIC_READ|GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
-
-        DWORD max_size_high = win32_state.total_size >> 32;
-        DWORD max_size_low = win32_state.total_size & 0xFFFFFFFF;
-
-        replay_buffer->memory_map = CreateFileMapping(
-            replay_buffer->file_handle, 0, PAGE_READWRITE,
-            max_size_high, max_size_low, 0);
-
-        replay_buffer->memory_block = MapViewOfFile(
-            replay_buffer->memory_map, FILE_MAP_ALL_ACCESS, 0, 0, win32_state.total_size);
-
-        if (replay_buffer->memory_block) {
-        }
-        else {
-          // TODO diagnostic
-        }
+      SYSTEM_INFO system_info;
+      GetSystemInfo(&system_info);
+      win32_state.page_size = system_info.dwPageSize;
+      win32_state.page_count = (win32_state.total_size + win32_state.page_size - 1) / win32_state.page_size;
+      win32_state.dirty_page_word_count = (win32_state.page_count + 63) / 64;
+      win32_state.written_pages = (void **)VirtualAlloc(0, win32_state.page_count * sizeof(void *),
+                                                        MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+      win32_state.touched_pages = (uint64 *)VirtualAlloc(0, win32_state.dirty_page_word_count * sizeof(uint64),
+                                                         MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+
+      // NOTE: one worker for every core besides this one, which helps out while it waits
+      PlatformWorkQueue render_queue = {};
+      Win32MakeQueue(&render_queue, system_info.dwNumberOfProcessors - 1);
+      game_store.render_queue = &render_queue;
+      game_store.PlatformAddEntry = Win32AddEntry;
+      game_store.PlatformCompleteAllWork = Win32CompleteAllWork;
+
+      // NOTE: the pacer measures in nanoseconds on the performance counter's timeline
+      Win32PacerTimer pacer_timer = {};
+      Win32MakePacerTimer(&pacer_timer, sleep_is_granular);
+      FramePacer pacer;
+      InitFramePacer(&pacer, (uint64)(1e9f * target_seconds_per_frame));
+
+      // NOTE: per frame stats go to snake_telemetry.bin next to the exe instead of the
+      // debugger. Run snake_telemetry_tool on it to read them.
+      Win32Telemetry *telemetry = (Win32Telemetry *)VirtualAlloc(0, sizeof(Win32Telemetry),
+                                                                 MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+      if (telemetry) {
+        char telemetry_full_path[WIN32_STATE_FILE_NAME_COUNT];
+        Win32RelativeEXEFilePath(&win32_state, "snake_telemetry.bin", telemetry_full_path, sizeof(telemetry_full_path));
+        Win32StartTelemetry(telemetry, telemetry_full_path);
       }
 
       // Allocate samples to the entire sound buffer size because we know we'll never need
@@ -1013,7 +1300,8 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
       int16 *sound_samples = (int16 *)VirtualAlloc(0, sound_output.secondary_buffer_size,
                                                    MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
 
-      if (game_store.permanent_storage && game_store.temp_storage && sound_samples) {
+      if (game_store.permanent_storage && game_store.temp_storage && sound_samples &&
+          win32_state.written_pages && win32_state.touched_pages) {
         global_running = true;
         global_pause = false;
 
@@ -1032,17 +1320,35 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
         real32 audio_latency_seconds = 0;
         bool32 sound_is_valid = false;
 
+        // NOTE: watch before the first load so that a build landing in between isn't missed.
+        // If the directory can't be watched we fall back to comparing write times every frame.
+        Win32CodeWatch code_watch = {};
+        bool32 code_watch_active = Win32StartCodeWatch(&code_watch, source_game_code_dll_full_path, 50);
         Win32GameCode game = Win32LoadGameCode(source_game_code_dll_full_path, temp_game_code_dll_full_path);
 
+        // The game gets the measured length of the previous frame so that a missed frame
+        // is made up by its sim accumulator rather than silently dropped.
+        real32 last_frame_seconds = target_seconds_per_frame;
+
+        uint32 frame_index = 0;
+
         // @start
-        uint64 last_cycle_count = __rdtsc();
         while (global_running) {
-          new_input->dt_for_frame = target_seconds_per_frame;
+          new_input->dt_for_frame = last_frame_seconds;
 
-          FILETIME new_dll_compile_time = Win32GetLastFileWriteTime(source_game_code_dll_full_path);
-          if (CompareFileTime(&new_dll_compile_time, &game.dll_last_compile_time) != 0) {
+          bool32 reload_game_code = false;
+          if (code_watch_active) {
+            reload_game_code = Win32CodeWatchTakeReload(&code_watch);
+          }
+          else {
+            FILETIME new_dll_compile_time = Win32GetLastFileWriteTime(source_game_code_dll_full_path);
+            reload_game_code = (CompareFileTime(&new_dll_compile_time, &game.dll_last_compile_time) != 0);
+          }
+          if (reload_game_code) {
             Win32UnloadGameCode(&game);
             game = Win32LoadGameCode(source_game_code_dll_full_path, temp_game_code_dll_full_path);
+            // NOTE: the new code might draw things differently
+            win32_state.screen_needs_full_repaint = true;
           }
 
           // TODO Make a zeroing macro
@@ -1058,7 +1364,10 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
               old_keyboard_controller->buttons[button_idx].ended_down;
           }
 
-          Win32ProcessPendingMessages(&win32_state, new_keyboard_controller);
+          {
+            TIMED_BLOCK(PlatformInput);
+            Win32ProcessPendingMessages(&win32_state, new_keyboard_controller);
+          }
 
           if (!global_pause) {
             POINT mouse_loc;
@@ -1211,6 +1520,15 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
               }
             }
 
+#if SNAKE_INTERNAL
+            if (win32_state.debug_overlay_toggle_requested) {
+              win32_state.debug_overlay_toggle_requested = false;
+              game_store.debug_table.overlay_enabled = !game_store.debug_table.overlay_enabled;
+              // NOTE: the board under the overlay has to be drawn again
+              win32_state.screen_needs_full_repaint = true;
+            }
+#endif
+
             // -----------------------------------------------------------------------------
             // Update and render the game
 
@@ -1222,6 +1540,8 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
             screen_buffer.height = global_backbuffer.height;
             screen_buffer.pitch = global_backbuffer.pitch;
             screen_buffer.bytes_per_pixel = global_backbuffer.bytes_per_pixel;
+            screen_buffer.needs_full_repaint = win32_state.screen_needs_full_repaint;
+            win32_state.screen_needs_full_repaint = false;
 
             if (win32_state.input_recording_index) {
               Win32RecordInput(&win32_state, new_input);
@@ -1231,10 +1551,25 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
               Win32PlaybackInput(&win32_state, new_input);
             }
 
+            if (win32_state.game_replay_toggle_requested) {
+              win32_state.game_replay_toggle_requested = false;
+              if (win32_state.game_replay_handle) {
+                Win32StopGameReplay(&win32_state, &game_store);
+              }
+              else {
+                Win32StartGameReplay(&win32_state, &game_store, screen_buffer.width, screen_buffer.height);
+              }
+            }
+
             if (game.UpdateAndRender) {
               game.UpdateAndRender(&thread, &game_store, new_input, &screen_buffer);
             }
 
+            // NOTE: after the update so the frame carries the hashes of the ticks it ran
+            if (win32_state.game_replay_handle) {
+              Win32RecordGameReplayFrame(&win32_state, &game_store, new_input);
+            }
+
             // -----------------------------------------------------------------------------
             // Write the sound to the sound card
 
@@ -1323,7 +1658,10 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
                 game.GetSoundSamples(&thread, &game_store, &sound_buffer);
               }
 
-              Win32FillSoundBuffer(&sound_output, byte_to_lock, bytes_to_write, &sound_buffer);
+              {
+                TIMED_BLOCK(PlatformFillSoundBuffer);
+                Win32FillSoundBuffer(&sound_output, byte_to_lock, bytes_to_write, &sound_buffer);
+              }
 
 #if SNAKE_INTERNAL
               Win32DebugAudioTimeMarker *marker = &debug_audio_time_markers[debug_audio_time_marker_idx];
@@ -1345,12 +1683,18 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
                 ((real32)audio_latency_bytes / (real32)sound_output.bytes_per_sample)
                 / (real32)sound_output.samples_per_second;
 
-              char text_buffer[256];
-              _snprintf_s(text_buffer, sizeof(text_buffer),
-                  "BTL:%u TC:%u BTW:%u PC:%u WC:%u DELTA:%u ALS:%fs\n",
-                  byte_to_lock, target_cursor, bytes_to_write,
-                  play_cursor, write_cursor, audio_latency_bytes, audio_latency_seconds);
-              OutputDebugStringA(text_buffer);
+              if (telemetry) {
+                TelemetryRecord record = {};
+                record.type = TelemetryRecord_Audio;
+                record.frame_index = frame_index;
+                record.audio.byte_to_lock = byte_to_lock;
+                record.audio.target_cursor = target_cursor;
+                record.audio.bytes_to_write = bytes_to_write;
+                record.audio.play_cursor = play_cursor;
+                record.audio.write_cursor = write_cursor;
+                record.audio.latency_bytes = audio_latency_bytes;
+                Win32LogTelemetry(&telemetry->ring, &record);
+              }
 #endif
             }
             else {
@@ -1366,32 +1710,36 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
              * if we run this at the top of the loop. We wouldn't know if the OS
              * switched away before processing the next loop.
              */
-            real32 work_seconds_elapsed = Win32GetSecondsElapsed(last_counter, Win32GetWallClock());
-
-            real32 seconds_elapsed_for_frame = work_seconds_elapsed;
-            if (seconds_elapsed_for_frame < target_seconds_per_frame) {
-              while (seconds_elapsed_for_frame < target_seconds_per_frame) {
-                if (sleep_is_granular) {
-                  DWORD sleep_ms = (DWORD)(1000.0f * (target_seconds_per_frame - seconds_elapsed_for_frame));
-                  if (sleep_ms > 0) {
-                    Sleep(sleep_ms);
-                  }
-                }
-                seconds_elapsed_for_frame = Win32GetSecondsElapsed(last_counter, Win32GetWallClock());
-              }
-            }
-            else {
-              // TODO: MISSED FRAME RATE!
-              // TODO: log this
+            uint64 frame_start_ns = Win32PacerCounterToNs(&pacer_timer, last_counter.QuadPart);
+            uint64 frame_deadline_ns = frame_start_ns + pacer.target_ns;
+            uint64 work_end_ns = Win32PacerClock(&pacer_timer);
+            uint64 wait_end_ns = 0;
+            {
+              TIMED_BLOCK(PlatformFrameWait);
+              wait_end_ns = Win32WaitForFrame(&pacer, &pacer_timer, frame_deadline_ns);
             }
 
             // We waited above until we hit the target_seconds_per_frame and now we take a
             // time snapshot immediately following the wait. Everything below, rendering,
             // etc. will count towards the next frame's time.
             LARGE_INTEGER end_counter = Win32GetWallClock();
-            real32 ms_per_frame = 1000.0f * Win32GetSecondsElapsed(last_counter, end_counter);
+            last_frame_seconds = Win32GetSecondsElapsed(last_counter, end_counter);
             last_counter = end_counter;
 
+            // NOTE: logged right after the wait so that the tsc marks the frame boundary.
+            // Cycles per frame come from the difference between two frames' tsc.
+            if (telemetry) {
+              TelemetryRecord record = {};
+              record.type = TelemetryRecord_Frame;
+              record.frame_index = frame_index;
+              record.frame.frame_ns = (uint32)Min(wait_end_ns - frame_start_ns, 0xFFFFFFFFull);
+              record.frame.work_ns = (uint32)Min(work_end_ns - frame_start_ns, 0xFFFFFFFFull);
+              record.frame.late_ns = (uint32)((wait_end_ns > frame_deadline_ns) ?
+                                              Min(wait_end_ns - frame_deadline_ns, 0xFFFFFFFFull) : 0);
+              record.frame.missed = (work_end_ns >= frame_deadline_ns);
+              Win32LogTelemetry(&telemetry->ring, &record);
+            }
+
             Win32WindowDimension dimension = Win32GetWindowDimension(window);
 #if SNAKE_INTERNAL
             /*
@@ -1406,9 +1754,15 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
             */
 #endif
 
-            HDC device_context = GetDC(window);
-            Win32RenderBuffer(&global_backbuffer, device_context, dimension.width, dimension.height);
-            ReleaseDC(window, device_context);
+            // NOTE: the game only redraws what changed, so only that needs to go out
+            {
+              TIMED_BLOCK(PlatformPresent);
+              HDC device_context = GetDC(window);
+              Win32RenderBufferRect(&global_backbuffer, device_context,
+                                    screen_buffer.dirty_min_x, screen_buffer.dirty_min_y,
+                                    screen_buffer.dirty_max_x, screen_buffer.dirty_max_y);
+              ReleaseDC(window, device_context);
+            }
 
             flip_wall_clock = Win32GetWallClock();
 
@@ -1428,17 +1782,14 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
             new_input = old_input; // TODO should I clear these here?
             old_input = temp;
 
-            uint64 end_cycle_count = __rdtsc();
-            uint64 cycles_elapsed = end_cycle_count - last_cycle_count;
-            last_cycle_count = end_cycle_count;
-
-            real64 fps = 0.0f; //(real64)global_perf_count_freq / (real64)counter_elapsed;
-            real64 mega_cycles_per_frame = (real64)cycles_elapsed / (1000.0f * 1000.0f);
+#if SNAKE_INTERNAL
+            if (telemetry && game_store.debug_table.trace_enabled) {
+              Win32LogDebugEvents(&telemetry->ring, &game_store.debug_table, frame_index);
+            }
+            DebugEndFrame(&game_store.debug_table, last_frame_seconds);
+#endif
 
-            char fps_buffer[256];
-            _snprintf_s(fps_buffer, sizeof(fps_buffer),
-                "%.02fms/f, %.02ff/s, %.02fMc/f\n", ms_per_frame, fps, mega_cycles_per_frame);
-            OutputDebugStringA(fps_buffer);
+            ++frame_index;
 
 #if SNAKE_INTERNAL
             ++debug_audio_time_marker_idx;
@@ -1454,11 +1805,31 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR command_line, int32 s
       }
 
       // Perform cleanup
+      if (win32_state.game_replay_handle) {
+        Win32StopGameReplay(&win32_state, &game_store);
+      }
+      if (telemetry) {
+        Win32StopTelemetry(telemetry);
+      }
+      if (pacer.frame_count) {
+        char pacer_buffer[2048];
+        FormatFramePacerStats(&pacer, pacer_buffer, sizeof(pacer_buffer));
+        OutputDebugStringA(pacer_buffer);
+      }
+#if SNAKE_INTERNAL
+      if (game_store.debug_table.frame_count) {
+        char counter_buffer[4096];
+        FormatDebugCounters(&game_store.debug_table, counter_buffer, sizeof(counter_buffer));
+        OutputDebugStringA(counter_buffer);
+      }
+#endif
       for (int replay_index = 0;
           replay_index < ArrayCount(win32_state.replay_buffers);
           ++replay_index) {
         Win32ReplayBuffer *replay_buffer = Win32GetReplyBuffer(&win32_state, replay_index);
-        CloseHandle(replay_buffer->file_handle);
+        if (replay_buffer->file_handle) {
+          CloseHandle(replay_buffer->file_handle);
+        }
       }
     }
     else {
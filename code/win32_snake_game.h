@@ -55,6 +55,10 @@ struct Win32ReplayBuffer {
   HANDLE memory_map;
   char filename[WIN32_STATE_FILE_NAME_COUNT];
   void *memory_block;
+
+  // One bit per page of the game store that no longer matches memory_block. Created along
+  // with the backing file the first time the slot is used.
+  uint64 *dirty_pages;
 };
 
 struct Win32PlatformState {
@@ -62,12 +66,31 @@ struct Win32PlatformState {
   void *game_store_block;
   Win32ReplayBuffer replay_buffers[4];
 
+  // The game store is allocated with MEM_WRITE_WATCH so that snapshots only have to copy
+  // the pages the game wrote to since the last one.
+  uint32 page_size;
+  uint64 page_count;
+  uint64 dirty_page_word_count;
+  void **written_pages; // scratch for GetWriteWatch, page_count entries
+  uint64 *touched_pages; // every page written since startup, for slots opened later
+
   HANDLE recording_handle;
   int input_recording_index;
 
   HANDLE playback_handle;
   int input_playback_index;
 
+  // Passed on to the game when the backbuffer might not hold what it drew last frame
+  bool32 screen_needs_full_repaint;
+
+  // Seeded game replays (see snake_replay.h). 'R' starts a fresh game and records it.
+  bool32 game_replay_toggle_requested;
+  HANDLE game_replay_handle;
+  ReplayWriter game_replay;
+
+  // F1 turns the debug overlay (snake_debug_overlay.cpp) on and off
+  bool32 debug_overlay_toggle_requested;
+
   char exe_filename[WIN32_STATE_FILE_NAME_COUNT];
   char *one_past_last_exe_filename_slash;
 };
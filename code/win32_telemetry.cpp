@@ -0,0 +1,182 @@
+/* Win32 telemetry log. See snake_telemetry.h for the ring and the file format.
+ *
+ * The same ring as linux_telemetry.cpp, on interlocked operations and a drain thread that
+ * writes with WriteFile.
+ */
+
+#include "snake_telemetry.h"
+
+struct Win32Telemetry {
+  TelemetryRing ring;
+
+  HANDLE file_handle;
+  HANDLE drain_thread_handle;
+  uint32 volatile stop_requested;
+
+  uint64 start_tsc;
+  LARGE_INTEGER start_counter;
+
+  // Only touched by the drain thread
+  TelemetryRecord drain_buffer[256];
+};
+
+// Appends a record, stamping it with the tsc unless it has one. Safe to call from any thread.
+internal void
+Win32LogTelemetry(TelemetryRing *ring, TelemetryRecord *record) {
+  if (ring->is_active) {
+    uint32 record_idx = ring->next_record_to_write;
+    for (;;) {
+      if (record_idx - ring->next_record_to_read >= TELEMETRY_RING_SIZE) {
+        // NOTE: the drain is a whole ring behind. Don't wait for it.
+        InterlockedIncrement((LONG volatile *)&ring->dropped_count);
+        return;
+      }
+      uint32 original_record_idx = InterlockedCompareExchange((LONG volatile *)&ring->next_record_to_write,
+                                                              record_idx + 1, record_idx);
+      if (original_record_idx == record_idx) {
+        break;
+      }
+      record_idx = original_record_idx;
+    }
+
+    TelemetrySlot *slot = ring->slots + (record_idx & (TELEMETRY_RING_SIZE - 1));
+    slot->record = *record;
+    if (!slot->record.tsc) {
+      slot->record.tsc = __rdtsc();
+    }
+    // NOTE: the record has to be visible before the sequence that hands it out
+    _WriteBarrier();
+    slot->sequence = record_idx + 1;
+  }
+}
+
+#if SNAKE_INTERNAL
+// Hands the frame's timed block events to the log. Call before DebugEndFrame throws them away.
+internal void
+Win32LogDebugEvents(TelemetryRing *ring, DebugTable *table, uint32 frame_index) {
+  uint32 event_count = DebugEventCount(table);
+  for (uint32 event_idx = 0; event_idx < event_count; ++event_idx) {
+    DebugEvent *event = table->events + event_idx;
+    TelemetryRecord record = {};
+    record.type = (event->type == DebugEvent_BeginBlock) ? TelemetryRecord_BlockBegin : TelemetryRecord_BlockEnd;
+    record.frame_index = frame_index;
+    record.tsc = event->tsc;
+    record.block.block_id = event->block_id;
+    record.block.thread_id = event->thread_id;
+    Win32LogTelemetry(ring, &record);
+  }
+}
+#endif
+
+// Writes out every record that's ready. Only the drain thread (or Stop after it) calls this.
+internal void
+Win32DrainTelemetry(Win32Telemetry *telemetry) {
+  TelemetryRing *ring = &telemetry->ring;
+  uint32 record_idx = ring->next_record_to_read;
+  for (;;) {
+    int32 record_count = 0;
+    while (record_count < ArrayCount(telemetry->drain_buffer)) {
+      TelemetrySlot *slot = ring->slots + (record_idx & (TELEMETRY_RING_SIZE - 1));
+      // A writer that claimed this slot but hasn't finished holds up the ones after it
+      if (slot->sequence != record_idx + 1) {
+        break;
+      }
+      _ReadBarrier();
+      telemetry->drain_buffer[record_count++] = slot->record;
+      ++record_idx;
+    }
+    // NOTE: the copies are done, so the writers can have the slots back
+    _ReadWriteBarrier();
+    ring->next_record_to_read = record_idx;
+
+    if (record_count == 0) {
+      break;
+    }
+    DWORD bytes_written = 0;
+    WriteFile(telemetry->file_handle, telemetry->drain_buffer,
+              record_count * sizeof(TelemetryRecord), &bytes_written, 0);
+    // TODO: diagnostic on a short write. The records are gone either way.
+  }
+}
+
+internal DWORD WINAPI
+Win32TelemetryThreadProc(LPVOID parameter) {
+  Win32Telemetry *telemetry = (Win32Telemetry *)parameter;
+  while (!telemetry->stop_requested) {
+    Win32DrainTelemetry(telemetry);
+    Sleep(TELEMETRY_DRAIN_MS);
+  }
+  return 0;
+}
+
+/* Creates the log file at path and starts draining into it. Until this succeeds the ring
+ * stays inactive and logging does nothing.
+ */
+internal bool32
+Win32StartTelemetry(Win32Telemetry *telemetry, char *path) {
+  bool32 result = false;
+  telemetry->file_handle = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, 0, 0);
+  if (telemetry->file_handle != INVALID_HANDLE_VALUE) {
+    telemetry->start_tsc = __rdtsc();
+    QueryPerformanceCounter(&telemetry->start_counter);
+
+    TelemetryFileHeader header = {};
+    header.magic = TELEMETRY_MAGIC;
+    header.version = TELEMETRY_VERSION;
+    header.record_size = sizeof(TelemetryRecord);
+    header.start_tsc = telemetry->start_tsc;
+    DWORD bytes_written = 0;
+    if (WriteFile(telemetry->file_handle, &header, sizeof(header), &bytes_written, 0) &&
+        bytes_written == sizeof(header)) {
+      telemetry->stop_requested = 0;
+      telemetry->ring.is_active = true;
+      telemetry->drain_thread_handle = CreateThread(0, 0, Win32TelemetryThreadProc, telemetry, 0, 0);
+      if (telemetry->drain_thread_handle) {
+        result = true;
+      }
+      else {
+        telemetry->ring.is_active = false;
+      }
+    }
+    if (!result) {
+      CloseHandle(telemetry->file_handle);
+      telemetry->file_handle = INVALID_HANDLE_VALUE;
+    }
+  }
+  return result;
+}
+
+// Writes out what's left and fills in the header's tsc rate and drop count
+internal void
+Win32StopTelemetry(Win32Telemetry *telemetry) {
+  if (telemetry->ring.is_active) {
+    telemetry->ring.is_active = false;
+    InterlockedExchange((LONG volatile *)&telemetry->stop_requested, 1);
+    WaitForSingleObject(telemetry->drain_thread_handle, INFINITE);
+    CloseHandle(telemetry->drain_thread_handle);
+    Win32DrainTelemetry(telemetry);
+
+    uint64 elapsed_tsc = __rdtsc() - telemetry->start_tsc;
+    LARGE_INTEGER end_counter;
+    LARGE_INTEGER counter_freq;
+    QueryPerformanceCounter(&end_counter);
+    QueryPerformanceFrequency(&counter_freq);
+    real64 elapsed_seconds = (real64)(end_counter.QuadPart - telemetry->start_counter.QuadPart) /
+                             (real64)counter_freq.QuadPart;
+
+    TelemetryFileHeader header = {};
+    header.magic = TELEMETRY_MAGIC;
+    header.version = TELEMETRY_VERSION;
+    header.record_size = sizeof(TelemetryRecord);
+    header.dropped_count = telemetry->ring.dropped_count;
+    header.start_tsc = telemetry->start_tsc;
+    if (elapsed_seconds > 0.0) {
+      header.tsc_per_second = (uint64)((real64)elapsed_tsc / elapsed_seconds);
+    }
+    DWORD bytes_written = 0;
+    SetFilePointer(telemetry->file_handle, 0, 0, FILE_BEGIN);
+    WriteFile(telemetry->file_handle, &header, sizeof(header), &bytes_written, 0);
+    CloseHandle(telemetry->file_handle);
+    telemetry->file_handle = INVALID_HANDLE_VALUE;
+  }
+}
@@ -0,0 +1,94 @@
+/* Win32 work queue. See PlatformWorkQueue in snake_game.h.
+ *
+ * Entries go in a ring. Only the thread adding work writes next_entry_to_write, and the
+ * workers (and whoever is waiting in Win32CompleteAllWork) race for next_entry_to_read
+ * with a compare exchange, so there are no locks. Idle workers sleep on a semaphore that
+ * every new entry bumps.
+ */
+
+struct PlatformWorkQueueEntry {
+  platform_work_queue_callback *callback;
+  void *data;
+};
+
+struct PlatformWorkQueue {
+  uint32 volatile completion_goal;
+  uint32 volatile completion_count;
+
+  uint32 volatile next_entry_to_write;
+  uint32 volatile next_entry_to_read;
+  HANDLE semaphore_handle;
+
+  PlatformWorkQueueEntry entries[256];
+};
+
+internal PLATFORM_ADD_ENTRY(Win32AddEntry) {
+  // TODO switch to InterlockedCompareExchange if more than one thread ever adds work
+  uint32 new_next_entry_to_write = (queue->next_entry_to_write + 1) % ArrayCount(queue->entries);
+  Assert(new_next_entry_to_write != queue->next_entry_to_read);
+  PlatformWorkQueueEntry *entry = queue->entries + queue->next_entry_to_write;
+  entry->callback = callback;
+  entry->data = data;
+  ++queue->completion_goal;
+  // NOTE: the entry has to be visible before the index that hands it out
+  _WriteBarrier();
+  queue->next_entry_to_write = new_next_entry_to_write;
+  ReleaseSemaphore(queue->semaphore_handle, 1, 0);
+}
+
+// Returns true when there was nothing to do
+internal bool32
+Win32DoNextWorkQueueEntry(PlatformWorkQueue *queue) {
+  bool32 we_should_sleep = false;
+
+  uint32 original_next_entry_to_read = queue->next_entry_to_read;
+  uint32 new_next_entry_to_read = (original_next_entry_to_read + 1) % ArrayCount(queue->entries);
+  if (original_next_entry_to_read != queue->next_entry_to_write) {
+    uint32 entry_idx = InterlockedCompareExchange((LONG volatile *)&queue->next_entry_to_read,
+                                                  new_next_entry_to_read, original_next_entry_to_read);
+    if (entry_idx == original_next_entry_to_read) {
+      PlatformWorkQueueEntry entry = queue->entries[entry_idx];
+      entry.callback(queue, entry.data);
+      InterlockedIncrement((LONG volatile *)&queue->completion_count);
+    }
+  }
+  else {
+    we_should_sleep = true;
+  }
+  return we_should_sleep;
+}
+
+internal PLATFORM_COMPLETE_ALL_WORK(Win32CompleteAllWork) {
+  while (queue->completion_goal != queue->completion_count) {
+    Win32DoNextWorkQueueEntry(queue);
+  }
+  queue->completion_goal = 0;
+  queue->completion_count = 0;
+}
+
+DWORD WINAPI
+Win32WorkQueueThreadProc(LPVOID lp_parameter) {
+  PlatformWorkQueue *queue = (PlatformWorkQueue *)lp_parameter;
+  for (;;) {
+    if (Win32DoNextWorkQueueEntry(queue)) {
+      WaitForSingleObjectEx(queue->semaphore_handle, INFINITE, FALSE);
+    }
+  }
+}
+
+// Starts thread_count workers. They run until the process exits.
+internal void
+Win32MakeQueue(PlatformWorkQueue *queue, uint32 thread_count) {
+  queue->completion_goal = 0;
+  queue->completion_count = 0;
+  queue->next_entry_to_write = 0;
+  queue->next_entry_to_read = 0;
+
+  uint32 initial_count = 0;
+  queue->semaphore_handle = CreateSemaphoreEx(0, initial_count, Max(thread_count, 1), 0, 0, SEMAPHORE_ALL_ACCESS);
+  for (uint32 thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+    DWORD thread_id;
+    HANDLE thread_handle = CreateThread(0, 0, Win32WorkQueueThreadProc, queue, 0, &thread_id);
+    CloseHandle(thread_handle);
+  }
+}